@@ -0,0 +1,354 @@
+/* SPDX-License-Identifier: MIT */
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_GETRUSAGE
+# include <sys/resource.h>
+#endif
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/io/coo.h"
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Benchmark defaults. */
+/*----------------------------------------------------------------------------*/
+#define BENCH_EDGEFACTOR 16
+#define BENCH_REPS       3
+#define BENCH_SEED       UINT64_C(0x9e3779b97f4a7c15)
+
+/*----------------------------------------------------------------------------*/
+/*! Synthetic graph generators. */
+/*----------------------------------------------------------------------------*/
+enum { GEN_ER, GEN_RMAT };
+
+static char const * const gen_names[] = { "er", "rmat" };
+
+/*----------------------------------------------------------------------------*/
+/*! Formats under test and the kind of matrix each can represent. */
+/*----------------------------------------------------------------------------*/
+static struct {
+  char const * name;
+  int (*load)(char const *, Matrix *);
+  int (*save)(char const *, Matrix const *);
+  int symm; /*!< needs a symmetric matrix */
+  int wgt;  /*!< needs a weighted matrix */
+} const formats[] = {
+  { "bin",    IO_bin_load,    IO_bin_save,    0, 0 },
+  { "cluto",  IO_cluto_load,  IO_cluto_save,  0, 1 },
+  { "gap",    IO_gap_load,    IO_gap_save,    0, 0 },
+  { "metis",  IO_metis_load,  IO_metis_save,  1, 0 },
+  { "mm",     IO_mm_load,     IO_mm_save,     0, 0 },
+  { "snap",   IO_snap_load,   IO_snap_save,   0, 0 },
+  { "ugraph", IO_ugraph_load, IO_ugraph_save, 1, 0 }
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Next number from a splitmix64 sequence. */
+/*----------------------------------------------------------------------------*/
+static uint64_t
+rng_next(uint64_t * const s)
+{
+  uint64_t z = (*s += UINT64_C(0x9e3779b97f4a7c15));
+  z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return z ^ (z >> 31);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Uniform number in [0, 1). */
+/*----------------------------------------------------------------------------*/
+static double
+rng_unit(uint64_t * const s)
+{
+  return (double)(rng_next(s) >> 11) / 9007199254740992.0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Seconds on a monotonic clock. */
+/*----------------------------------------------------------------------------*/
+static double
+bench_now(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+  struct timespec ts;
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Peak resident set size of the process in KiB, or -1 when unknown. */
+/*----------------------------------------------------------------------------*/
+static long
+bench_peakrss(void)
+{
+#ifdef HAVE_GETRUSAGE
+  struct rusage ru;
+  if (0 != getrusage(RUSAGE_SELF, &ru))
+    return -1;
+# ifdef __APPLE__
+  return ru.ru_maxrss / 1024;
+# else
+  return ru.ru_maxrss;
+# endif
+#else
+  return -1;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Size of a file in bytes. */
+/*----------------------------------------------------------------------------*/
+static long
+bench_filesize(char const * const filename)
+{
+  FILE * const fp = fopen(filename, "rb");
+  if (NULL == fp)
+    return -1;
+
+  long size = -1;
+  if (0 == fseek(fp, 0, SEEK_END))
+    size = ftell(fp);
+  (void)fclose(fp);
+
+  return size;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Generate a graph with 2^scale vertices and edgefactor * 2^scale edges,
+ *  drawn uniformly (Erdős–Rényi) or recursively with the Graph500 R-MAT
+ *  probabilities. Symmetric graphs have no self-loops and store each edge in
+ *  both directions. The same arguments always produce the same graph. */
+/*----------------------------------------------------------------------------*/
+static int
+bench_generate(int const gen, int const scale, int const edgefactor,
+               int const wgt, int const symm, Matrix * const M)
+{
+  ind_t const n = (ind_t)1 << scale;
+  ind_t const m = (ind_t)edgefactor * n;
+  uint64_t seed = BENCH_SEED ^ (uint64_t)(scale * 4 + gen * 2 + symm);
+
+  ind_t * const u = malloc(m * sizeof(*u));
+  ind_t * const v = malloc(m * sizeof(*v));
+  val_t * const w = wgt ? malloc(m * sizeof(*w)) : NULL;
+  if (NULL == u || NULL == v || (wgt && NULL == w))
+    goto error;
+
+  ind_t k = 0;
+  for (ind_t e = 0; e < m; e++) {
+    ind_t x = 0, y = 0;
+
+    if (GEN_ER == gen) {
+      x = (ind_t)(rng_next(&seed) % n);
+      y = (ind_t)(rng_next(&seed) % n);
+    } else {
+      for (int b = 0; b < scale; b++) {
+        double const r = rng_unit(&seed);
+
+        if (r >= 0.57) {
+          if (r < 0.76)
+            y |= (ind_t)1 << b;
+          else if (r < 0.95)
+            x |= (ind_t)1 << b;
+          else
+            x |= y |= (ind_t)1 << b;
+        }
+      }
+    }
+
+    if (symm && x == y)
+      continue;
+
+    u[k] = x;
+    v[k] = y;
+    if (wgt)
+      w[k] = (val_t)(1 + rng_next(&seed) % 1000) / 1000;
+    k++;
+  }
+
+  ind_t const nnz = k * (ind_t)(1 + symm);
+
+  M->ia = malloc((n + 1) * sizeof(*M->ia));
+  M->ja = malloc(nnz * sizeof(*M->ja));
+  M->a  = wgt ? malloc(nnz * sizeof(*M->a)) : NULL;
+  if (NULL == M->ia || NULL == M->ja || (wgt && NULL == M->a))
+    goto error;
+
+  IO_coo_csr(n, k, u, v, w, symm, M->ia, M->ja, M->a);
+
+  M->fmt  = wgt ? 1 : 0;
+  M->sort = NONE;
+  M->symm = symm;
+  M->nr   = n;
+  M->nc   = n;
+  M->nnz  = nnz;
+
+  free(u);
+  free(v);
+  free(w);
+
+  return 0;
+
+  error:
+  free(u);
+  free(v);
+  free(w);
+  Matrix_free(M);
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Time the save and load of one matrix in one format, keeping the fastest of
+ *  reps repetitions, and print one CSV record per operation. */
+/*----------------------------------------------------------------------------*/
+static int
+bench_run(int const f, char const * const filename, Matrix const * const M,
+          char const * const gen, int const scale, int const reps)
+{
+  double tsave = -1, tload = -1;
+  int ret = 0;
+
+  for (int r = 0; r < reps && 0 == ret; r++) {
+    double const t0 = bench_now();
+    ret = formats[f].save(filename, M);
+    double const t1 = bench_now() - t0;
+
+    if (0 == ret && (0 > tsave || t1 < tsave))
+      tsave = t1;
+  }
+
+  long const bytes = bench_filesize(filename);
+
+  for (int r = 0; r < reps && 0 == ret; r++) {
+    Matrix L;
+
+    if (0 != Matrix_init(&L))
+      return -1;
+
+    double const t0 = bench_now();
+    ret = formats[f].load(filename, &L);
+    double const t1 = bench_now() - t0;
+
+    if (0 == ret) {
+      if (L.nnz != M->nnz)
+        ret = -1;
+      if (0 > tload || t1 < tload)
+        tload = t1;
+    }
+
+    Matrix_free(&L);
+  }
+
+  (void)remove(filename);
+
+  for (int op = 0; op < 2; op++) {
+    double const t = op ? tload : tsave;
+
+    printf("%s,%s,%s,%d,%d,%d,"PRIind","PRIind",%ld,%.6f,%.3f,%.0f,%ld,%s\n",
+      formats[f].name, op ? "load" : "save", gen, scale, has_adjwgt(M->fmt),
+      M->symm, M->nr, M->nnz, bytes, t, 0 < t ? bytes / t / 1e6 : 0.0,
+      0 < t ? M->nnz / t : 0.0, bench_peakrss(), 0 == ret ? "ok" : "fail");
+  }
+  fflush(stdout);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Print usage. */
+/*----------------------------------------------------------------------------*/
+static void
+usage(char const * const prog)
+{
+  fprintf(stderr,
+    "usage: %s [-d dir] [-e edgefactor] [-r reps] [scale ...]\n"
+    "  Times every load/save pair on synthetic graphs of 2^scale vertices\n"
+    "  (default scales 14 16 18) and prints one CSV record per operation.\n",
+    prog);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Benchmark driver. */
+/*----------------------------------------------------------------------------*/
+int
+main(int argc, char * argv[])
+{
+  int scales[32] = { 14, 16, 18 };
+  int nscales = 3, user = 0;
+  int edgefactor = BENCH_EDGEFACTOR, reps = BENCH_REPS;
+  char const * dir = ".";
+  int err = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (0 == strcmp(argv[i], "-d") && i + 1 < argc) {
+      dir = argv[++i];
+    } else if (0 == strcmp(argv[i], "-e") && i + 1 < argc) {
+      edgefactor = atoi(argv[++i]);
+    } else if (0 == strcmp(argv[i], "-r") && i + 1 < argc) {
+      reps = atoi(argv[++i]);
+    } else if ('-' != argv[i][0] && user < 32) {
+      scales[user++] = atoi(argv[i]);
+      nscales = user;
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (1 > edgefactor || 1 > reps) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  for (int s = 0; s < nscales; s++) {
+    if (1 > scales[s] || 30 < scales[s]) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  printf("format,op,gen,scale,weighted,symmetric,nr,nnz,bytes,seconds,MBps,"
+         "edges_per_s,peak_rss_kb,status\n");
+
+  for (int s = 0; s < nscales; s++) {
+    for (int gen = GEN_ER; gen <= GEN_RMAT; gen++) {
+      for (int wgt = 0; wgt < 2; wgt++) {
+        for (int symm = 0; symm < 2; symm++) {
+          Matrix M;
+
+          if (0 != Matrix_init(&M) ||
+              0 != bench_generate(gen, scales[s], edgefactor, wgt, symm, &M))
+          {
+            fprintf(stderr, "cannot generate scale %d graph\n", scales[s]);
+            return EXIT_FAILURE;
+          }
+
+          for (size_t f = 0; f < sizeof(formats) / sizeof(*formats); f++) {
+            if ((formats[f].symm && !symm) || (formats[f].wgt && !wgt))
+              continue;
+
+            char filename[4096];
+            (void)snprintf(filename, sizeof(filename), "%s/efika-io-bench.%s",
+                           dir, formats[f].name);
+
+            if (0 != bench_run((int)f, filename, &M, gen_names[gen], scales[s],
+                               reps))
+              err = 1;
+          }
+
+          Matrix_free(&M);
+        }
+      }
+    }
+  }
+
+  return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
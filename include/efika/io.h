@@ -2,23 +2,238 @@
 #ifndef EFIKA_IO_H
 #define EFIKA_IO_H 1
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
 #include "efika/core.h"
 
+/*----------------------------------------------------------------------------*/
+/*! Load/save options. */
+/*----------------------------------------------------------------------------*/
+typedef struct EFIKA_IO_Options {
+  int nthreads; /*!< threads used by parallel loaders, 1 for serial (default),
+                     0 for the OpenMP default; MM and ugraph loads keep a row
+                     count per thread, nthreads * nr in all, so they use fewer
+                     threads where that exceeds the larger of nnz and 2^24 */
+  int twopass;  /*!< re-read coordinate files (MM, SNAP) instead of staging
+                     their entries in memory; uses less memory but needs a
+                     seekable input */
+  char const * cache; /*!< directory in which text loads keep binary sidecars
+                           of their input, read instead of re-parsing it while
+                           it is unchanged; NULL (default) to disable */
+  int idbase;   /*!< id of the first vertex in SNAP files, 1 (default) or 0 */
+  int compact;  /*!< remap the (possibly sparse) vertex ids of SNAP files to
+                     0..n-1 in order of first appearance */
+  int sort;     /*!< sort the column indices of every row on load, permuting
+                     their values alongside, and set M->sort to ASC */
+  int noloops;  /*!< drop self-loops from coordinate files (MM, SNAP) */
+  int dedup;    /*!< merge duplicate entries of coordinate files (MM, SNAP),
+                     reducing their values with an EFIKA_IO_DEDUP_* */
+  int symmetrize; /*!< mirror the off-diagonal entries of general coordinate
+                       files (MM, SNAP), which must be square, and mark the
+                       result symmetric; an edge given in both directions
+                       then appears twice unless dedup is set */
+  int slab;     /*!< allocate the arrays of loaded matrices from one aligned
+                     slab, with an EFIKA_IO_SLAB_*; such matrices must be
+                     released with EFIKA_IO_slab_free (row blocks excepted) */
+  int nparts;   /*!< first touch the arrays of loaded matrices from nparts
+                     threads, thread k the rows of part k, so that with bound
+                     threads (OMP_PROC_BIND, OMP_PLACES) the pages of each part
+                     land on the NUMA node of the thread that processes it in
+                     a later nparts-thread parallel loop; 0 (default) to
+                     disable */
+  EFIKA_ind_t const * part; /*!< the nparts+1 row boundaries of the parts, or
+                                 NULL (default) for equal blocks of rows, as
+                                 schedule(static) makes */
+  int precision; /*!< most significant digits of the values saved to text
+                      files, rounding those that need more; 0 (default) for
+                      the fewest that read back exactly */
+} EFIKA_IO_Options;
+
+/*----------------------------------------------------------------------------*/
+/*! Reductions of the values of duplicate entries. */
+/*----------------------------------------------------------------------------*/
+enum {
+  EFIKA_IO_DEDUP_NONE, /*!< keep duplicates (default) */
+  EFIKA_IO_DEDUP_SUM,
+  EFIKA_IO_DEDUP_MIN,
+  EFIKA_IO_DEDUP_MAX,
+  EFIKA_IO_DEDUP_FIRST /*!< the value of the first in file order */
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Allocation of the arrays of loaded matrices. */
+/*----------------------------------------------------------------------------*/
+enum {
+  EFIKA_IO_SLAB_NONE,    /*!< one allocation per array (default) */
+  EFIKA_IO_SLAB_ALIGNED, /*!< one slab, each array aligned to 64 bytes */
+  EFIKA_IO_SLAB_HUGE     /*!< one slab backed by huge pages, explicit ones if
+                              reserved, transparent ones otherwise, falling
+                              back to an aligned slab */
+};
+
+/*----------------------------------------------------------------------------*/
+/*! File formats. */
+/*----------------------------------------------------------------------------*/
+typedef enum EFIKA_IO_Format {
+  EFIKA_IO_BIN,
+  EFIKA_IO_CLUTO,
+  EFIKA_IO_DIMACS, /*!< save only */
+  EFIKA_IO_GAP,
+  EFIKA_IO_METIS,
+  EFIKA_IO_MM,
+  EFIKA_IO_SNAP,
+  EFIKA_IO_UGRAPH
+} EFIKA_IO_Format;
+
+/*----------------------------------------------------------------------------*/
+/*! Phases of a load/save. */
+/*----------------------------------------------------------------------------*/
+enum {
+  EFIKA_IO_PHASE_OPEN,  /*!< opening the file and reading its header */
+  EFIKA_IO_PHASE_PARSE, /*!< reading, tokenizing and counting */
+  EFIKA_IO_PHASE_BUILD, /*!< allocating and filling the CSR arrays, including
+                             any second pass over the file */
+  EFIKA_IO_PHASE_WRITE, /*!< formatting and writing */
+  EFIKA_IO_NPHASE
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Load/save statistics. */
+/*----------------------------------------------------------------------------*/
+typedef struct EFIKA_IO_Stats {
+  uint64_t bytes;    /*!< bytes read or written */
+  uint64_t lines;    /*!< lines read */
+  uint64_t comments; /*!< comment lines skipped */
+  uint64_t nnz;      /*!< non-zeros loaded or saved */
+  uint64_t size;     /*!< bytes taken by the arrays of the loaded matrix, not
+                          counting the buffers used to build them */
+  double   time[EFIKA_IO_NPHASE]; /*!< wall-clock seconds spent per phase */
+  double   total;    /*!< wall-clock seconds overall */
+} EFIKA_IO_Stats;
+
+/*----------------------------------------------------------------------------*/
+/*! Row block reader, which streams a matrix as a sequence of bounded CSR row
+ *  blocks instead of loading it whole. */
+/*----------------------------------------------------------------------------*/
+typedef struct EFIKA_IO_Rows EFIKA_IO_Rows;
+
+/*----------------------------------------------------------------------------*/
+/*! Random access reader of a gap-compressed file, which decodes single rows
+ *  on demand. */
+/*----------------------------------------------------------------------------*/
+typedef struct EFIKA_IO_Gap EFIKA_IO_Gap;
+
+/*----------------------------------------------------------------------------*/
+/*! Asynchronous load/save request, performed by a process-wide worker pool. */
+/*----------------------------------------------------------------------------*/
+typedef struct EFIKA_IO_Async EFIKA_IO_Async;
+
 /*----------------------------------------------------------------------------*/
 /*! Public API. */
 /*----------------------------------------------------------------------------*/
 #ifdef __cplusplus
 extern "C" {
 #endif
+EFIKA_EXPORT int EFIKA_IO_bin_load   (char const*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_bin_load_fd(int, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_bin_load_stream(FILE*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_bin_map    (char const*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_bin_unmap  (EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_bin_save   (char const*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_bin_save_fd(int, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_bin_save_stream(FILE*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_bin_convert(char const*, char const*,
+                                      int (*)(char const*, EFIKA_Matrix*));
+EFIKA_EXPORT int EFIKA_IO_cluto_index(char const*, char const*, size_t);
 EFIKA_EXPORT int EFIKA_IO_cluto_load (char const*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_cluto_load_fd(int, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_cluto_load_stream(FILE*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_cluto_load_mem(char const*, size_t, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_cluto_load_range(char const*, char const*,
+                                           EFIKA_ind_t, EFIKA_ind_t,
+                                           EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_cluto_open (char const*, size_t, EFIKA_IO_Rows**);
 EFIKA_EXPORT int EFIKA_IO_cluto_save (char const*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_cluto_save_fd(int, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_cluto_save_stream(FILE*, EFIKA_Matrix const*);
 EFIKA_EXPORT int EFIKA_IO_dimacs_save(char const*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_dimacs_save_fd(int, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_dimacs_save_stream(FILE*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_gap_load   (char const*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_gap_load_fd(int, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_gap_load_stream(FILE*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_gap_save   (char const*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_gap_save_fd(int, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_gap_save_stream(FILE*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_metis_index(char const*, char const*, size_t);
 EFIKA_EXPORT int EFIKA_IO_metis_load (char const*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_metis_load_fd(int, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_metis_load_stream(FILE*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_metis_load_mem(char const*, size_t, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_metis_load_range(char const*, char const*,
+                                           EFIKA_ind_t, EFIKA_ind_t,
+                                           EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_metis_open (char const*, size_t, EFIKA_IO_Rows**);
 EFIKA_EXPORT int EFIKA_IO_metis_save (char const*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_metis_save_fd(int, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_metis_save_stream(FILE*, EFIKA_Matrix const*);
 EFIKA_EXPORT int EFIKA_IO_mm_load    (char const*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_mm_load_fd(int, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_mm_load_stream(FILE*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_mm_load_mem(char const*, size_t, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_mm_open    (char const*, size_t, EFIKA_IO_Rows**);
 EFIKA_EXPORT int EFIKA_IO_mm_save    (char const*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_mm_save_fd(int, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_mm_save_stream(FILE*, EFIKA_Matrix const*);
 EFIKA_EXPORT int EFIKA_IO_snap_load  (char const*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_snap_load_fd(int, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_snap_load_stream(FILE*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_snap_load_mem(char const*, size_t, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_snap_load_map(char const*, EFIKA_Matrix*,
+                                        uintmax_t**);
+EFIKA_EXPORT int EFIKA_IO_snap_open  (char const*, size_t, EFIKA_IO_Rows**);
 EFIKA_EXPORT int EFIKA_IO_snap_save  (char const*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_snap_save_fd(int, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_snap_save_stream(FILE*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_ugraph_load(char const*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_ugraph_load_fd(int, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_ugraph_load_stream(FILE*, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_ugraph_load_mem(char const*, size_t, EFIKA_Matrix*);
+EFIKA_EXPORT int EFIKA_IO_ugraph_save(char const*, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_ugraph_save_fd(int, EFIKA_Matrix const*);
+EFIKA_EXPORT int EFIKA_IO_ugraph_save_stream(FILE*, EFIKA_Matrix const*);
+
+EFIKA_EXPORT int  EFIKA_IO_gap_open (char const*, EFIKA_IO_Gap**);
+EFIKA_EXPORT void EFIKA_IO_gap_info (EFIKA_IO_Gap const*, EFIKA_ind_t*,
+                                     EFIKA_ind_t*, EFIKA_ind_t*, int*);
+EFIKA_EXPORT int  EFIKA_IO_gap_row  (EFIKA_IO_Gap const*, EFIKA_ind_t,
+                                     EFIKA_ind_t*, EFIKA_ind_t*,
+                                     EFIKA_val_t*);
+EFIKA_EXPORT void EFIKA_IO_gap_close(EFIKA_IO_Gap*);
+
+EFIKA_EXPORT int EFIKA_IO_load_ext(EFIKA_IO_Format, char const*, EFIKA_Matrix*,
+                                   EFIKA_IO_Stats*);
+EFIKA_EXPORT int EFIKA_IO_save_ext(EFIKA_IO_Format, char const*,
+                                   EFIKA_Matrix const*, EFIKA_IO_Stats*);
+
+EFIKA_EXPORT int EFIKA_IO_load_async  (EFIKA_IO_Format, char const*,
+                                       EFIKA_Matrix*, EFIKA_IO_Async**);
+EFIKA_EXPORT int EFIKA_IO_save_async  (EFIKA_IO_Format, char const*,
+                                       EFIKA_Matrix const*, EFIKA_IO_Async**);
+EFIKA_EXPORT int EFIKA_IO_async_wait  (EFIKA_IO_Async*);
+EFIKA_EXPORT int EFIKA_IO_async_test  (EFIKA_IO_Async*);
+EFIKA_EXPORT int EFIKA_IO_async_cancel(EFIKA_IO_Async*);
+
+EFIKA_EXPORT void EFIKA_IO_options_get(EFIKA_IO_Options*);
+EFIKA_EXPORT void EFIKA_IO_options_set(EFIKA_IO_Options const*);
+
+EFIKA_EXPORT int EFIKA_IO_slab_free(EFIKA_Matrix*);
+
+EFIKA_EXPORT int  EFIKA_IO_rows_next (EFIKA_IO_Rows*, EFIKA_ind_t*,
+                                      EFIKA_Matrix*);
+EFIKA_EXPORT void EFIKA_IO_rows_close(EFIKA_IO_Rows*);
 #ifdef __cplusplus
 }
 #endif
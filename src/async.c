@@ -0,0 +1,299 @@
+/* SPDX-License-Identifier: MIT */
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/core/pp.h"
+#include "efika/io/rename.h"
+
+/*! Maximum number of workers serving asynchronous requests. */
+#define ASYNC_NWORKERS 4
+
+/*----------------------------------------------------------------------------*/
+/*! States of an asynchronous request. */
+/*----------------------------------------------------------------------------*/
+enum {
+  ASYNC_QUEUED,
+  ASYNC_RUNNING,
+  ASYNC_DONE
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Asynchronous load/save request. */
+/*----------------------------------------------------------------------------*/
+struct IO_Async {
+  IO_Format      format;
+  char *         filename; /*!< private copy of the caller's filename */
+  Matrix *       M;        /*!< matrix to load into, NULL for a save */
+  Matrix const * C;        /*!< matrix to save */
+  int            state;
+  int            ret;      /*!< result of the load/save, once done */
+  IO_Async *     next;     /*!< next queued request */
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Perform a request in the calling thread. */
+/*----------------------------------------------------------------------------*/
+static int
+async_run(IO_Async * const req)
+{
+  if (NULL != req->M)
+    return IO_load_ext(req->format, req->filename, req->M, NULL);
+  return IO_save_ext(req->format, req->filename, req->C, NULL);
+}
+
+#ifdef HAVE_PTHREAD
+/*----------------------------------------------------------------------------*/
+/*! Process-wide worker pool. Workers are started on demand, up to
+ *  ASYNC_NWORKERS, and then wait for requests for the life of the process.
+ *  Requests are served in submission order. */
+/*----------------------------------------------------------------------------*/
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t  work;     /*!< a request has been queued */
+  pthread_cond_t  done;     /*!< a request has completed */
+  IO_Async *      head;     /*!< oldest queued request */
+  IO_Async *      tail;     /*!< newest queued request */
+  int             nqueued;
+  int             nworkers;
+  int             nidle;    /*!< workers waiting for a request */
+} pool = {
+  PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+  PTHREAD_COND_INITIALIZER, NULL, NULL, 0, 0, 0
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Worker: perform queued requests, oldest first. */
+/*----------------------------------------------------------------------------*/
+static void *
+async_main(void * const arg)
+{
+  (void)arg;
+
+  (void)pthread_mutex_lock(&pool.lock);
+  for (;;) {
+    while (NULL == pool.head) {
+      pool.nidle++;
+      (void)pthread_cond_wait(&pool.work, &pool.lock);
+      pool.nidle--;
+    }
+
+    IO_Async * const req = pool.head;
+    pool.head = req->next;
+    if (NULL == pool.head)
+      pool.tail = NULL;
+    pool.nqueued--;
+    req->state = ASYNC_RUNNING;
+    (void)pthread_mutex_unlock(&pool.lock);
+
+    int const ret = async_run(req);
+
+    (void)pthread_mutex_lock(&pool.lock);
+    req->ret   = ret;
+    req->state = ASYNC_DONE;
+    (void)pthread_cond_broadcast(&pool.done);
+  }
+
+  return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Start a worker, which must be done with the pool locked. */
+/*----------------------------------------------------------------------------*/
+static int
+async_spawn(void)
+{
+  pthread_t thread;
+
+  if (0 != pthread_create(&thread, NULL, async_main, NULL))
+    return -1;
+  (void)pthread_detach(thread);
+
+  pool.nworkers++;
+
+  return 0;
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/*! Queue a request, starting a worker when none is free to take it. Without
+ *  threads, or when no worker can be started, the request is performed before
+ *  returning. */
+/*----------------------------------------------------------------------------*/
+static int
+async_submit(IO_Format const format, char const * const filename,
+             Matrix * const M, Matrix const * const C, IO_Async ** const reqp)
+{
+  size_t const len = strlen(filename) + 1;
+
+  IO_Async * const req = calloc(1, sizeof(*req));
+  if (NULL == req)
+    return -1;
+
+  req->filename = malloc(len);
+  if (NULL == req->filename) {
+    free(req);
+    return -1;
+  }
+  memcpy(req->filename, filename, len);
+
+  req->format = format;
+  req->M      = M;
+  req->C      = C;
+  req->state  = ASYNC_QUEUED;
+
+#ifdef HAVE_PTHREAD
+  (void)pthread_mutex_lock(&pool.lock);
+
+  if (pool.nqueued >= pool.nidle && pool.nworkers < ASYNC_NWORKERS)
+    (void)async_spawn();
+
+  if (0 < pool.nworkers) {
+    if (NULL == pool.tail)
+      pool.head = req;
+    else
+      pool.tail->next = req;
+    pool.tail = req;
+    pool.nqueued++;
+    (void)pthread_cond_signal(&pool.work);
+    (void)pthread_mutex_unlock(&pool.lock);
+
+    *reqp = req;
+
+    return 0;
+  }
+
+  (void)pthread_mutex_unlock(&pool.lock);
+#endif
+
+  req->ret   = async_run(req);
+  req->state = ASYNC_DONE;
+
+  *reqp = req;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to start loading a file in the given format into M, which must not
+ *  be used until the request has been waited for. Any number of loads and
+ *  saves may be in flight at once; they share the process-wide options, which
+ *  must not change while they are. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_load_async(IO_Format const format, char const * const filename,
+              Matrix * const M, IO_Async ** const reqp)
+{
+  /* validate input */
+  if (!pp_all(filename, M, reqp))
+    return -1;
+
+  return async_submit(format, filename, M, NULL, reqp);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to start writing M to a file in the given format. M must not be
+ *  modified until the request has been waited for. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_save_async(IO_Format const format, char const * const filename,
+              Matrix const * const M, IO_Async ** const reqp)
+{
+  /* validate input */
+  if (!pp_all(filename, M, reqp))
+    return -1;
+
+  return async_submit(format, filename, NULL, M, reqp);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to wait for a request to complete and release it. Returns the
+ *  result of the load/save, or -1 if it was cancelled. Every request must be
+ *  waited for exactly once. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_async_wait(IO_Async * const req)
+{
+  /* validate input */
+  if (!pp_all(req))
+    return -1;
+
+#ifdef HAVE_PTHREAD
+  (void)pthread_mutex_lock(&pool.lock);
+  while (ASYNC_DONE != req->state)
+    (void)pthread_cond_wait(&pool.done, &pool.lock);
+  (void)pthread_mutex_unlock(&pool.lock);
+#endif
+
+  int const ret = req->ret;
+
+  free(req->filename);
+  free(req);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to check, without blocking, whether a request has completed, in
+ *  which case waiting for it returns immediately. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_async_test(IO_Async * const req)
+{
+  /* validate input */
+  if (!pp_all(req))
+    return -1;
+
+#ifdef HAVE_PTHREAD
+  (void)pthread_mutex_lock(&pool.lock);
+  int const done = (ASYNC_DONE == req->state);
+  (void)pthread_mutex_unlock(&pool.lock);
+
+  return done;
+#else
+  return 1;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to cancel a request that has not started yet, leaving its matrix
+ *  untouched. Fails once the request is running or done, since loads and
+ *  saves cannot be interrupted. The request must still be waited for. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_async_cancel(IO_Async * const req)
+{
+  /* validate input */
+  if (!pp_all(req))
+    return -1;
+
+  int ret = -1;
+
+#ifdef HAVE_PTHREAD
+  (void)pthread_mutex_lock(&pool.lock);
+  if (ASYNC_QUEUED == req->state) {
+    IO_Async ** p = &pool.head;
+    IO_Async * prev = NULL;
+    while (req != *p) {
+      prev = *p;
+      p = &(*p)->next;
+    }
+    *p = req->next;
+    if (req == pool.tail)
+      pool.tail = prev;
+    pool.nqueued--;
+
+    req->ret   = -1;
+    req->state = ASYNC_DONE;
+    ret = 0;
+  }
+  (void)pthread_mutex_unlock(&pool.lock);
+#endif
+
+  return ret;
+}
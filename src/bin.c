@@ -0,0 +1,559 @@
+/* SPDX-License-Identifier: MIT */
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_MMAP
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/core/gc.h"
+#include "efika/core/pp.h"
+#include "efika/io/bin.h"
+#include "efika/io/fd.h"
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+#include "efika/io/slab.h"
+#include "efika/io/stats.h"
+#include "efika/io/touch.h"
+
+/*! File offset of the first array. */
+#define IO_BIN_DATA \
+  ((sizeof(IO_bin_header) + IO_BIN_ALIGN - 1) / IO_BIN_ALIGN * IO_BIN_ALIGN)
+
+/*----------------------------------------------------------------------------*/
+/*! Byte length of each array of a matrix described by a header. */
+/*----------------------------------------------------------------------------*/
+static void
+bin_lengths(IO_bin_header const * const hdr, uint64_t * const len)
+{
+  len[0] = (hdr->nr + 1) * sizeof(ind_t);
+  len[1] = hdr->nnz * sizeof(ind_t);
+  len[2] = hdr->off[2] ? hdr->nnz * sizeof(val_t) : 0;
+  len[3] = hdr->off[3] ? hdr->ncon * hdr->nr * sizeof(val_t) : 0;
+  len[4] = hdr->off[4] ? hdr->nr * sizeof(ind_t) : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Build the header describing /M/. */
+/*----------------------------------------------------------------------------*/
+static void
+bin_layout(Matrix const * const M, IO_bin_header * const hdr)
+{
+  uint64_t len[5];
+
+  memset(hdr, 0, sizeof(*hdr));
+  memcpy(hdr->magic, IO_BIN_MAGIC, sizeof(hdr->magic));
+  hdr->version = IO_BIN_VERSION;
+  hdr->bom     = IO_BIN_BOM;
+  hdr->align   = IO_BIN_ALIGN;
+  hdr->indsize = sizeof(ind_t);
+  hdr->valsize = sizeof(val_t);
+  hdr->fmt     = M->fmt;
+  hdr->symm    = M->symm;
+  hdr->sort    = M->sort;
+  hdr->nr      = (uint64_t)M->nr;
+  hdr->nc      = (uint64_t)M->nc;
+  hdr->nnz     = (uint64_t)M->nnz;
+  hdr->ncon    = (uint64_t)M->ncon;
+
+  /* mark present arrays, so that their lengths can be computed */
+  hdr->off[0] = hdr->off[1] = 1;
+  hdr->off[2] = NULL != M->a;
+  hdr->off[3] = NULL != M->vwgt;
+  hdr->off[4] = NULL != M->vsiz;
+  bin_lengths(hdr, len);
+
+  uint64_t off = IO_BIN_DATA;
+  for (int k = 0; k < 5; k++) {
+    if (hdr->off[k]) {
+      hdr->off[k] = off;
+      off = (off + len[k] + IO_BIN_ALIGN - 1) / IO_BIN_ALIGN * IO_BIN_ALIGN;
+    }
+  }
+  hdr->size = off;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Validate a header against this build and the size of its file. */
+/*----------------------------------------------------------------------------*/
+static int
+bin_check(IO_bin_header const * const hdr, uint64_t const size)
+{
+  uint64_t len[5];
+
+  if (0 != memcmp(hdr->magic, IO_BIN_MAGIC, sizeof(hdr->magic)) ||
+      IO_BIN_VERSION != hdr->version || IO_BIN_BOM != hdr->bom ||
+      sizeof(ind_t) != hdr->indsize || sizeof(val_t) != hdr->valsize ||
+      0 == hdr->align || 0 != hdr->align % sizeof(uint64_t) ||
+      size < hdr->size)
+    return -1;
+
+  /* insist that the dimensions are representable */
+  if ((uint64_t)(ind_t)hdr->nr != hdr->nr ||
+      (uint64_t)(ind_t)hdr->nc != hdr->nc ||
+      (uint64_t)(ind_t)hdr->nnz != hdr->nnz ||
+      (uint64_t)(ind_t)hdr->ncon != hdr->ncon)
+    return -1;
+
+  /* insist that arrays are aligned, ordered and inside the file */
+  bin_lengths(hdr, len);
+  uint64_t end = sizeof(*hdr);
+  for (int k = 0; k < 5; k++) {
+    if (0 == hdr->off[k]) {
+      if (2 > k)
+        return -1;
+      continue;
+    }
+    if (hdr->off[k] < end || 0 != hdr->off[k] % hdr->align ||
+        hdr->off[k] > hdr->size || hdr->size - hdr->off[k] < len[k])
+      return -1;
+    end = hdr->off[k] + len[k];
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Read len bytes at file offset off, skipping forward from *pos, so that
+ *  non-seekable streams can be read. */
+/*----------------------------------------------------------------------------*/
+static int
+bin_read(FILE * const istream, uint64_t * const pos, uint64_t const off,
+         void * const buf, uint64_t const len)
+{
+  char skip[IO_BIN_ALIGN];
+
+  while (*pos < off) {
+    size_t const n = off - *pos < sizeof(skip) ? off - *pos : sizeof(skip);
+    if (n != fread(skip, 1, n, istream))
+      return -1;
+    *pos += n;
+  }
+
+  if (len != fread(buf, 1, len, istream))
+    return -1;
+  *pos += len;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Point the fields of /M/ into a buffer holding a whole (validated) file. */
+/*----------------------------------------------------------------------------*/
+static void
+bin_attach(char * const base, Matrix * const M)
+{
+  IO_bin_header const * const hdr = (IO_bin_header const *)base;
+
+  M->fmt   = hdr->fmt;
+  /*M->diag  = 0;*/
+  M->sort  = hdr->sort;
+  M->symm  = hdr->symm;
+  M->nr    = (ind_t)hdr->nr;
+  M->nc    = (ind_t)hdr->nc;
+  M->nnz   = (ind_t)hdr->nnz;
+  M->ncon  = (ind_t)hdr->ncon;
+  M->ia    = (ind_t *)(base + hdr->off[0]);
+  M->ja    = (ind_t *)(base + hdr->off[1]);
+  M->a     = hdr->off[2] ? (val_t *)(base + hdr->off[2]) : NULL;
+  M->vwgt  = hdr->off[3] ? (val_t *)(base + hdr->off[3]) : NULL;
+  M->vsiz  = hdr->off[4] ? (ind_t *)(base + hdr->off[4]) : NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Read a binary file from istream, which is only read forward and is left
+ *  open, rejecting it unless it carries /tag/ (any tag when zero). */
+/*----------------------------------------------------------------------------*/
+static int
+bin_fload(FILE * const istream, Matrix * const M, uint64_t const tag)
+{
+  /* ...garbage collected function... */
+  GC_func_init();
+
+  uint64_t pos = 0, len[5];
+  IO_bin_header hdr;
+
+  /* read and validate header */
+  GC_assert(0 == bin_read(istream, &pos, 0, &hdr, sizeof(hdr)));
+  GC_assert(0 == bin_check(&hdr, UINT64_MAX));
+  GC_assert(0 == tag || tag == hdr.tag);
+  bin_lengths(&hdr, len);
+
+  IO_stats_phase(IO_PHASE_PARSE);
+
+  /* allocate memory for /M/ */
+  IO_csr csr;
+  GC_assert(0 == IO_csr_alloc(&csr, (ind_t)hdr.nr, (ind_t)hdr.nnz,
+                              0 != hdr.off[2],
+                              hdr.off[3] ? (ind_t)hdr.ncon : 0,
+                              0 != hdr.off[4]));
+  GC_register_free(IO_csr_free, &csr);
+
+  ind_t * const ia   = csr.ia;
+  ind_t * const ja   = csr.ja;
+  val_t * const a    = csr.a;
+  val_t * const vwgt = csr.vwgt;
+  ind_t * const vsiz = csr.vsiz;
+
+  /* read arrays in file order */
+  GC_assert(0 == bin_read(istream, &pos, hdr.off[0], ia, len[0]));
+
+  /* insist that the row pointers are consistent */
+  GC_assert(0 == ia[0] && (uint64_t)ia[hdr.nr] == hdr.nnz);
+  IO_touch_nnz((ind_t)hdr.nr, ia, ja, a);
+
+  GC_assert(0 == bin_read(istream, &pos, hdr.off[1], ja, len[1]));
+  if (a)
+    GC_assert(0 == bin_read(istream, &pos, hdr.off[2], a, len[2]));
+  if (vwgt)
+    GC_assert(0 == bin_read(istream, &pos, hdr.off[3], vwgt, len[3]));
+  if (vsiz)
+    GC_assert(0 == bin_read(istream, &pos, hdr.off[4], vsiz, len[4]));
+
+  M->fmt   = hdr.fmt;
+  /*M->diag  = 0;*/
+  M->sort  = hdr.sort;
+  M->symm  = hdr.symm;
+  M->nr    = (ind_t)hdr.nr;
+  M->nc    = (ind_t)hdr.nc;
+  M->nnz   = (ind_t)hdr.nnz;
+  M->ncon  = (ind_t)hdr.ncon;
+  M->ia    = ia;
+  M->ja    = ja;
+  M->a     = a;
+  M->vwgt  = vwgt;
+  M->vsiz  = vsiz;
+
+  if (NULL != IO_stats.stats)
+    IO_stats.stats->bytes += pos;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Read a binary file, rejecting it unless it carries /tag/ (any tag when
+ *  zero). */
+/*----------------------------------------------------------------------------*/
+int
+IO_bin_load_tag(char const * const filename, Matrix * const M,
+                uint64_t const tag)
+{
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  /* open input file */
+  FILE * const istream = fopen(filename, "rb");
+  if (!istream)
+    return -1;
+
+  int const ret = bin_fload(istream, M, tag);
+  (void)fclose(istream);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a binary file. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_bin_load(char const * const filename, Matrix * const M)
+{
+  return IO_bin_load_tag(filename, M, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a binary file from descriptor fd, such as a pipe or socket,
+ *  which is read from its current position and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_bin_load_fd(int const fd, Matrix * const M)
+{
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open input source */
+  FILE * const istream = IO_fd_open(fd, "rb");
+  if (!istream)
+    return -1;
+
+  int const ret = bin_fload(istream, M, 0);
+  (void)fclose(istream);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a binary file from stream, which must have been opened in
+ *  binary mode, and is read from its current position and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_bin_load_stream(FILE * const stream, Matrix * const M)
+{
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  return bin_fload(stream, M, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to map a binary file. The arrays of /M/ point directly into a
+ *  private (copy-on-write) mapping of the file, so loading costs only page
+ *  faults. /M/ must be released with IO_bin_unmap. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_bin_map(char const * const filename, Matrix * const M)
+{
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+#ifdef HAVE_MMAP
+  int const fd = open(filename, O_RDONLY);
+  if (-1 == fd)
+    return -1;
+
+  struct stat st;
+  if (-1 == fstat(fd, &st) || (off_t)sizeof(IO_bin_header) > st.st_size) {
+    (void)close(fd);
+    return -1;
+  }
+
+  char * const base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE, fd, 0);
+  (void)close(fd);
+  if (MAP_FAILED == base)
+    return -1;
+
+  IO_bin_header const * const hdr = (IO_bin_header const *)base;
+  if (0 != bin_check(hdr, (uint64_t)st.st_size) ||
+      IO_BIN_DATA != hdr->off[0] || (uint64_t)st.st_size != hdr->size)
+  {
+    (void)munmap(base, (size_t)st.st_size);
+    return -1;
+  }
+#else
+  /* ...no mmap, so read the whole file into a buffer with the same layout... */
+  IO_bin_header hdr0;
+
+  FILE * const istream = fopen(filename, "rb");
+  if (!istream)
+    return -1;
+
+  if (1 != fread(&hdr0, sizeof(hdr0), 1, istream) ||
+      0 != bin_check(&hdr0, UINT64_MAX) || IO_BIN_DATA != hdr0.off[0] ||
+      (uint64_t)(size_t)hdr0.size != hdr0.size)
+  {
+    fclose(istream);
+    return -1;
+  }
+
+  char * const base = malloc((size_t)hdr0.size);
+  if (!base) {
+    fclose(istream);
+    return -1;
+  }
+
+  memcpy(base, &hdr0, sizeof(hdr0));
+  size_t const rest = (size_t)hdr0.size - sizeof(hdr0);
+  if (rest != fread(base + sizeof(hdr0), 1, rest, istream)) {
+    free(base);
+    fclose(istream);
+    return -1;
+  }
+  fclose(istream);
+#endif
+
+  bin_attach(base, M);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to release a matrix obtained from IO_bin_map. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_bin_unmap(Matrix * const M)
+{
+  /* validate input */
+  if (!pp_all(M, M->ia))
+    return -1;
+
+  char * const base = (char *)M->ia - IO_BIN_DATA;
+  IO_bin_header const * const hdr = (IO_bin_header const *)base;
+
+  if (0 != memcmp(hdr->magic, IO_BIN_MAGIC, sizeof(hdr->magic)))
+    return -1;
+
+#ifdef HAVE_MMAP
+  if (0 != munmap(base, (size_t)hdr->size))
+    return -1;
+#else
+  free(base);
+#endif
+
+  M->ia   = NULL;
+  M->ja   = NULL;
+  M->a    = NULL;
+  M->vwgt = NULL;
+  M->vsiz = NULL;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a binary file carrying /tag/ to ostream, which is written in order
+ *  and flushed, but left open. */
+/*----------------------------------------------------------------------------*/
+static int
+bin_fsave(FILE * const ostream, Matrix const * const M, uint64_t const tag)
+{
+  static char const zero[IO_BIN_ALIGN] = { 0 };
+  uint64_t pos, len[5];
+  IO_bin_header hdr;
+
+  void const * const arr[5] = { M->ia, M->ja, M->a, M->vwgt, M->vsiz };
+
+  bin_layout(M, &hdr);
+  bin_lengths(&hdr, len);
+  hdr.tag = tag;
+
+  IO_stats_phase(IO_PHASE_WRITE);
+
+  int ok = (1 == fwrite(&hdr, sizeof(hdr), 1, ostream));
+  pos = sizeof(hdr);
+
+  for (int k = 0; ok && k < 5; k++) {
+    if (0 == hdr.off[k])
+      continue;
+
+    ok = (hdr.off[k] - pos == fwrite(zero, 1, hdr.off[k] - pos, ostream)) &&
+         (len[k] == fwrite(arr[k], 1, len[k], ostream));
+    pos = hdr.off[k] + len[k];
+  }
+  ok = ok && (hdr.size - pos == fwrite(zero, 1, hdr.size - pos, ostream));
+
+  /* ... */
+  if (0 != fflush(ostream))
+    ok = 0;
+
+  if (ok && NULL != IO_stats.stats)
+    IO_stats.stats->bytes += hdr.size;
+
+  return ok ? 0 : -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a binary file carrying /tag/. */
+/*----------------------------------------------------------------------------*/
+int
+IO_bin_save_tag(char const * const filename, Matrix const * const M,
+                uint64_t const tag)
+{
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  /* open output file */
+  FILE * const ostream = fopen(filename, "wb");
+  if (!ostream)
+    return -1;
+
+  int ret = bin_fsave(ostream, M, tag);
+  if (0 != fclose(ostream))
+    ret = -1;
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a binary file. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_bin_save(char const * const filename, Matrix const * const M)
+{
+  return IO_bin_save_tag(filename, M, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a binary file to descriptor fd, such as a pipe or socket,
+ *  which is left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_bin_save_fd(int const fd, Matrix const * const M)
+{
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open output sink */
+  FILE * const ostream = IO_fd_open(fd, "wb");
+  if (!ostream)
+    return -1;
+
+  int ret = bin_fsave(ostream, M, 0);
+  if (0 != fclose(ostream))
+    ret = -1;
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a binary file to stream, which must have been opened in
+ *  binary mode, and is flushed but left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_bin_save_stream(FILE * const stream, Matrix const * const M)
+{
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  return bin_fsave(stream, M, 0);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to convert a file read by /load/ (e.g., IO_mm_load) into a binary
+ *  file. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_bin_convert(char const * const ifilename, char const * const ofilename,
+               int (*load)(char const*, Matrix*))
+{
+  int ret;
+  Matrix M;
+
+  /* validate input */
+  if (!pp_all(ifilename, ofilename, load))
+    return -1;
+
+  if (0 != Matrix_init(&M))
+    return -1;
+
+  ret = load(ifilename, &M);
+  if (0 != ret) {
+    Matrix_free(&M);
+    return ret;
+  }
+
+  ret = IO_bin_save(ofilename, &M);
+
+  /* ...a matrix loaded into a slab is released as one... */
+  if (IO_SLAB_NONE != IO_opts.slab)
+    (void)IO_slab_free(&M);
+  else
+    Matrix_free(&M);
+
+  return ret;
+}
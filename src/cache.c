@@ -0,0 +1,237 @@
+/* SPDX-License-Identifier: MIT */
+#define _XOPEN_SOURCE 700
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_MKSTEMP
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/io/bin.h"
+#include "efika/io/cache.h"
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+#include "efika/io/stats.h"
+
+#ifdef HAVE_MKSTEMP
+/*----------------------------------------------------------------------------*/
+/*! Fold len bytes into a 64-bit FNV-1a hash. */
+/*----------------------------------------------------------------------------*/
+static uint64_t
+cache_hash(uint64_t h, void const * const buf, size_t const len)
+{
+  unsigned char const * const p = buf;
+
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= UINT64_C(0x100000001b3);
+  }
+
+  return h;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Fold the options that change what a loader produces into a hash. */
+/*----------------------------------------------------------------------------*/
+static uint64_t
+cache_variant(uint64_t h)
+{
+  int32_t const opt[] = {
+    IO_opts.idbase, IO_opts.compact, IO_opts.sort, IO_opts.noloops,
+    IO_opts.dedup, IO_opts.symmetrize
+  };
+
+  return cache_hash(h, opt, sizeof(opt));
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Compute the key of a source file from its format, the loader options, its
+ *  size, modification time and a sample of its contents: the whole file when
+ *  it is small, otherwise IO_CACHE_NBLOCK blocks spread evenly from its first
+ *  to its last byte. */
+/*----------------------------------------------------------------------------*/
+static int
+cache_key(IO_Format const format, char const * const filename,
+          uint64_t * const key)
+{
+  char buf[IO_CACHE_BLOCK];
+  struct stat st;
+
+  int const fd = open(filename, O_RDONLY);
+  if (-1 == fd)
+    return -1;
+
+  if (-1 == fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+    (void)close(fd);
+    return -1;
+  }
+
+  uint64_t const size  = (uint64_t)st.st_size;
+  int64_t  const mtime = (int64_t)st.st_mtime;
+  int32_t  const fmt   = (int32_t)format;
+
+  uint64_t h = UINT64_C(0xcbf29ce484222325);
+  h = cache_hash(h, &fmt, sizeof(fmt));
+  h = cache_hash(h, &size, sizeof(size));
+  h = cache_hash(h, &mtime, sizeof(mtime));
+  h = cache_variant(h);
+
+  uint64_t const nblk = size <= IO_CACHE_BLOCK * IO_CACHE_NBLOCK
+                      ? (size + IO_CACHE_BLOCK - 1) / IO_CACHE_BLOCK
+                      : IO_CACHE_NBLOCK;
+
+  for (uint64_t k = 0; k < nblk; k++) {
+    uint64_t const off = size <= IO_CACHE_BLOCK * IO_CACHE_NBLOCK
+                       ? k * IO_CACHE_BLOCK
+                       : (size - IO_CACHE_BLOCK) * k / (IO_CACHE_NBLOCK - 1);
+    size_t const len = size - off < IO_CACHE_BLOCK ? size - off
+                                                   : IO_CACHE_BLOCK;
+
+    if ((ssize_t)len != pread(fd, buf, len, (off_t)off)) {
+      (void)close(fd);
+      return -1;
+    }
+    h = cache_hash(h, buf, len);
+  }
+
+  (void)close(fd);
+
+  /* ...zero marks an untagged file... */
+  *key = h ? h : 1;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Build the name of the sidecar of a source file, which depends only on its
+ *  canonical path and format, so that each source has a single sidecar. */
+/*----------------------------------------------------------------------------*/
+static char *
+cache_path(IO_Format const format, char const * const filename)
+{
+  char const * const dir = IO_opts.cache;
+  int32_t const fmt = (int32_t)format;
+
+  char * const real = realpath(filename, NULL);
+  if (NULL == real)
+    return NULL;
+
+  uint64_t h = UINT64_C(0xcbf29ce484222325);
+  h = cache_hash(h, &fmt, sizeof(fmt));
+  h = cache_hash(h, real, strlen(real));
+  free(real);
+
+  size_t const len = strlen(dir) + 1 + 16 + sizeof(".bin");
+  char * const path = malloc(len);
+  if (NULL == path)
+    return NULL;
+
+  (void)snprintf(path, len, "%s/%016"PRIx64".bin", dir, h);
+
+  return path;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write the sidecar of a source file. It is written to a unique temporary
+ *  file, which is then renamed over the sidecar, so that concurrent loaders
+ *  only ever see a complete sidecar. The temporary file is created like any
+ *  other, with mode 0666 less the umask, rather than with the 0600 of mkstemp,
+ *  so that other users sharing the cache directory can read the sidecar. */
+/*----------------------------------------------------------------------------*/
+static int
+cache_store(char const * const path, Matrix const * const M,
+            uint64_t const key)
+{
+  static IO_THREAD_LOCAL unsigned seq = 0;
+
+  size_t const len = strlen(path) + 64;
+  char * const tmp = malloc(len);
+  if (NULL == tmp)
+    return -1;
+
+  /* ...the directory may already exist... */
+  (void)mkdir(IO_opts.cache, 0777);
+
+  /* ...named after the process, the thread and a sequence number, retrying
+   * should a stale file of a former process hold the name... */
+  int fd = -1;
+  for (int k = 0; -1 == fd && k < 16; k++) {
+    (void)snprintf(tmp, len, "%s.%ld.%p.%u", path, (long)getpid(),
+                   (void *)&seq, seq++);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (-1 == fd && EEXIST != errno)
+      break;
+  }
+  if (-1 == fd) {
+    free(tmp);
+    return -1;
+  }
+  (void)close(fd);
+
+  /* ...the sidecar is not part of the statistics of the load... */
+  IO_Stats * const stats = IO_stats.stats;
+  IO_stats.stats = NULL;
+
+  int ret = IO_bin_save_tag(tmp, M, key);
+  if (0 == ret)
+    ret = rename(tmp, path);
+  if (0 != ret)
+    (void)unlink(tmp);
+
+  IO_stats.stats = stats;
+
+  free(tmp);
+
+  return ret;
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/*! Load a text file with /load/, going through its binary sidecar when the
+ *  cache is enabled. A sidecar whose key matches the file is read instead of
+ *  the file; otherwise the file is parsed and its sidecar (re)written. Failing
+ *  to write the sidecar does not fail the load. */
+/*----------------------------------------------------------------------------*/
+int
+IO_cache_load(IO_Format const format, char const * const filename,
+              Matrix * const M, int (*load)(char const*, Matrix*))
+{
+#ifdef HAVE_MKSTEMP
+  uint64_t key, key2;
+
+  if (NULL == IO_opts.cache || NULL == filename ||
+      0 != cache_key(format, filename, &key))
+    return load(filename, M);
+
+  char * const path = cache_path(format, filename);
+  if (NULL == path)
+    return load(filename, M);
+
+  if (0 == IO_bin_load_tag(path, M, key)) {
+    free(path);
+    return 0;
+  }
+
+  int const ret = load(filename, M);
+
+  /* ...only if the file did not change while it was being parsed... */
+  if (0 == ret && 0 == cache_key(format, filename, &key2) && key == key2)
+    (void)cache_store(path, M, key);
+
+  free(path);
+
+  return ret;
+#else
+  (void)format;
+  return load(filename, M);
+#endif
+}
@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: MIT */
+#include <stdlib.h>
+#include <string.h>
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/io/clean.h"
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+#include "efika/io/sort.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Fold the value y of a duplicate entry into the value x of the entry it
+ *  merges with, which precedes it in file order. */
+/*----------------------------------------------------------------------------*/
+static inline val_t
+clean_reduce(int const dedup, val_t const x, val_t const y)
+{
+  switch (dedup) {
+    case IO_DEDUP_SUM: return x + y;
+    case IO_DEDUP_MIN: return (y < x) ? y : x;
+    case IO_DEDUP_MAX: return (y > x) ? y : x;
+    default:           return x;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Clean row i of n entries in place and store its new length in *len. */
+/*----------------------------------------------------------------------------*/
+static int
+clean_row(ind_t const i, ind_t const n, ind_t * const ja, val_t * const a,
+          int const noloops, int const dedup, IO_sort * const buf,
+          ind_t * const len)
+{
+  ind_t k = n;
+
+  if (noloops) {
+    k = 0;
+    for (ind_t j = 0; j < n; j++) {
+      if (ja[j] != i) {
+        if (NULL != a)
+          a[k] = a[j];
+        ja[k++] = ja[j];
+      }
+    }
+  }
+
+  if (IO_DEDUP_NONE != dedup && 1 < k) {
+    /* ...the sort is stable, so duplicates stay in file order... */
+    if (0 != IO_sort_row(k, ja, a, buf))
+      return -1;
+
+    ind_t m = 0;
+    for (ind_t j = 1; j < k; j++) {
+      if (ja[j] == ja[m]) {
+        if (NULL != a)
+          a[m] = clean_reduce(dedup, a[m], a[j]);
+      } else {
+        m++;
+        if (NULL != a)
+          a[m] = a[j];
+        ja[m] = ja[j];
+      }
+    }
+    k = m + 1;
+  }
+
+  *len = k;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Drop the self-loops and merge the duplicate entries of a CSR matrix, as the
+ *  options ask, compacting it in place; ia[nr] is its new number of non-zeros.
+ *  Rows are cleaned in parallel, then moved down in order, since no row moves
+ *  past the start of its old position. Deduplicated rows come out sorted. */
+/*----------------------------------------------------------------------------*/
+int
+IO_clean_rows(ind_t const nr, ind_t * const ia, ind_t * const ja,
+              val_t * const a)
+{
+  int const noloops = IO_opts.noloops;
+  int const dedup   = IO_opts.dedup;
+
+  if (IO_DEDUP_NONE > dedup || IO_DEDUP_FIRST < dedup)
+    return -1;
+  if ((!noloops && IO_DEDUP_NONE == dedup) || 0 == nr)
+    return 0;
+
+  ind_t * const len = malloc(nr * sizeof(*len));
+  if (NULL == len)
+    return -1;
+
+  int err = 0;
+
+  #pragma omp parallel num_threads(IO_nthreads()) reduction(|:err)
+  {
+    IO_sort buf = { NULL, NULL, 0 };
+
+    #pragma omp for schedule(dynamic, 256)
+    for (ind_t i = 0; i < nr; i++)
+      err |= clean_row(i, ia[i+1] - ia[i], ja + ia[i],
+                       (NULL != a) ? a + ia[i] : NULL, noloops, dedup, &buf,
+                       len + i);
+
+    IO_sort_free(&buf);
+  }
+
+  if (0 == err) {
+    ind_t nnz = 0;
+    for (ind_t i = 0; i < nr; i++) {
+      ind_t const beg = ia[i];
+      ia[i] = nnz;
+      memmove(ja + nnz, ja + beg, len[i] * sizeof(*ja));
+      if (NULL != a)
+        memmove(a + nnz, a + beg, len[i] * sizeof(*a));
+      nnz += len[i];
+    }
+    ia[nr] = nnz;
+  }
+
+  free(len);
+
+  return err ? -1 : 0;
+}
@@ -1,6 +1,5 @@
 /* SPDX-License-Identifier: MIT */
 #include <ctype.h>
-#include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,128 +9,655 @@
 
 #include "efika/core/gc.h"
 #include "efika/core/pp.h"
-#include "efika/io/getline.h"
+#include "efika/io/cache.h"
+#include "efika/io/index.h"
+#include "efika/io/options.h"
+#include "efika/io/reader.h"
 #include "efika/io/rename.h"
-
-/*----------------------------------------------------------------------------*/
-/*! Shim to allow fclose to be registered. */
-/*----------------------------------------------------------------------------*/
-static inline void
-vfclose(FILE * file)
-{
-  (void)fclose(file);
-}
+#include "efika/io/rows.h"
+#include "efika/io/scan.h"
+#include "efika/io/slab.h"
+#include "efika/io/sort.h"
+#include "efika/io/stats.h"
+#include "efika/io/touch.h"
+#include "efika/io/writer.h"
 
 /*----------------------------------------------------------------------------*/
 /*! Get next non-comment line from a file. */
 /*----------------------------------------------------------------------------*/
 static inline intmax_t
-getline_nc(char ** const lineptr, size_t * const n, FILE * const istream)
+getline_nc(IO_reader * const reader, char const ** const lineptr)
 {
-  intptr_t ret;
+  intmax_t ret;
 
   /* skip comment lines */
   do {
-    ret = IO_getline(lineptr, n, istream);
+    ret = IO_reader_getline(reader, lineptr);
   } while (0 < ret && '%' == *lineptr[0]);
 
   return ret;
 }
 
+/*----------------------------------------------------------------------------*/
+/*! Read the header of a cluto file, which is its first non-comment line. */
+/*----------------------------------------------------------------------------*/
+static int
+cluto_header(IO_reader * const reader, ind_t * const nr, ind_t * const nc,
+             ind_t * const nnz)
+{
+  intmax_t len;
+  char const * line, * p;
+
+  /* get first non-comment line in file */
+  if (0 >= (len = getline_nc(reader, &line)))
+    return -1;
+
+  char const * const eoh = line + len;
+  *nr = IO_strtoi(line, eoh, &p);
+  if (p == line)
+    return -1;
+  *nc = IO_strtoi(line = p, eoh, &p);
+  if (p == line)
+    return -1;
+  *nnz = IO_strtoi(line = p, eoh, &p);
+  if (p == line)
+    return -1;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Count the rows and non-zeros in a byte range of cluto rows, as well as the
+ *  lines and comment lines. The non-zeros of a row follow from its number of
+ *  fields. When deg is not NULL, the non-zeros of the k-th row counted are
+ *  also stored in deg[k]. */
+/*----------------------------------------------------------------------------*/
+static int
+cluto_count(char const * cur, char const * const end, uint64_t * const nrows,
+            uint64_t * const nnnz, uint64_t * const lines,
+            uint64_t * const comments, ind_t * const deg)
+{
+  intmax_t len;
+  char const * line;
+
+  while (0 < (len = IO_nextline(&cur, end, &line))) {
+    ++*lines;
+    if ('%' == line[0]) {
+      ++*comments;
+      continue;
+    }
+
+    size_t const ntok = IO_ntokens(line, line + len);
+    if (0 != ntok % 2)
+      return -1;
+
+    if (NULL != deg)
+      deg[*nrows] = (ind_t)(ntok / 2);
+
+    *nnnz += ntok / 2;
+    ++*nrows;
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse the index/value pairs of a cluto row into ja and a, of which there may
+ *  be at most max, and store their number in *n. The whole line must consist
+ *  of such pairs. */
+/*----------------------------------------------------------------------------*/
+static int
+cluto_pairs(char const * head, char const * const eol, ind_t const nc,
+            ind_t const max, ind_t * const ja, val_t * const a,
+            ind_t * const n)
+{
+  char const * tail;
+  ind_t k = 0;
+
+  for (head = IO_skipspace(head, eol); head < eol;
+       head = IO_skipspace(head, eol)) {
+    /* insist that the row has room for another non-zero */
+    if (k == max)
+      return -1;
+
+    /* parse the index and its corresponding value */
+    ind_t const ind = IO_strtoi(head, eol, &tail);
+    if (tail == head)
+      return -1;
+    val_t const val = IO_strtov(tail, eol, &head);
+    if (head == tail)
+      return -1;
+
+    /* insist that index is valid */
+    if (0 >= ind || ind > nc)
+      return -1;
+
+    /* record parsed values */
+    ja[k]  = ind - 1;
+    a[k++] = val;
+  }
+
+  *n = k;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse a byte range of cluto rows, starting at row i and non-zero j, into
+ *  their final positions, sorting each row as soon as it is parsed when buf is
+ *  not NULL. */
+/*----------------------------------------------------------------------------*/
+static int
+cluto_fill(char const * cur, char const * const end, ind_t const nc, ind_t i,
+           ind_t j, ind_t * const ia, ind_t * const ja, val_t * const a,
+           IO_sort * const buf)
+{
+  intmax_t len;
+  char const * line;
+
+  for (; 0 < (len = IO_nextline(&cur, end, &line)); i++) {
+    if ('%' == line[0]) {
+      i--;
+      continue;
+    }
+
+    char const * const eol = line + len;
+
+    /* ...the non-zeros reserved for this row by cluto_count... */
+    ind_t const deg = (ind_t)(IO_ntokens(line, eol) / 2);
+
+    ind_t n;
+    if (0 != cluto_pairs(line, eol, nc, deg, ja + j, a + j, &n) || n != deg)
+      return -1;
+
+    if (NULL != buf && 0 != IO_sort_row(n, ja + j, a + j, buf))
+      return -1;
+
+    j += n;
+
+    /* record the current number of non-zeros */
+    ia[i+1] = j;
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse a cluto file from an open input source. */
+/*----------------------------------------------------------------------------*/
+static int
+cluto_parse(IO_reader * const reader, Matrix * const M)
+{
+  /* ...garbage collected function... */
+  GC_func_init();
+
+  intmax_t len;
+  ind_t nr, nc, nnz;
+  char const * line;
+
+  reader->comment = '%';
+
+  /* read the file header */
+  GC_assert(0 == cluto_header(reader, &nr, &nc, &nnz));
+
+  IO_stats_phase(IO_PHASE_PARSE);
+
+  /* allocate memory for /M/ */
+  IO_csr csr;
+  GC_assert(0 == IO_csr_alloc(&csr, nr, nnz, 1, 0, 0));
+  GC_register_free(IO_csr_free, &csr);
+
+  ind_t * const ia = csr.ia;
+  ind_t * const ja = csr.ja;
+  val_t * const a  = csr.a;
+
+  int const nthreads = (NULL != reader->base) ? IO_nthreads() : 1;
+
+  /* ...placing the non-zeros needs the row pointers before the fill... */
+  if (1 < nthreads || (NULL != reader->base && IO_touch_on())) {
+    /* split the remaining lines into one newline-aligned range per thread */
+    char const ** const bounds = GC_malloc((nthreads + 1) * sizeof(*bounds));
+    GC_assert(0 == IO_reader_split(reader, nthreads, bounds));
+
+    /* count the rows and non-zeros of each range */
+    uint64_t * const rows = GC_calloc(nthreads + 1, sizeof(*rows));
+    uint64_t * const nzs  = GC_calloc(nthreads + 1, sizeof(*nzs));
+
+    int err = 0;
+    uint64_t lines = 0, comments = 0;
+    #pragma omp parallel for num_threads(nthreads) schedule(static, 1) \
+      reduction(|:err) reduction(+:lines,comments)
+    for (int t = 0; t < nthreads; t++) {
+      uint64_t tlines = 0, tcomments = 0;
+      err |= cluto_count(bounds[t], bounds[t+1], rows + t + 1, nzs + t + 1,
+                         &tlines, &tcomments, NULL);
+      lines    += tlines;
+      comments += tcomments;
+    }
+    GC_assert(0 == err);
+
+    reader->lines    += lines;
+    reader->comments += comments;
+
+    /* ...each range starts where the ranges before it end... */
+    for (int t = 0; t < nthreads; t++) {
+      rows[t+1] += rows[t];
+      nzs[t+1]  += nzs[t];
+    }
+
+    /* insist that correct number of values were read */
+    GC_assert((uint64_t)nr == rows[nthreads]);
+    GC_assert((uint64_t)nnz == nzs[nthreads]);
+
+    IO_stats_phase(IO_PHASE_BUILD);
+
+    if (IO_touch_on()) {
+      /* count again, recording the row lengths, to place the non-zeros */
+      #pragma omp parallel for num_threads(nthreads) schedule(static, 1) \
+        reduction(|:err)
+      for (int t = 0; t < nthreads; t++) {
+        uint64_t trows = 0, tnzs = 0, tlines = 0, tcomments = 0;
+        err |= cluto_count(bounds[t], bounds[t+1], &trows, &tnzs, &tlines,
+                           &tcomments, ia + 1 + rows[t]);
+      }
+      GC_assert(0 == err);
+
+      ia[0] = 0;
+      for (ind_t i = 0; i < nr; i++)
+        ia[i+1] += ia[i];
+      IO_touch_nnz(nr, ia, ja, a);
+    }
+
+    /* parse each range into its rows */
+    ia[0] = 0;
+    #pragma omp parallel for num_threads(nthreads) schedule(static, 1) \
+      reduction(|:err)
+    for (int t = 0; t < nthreads; t++) {
+      IO_sort buf = { NULL, NULL, 0 };
+      err |= cluto_fill(bounds[t], bounds[t+1], nc, (ind_t)rows[t],
+                        (ind_t)nzs[t], ia, ja, a, IO_opts.sort ? &buf : NULL);
+      IO_sort_free(&buf);
+    }
+    GC_assert(0 == err);
+
+    GC_free(nzs);
+    GC_free(rows);
+    GC_free(bounds);
+  } else {
+    IO_sort buf = { NULL, NULL, 0 };
+    GC_register_free(IO_sort_free, &buf);
+
+    /* read the sparse matrix file */
+    ind_t i = 0, j = 0;
+    ia[0] = 0;
+    while (0 < (len = getline_nc(reader, &line))) {
+      /* parse the line, insisting that not all non-zeros have already been
+       * read */
+      ind_t n;
+      GC_assert(0 == cluto_pairs(line, line + len, nc, nnz - j, ja + j, a + j,
+                                 &n));
+
+      /* insist that not all rows have already been read */
+      GC_assert(i < nr);
+
+      if (IO_opts.sort)
+        GC_assert(0 == IO_sort_row(n, ja + j, a + j, &buf));
+
+      j += n;
+
+      /* record the current number of non-zeros */
+      ia[++i] = j;
+    }
+
+    /* insist that correct number of values were read */
+    GC_assert(i == nr);
+    GC_assert(j == nnz);
+
+    GC_free(&buf);
+  }
+
+  /* record relevant info in /M/ */
+  /*M->fmt  = 0;*/
+  /*M->diag = 0;*/
+  M->sort   = IO_opts.sort ? ASC : NONE;
+  /*M->symm = 0;*/
+  M->nr     = nr;
+  M->nc     = nc;
+  M->nnz    = nnz;
+  /*M->ncon = 0;*/
+  M->ia     = ia;
+  M->ja     = ja;
+  M->a      = a;
+
+  return 0;
+}
+
 /*----------------------------------------------------------------------------*/
 /*! Function to read a cluto file. */
 /*----------------------------------------------------------------------------*/
+static int
+cluto_load(char const * const filename, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  /* open input file */
+  if (0 != IO_reader_open(&reader, filename))
+    return -1;
+
+  int const ret = cluto_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a cluto file, through the binary cache when enabled. */
+/*----------------------------------------------------------------------------*/
 EFIKA_EXPORT int
 IO_cluto_load(char const * const filename, Matrix * const M)
+{
+  return IO_cache_load(IO_CLUTO, filename, M, cluto_load);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a cluto file from descriptor fd, such as a pipe or socket,
+ *  which is read from its current position to its end and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_cluto_load_fd(int const fd, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_fd(&reader, fd))
+    return -1;
+
+  int const ret = cluto_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a cluto file from stream, which is read from its current
+ *  position to its end and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_cluto_load_stream(FILE * const stream, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_stream(&reader, stream))
+    return -1;
+
+  int const ret = cluto_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a cluto file from the len bytes at buf, which are parsed in
+ *  place and left untouched. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_cluto_load_mem(char const * const buf, size_t const len, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(buf, M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_mem(&reader, buf, len))
+    return -1;
+
+  int const ret = cluto_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to build the line-offset index of a cluto file, with an entry
+ *  every stride rows (a default when 0), in index (filename.idx when NULL). */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_cluto_index(char const * const filename, char const * const index,
+               size_t const stride)
+{
+  return IO_index_build(filename, index, stride, '%');
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read rows [r0, r1) of a cluto file into a matrix of r1-r0 rows
+ *  with global column indices. Reading starts from the nearest row recorded in
+ *  the index built by IO_cluto_index (filename.idx when NULL); without a usable
+ *  index, the preceding rows are skipped line by line. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_cluto_load_range(char const * const filename, char const * const index,
+                    ind_t const r0, ind_t const r1, Matrix * const M)
 {
   /* ...garbage collected function... */
   GC_func_init();
 
-  size_t n = 0;
+  intmax_t len;
   ind_t nr, nc, nnz;
-  char *line = NULL;
+  char const * line;
+  IO_reader reader;
 
   /* validate input */
-  if (!pp_all(filename, M))
+  if (!pp_all(filename, M) || r0 > r1)
     return -1;
 
-  /* register line with the garbage collector */
-  GC_register(&line);
-
   /* open input file */
-  FILE * istream = fopen(filename, "r");
-  GC_assert(istream);
-  GC_register_free(vfclose, istream);
-
-  /* get first non-comment line in file */
-  GC_assert(0 < getline_nc(&line, &n, istream));
+  GC_assert(0 == IO_reader_open(&reader, filename));
+  GC_register_free(IO_reader_close, &reader);
+  reader.comment = '%';
 
   /* read the file header */
-  GC_assert(3 == sscanf(line, PRIind" "PRIind" "PRIind"\n", &nr, &nc, &nnz));
+  GC_assert(0 == cluto_header(&reader, &nr, &nc, &nnz));
+  GC_assert(r1 <= nr);
 
-  /* allocate memory for /M/ */
-  ind_t * const ia = GC_malloc((nr + 1) * sizeof(*ia));
-  ind_t * const ja = GC_malloc(nnz * sizeof(*ja));
-  val_t * const a  = GC_malloc(nnz * sizeof(*a));
+  IO_stats_phase(IO_PHASE_PARSE);
 
-  /* read the sparse matrix file */
-  ind_t i = 0, j = 0;
-  ia[0] = 0;
-  while (0 < getline_nc(&line, &n, istream)) {
-    char *head = line, *tail;
+  /* skip to row r0, from the nearest indexed row if there is one */
+  ind_t first = r0;
+  if (r0 < r1 && 0 != IO_index_seek(&reader, filename, index, r0, &first))
+    first = 0;
+  for (ind_t i = first; i < r0; i++)
+    GC_assert(0 < getline_nc(&reader, &line));
 
-    /* parse the line */
-    while (1) {
-      /* parse the index and its corresponding value */
-      ind_t const ind = strtoi(head, &tail);
-      val_t const val = strtov(tail, &head);
-
-      /* no conversion took place, which means the end of the line or an error
-       * occurred */
-      if (head == tail) {
-        GC_assert(ERANGE != errno);
-        break;
-      }
+  IO_stats_phase(IO_PHASE_BUILD);
 
-      /* insist that not all non-zeros have already been read */
-      GC_assert(j < nnz);
+  /* ...start from the average share of the non-zeros... */
+  ind_t const n = r1 - r0;
+  ind_t cap = (ind_t)(0 < nr ? (uint64_t)nnz * n / nr : 0) + 1;
 
-      /* insist that index is valid */
-      GC_assert(0 < ind && ind <= nc);
+  /* allocate memory for /M/ */
+  ind_t * const ia = GC_malloc((n + 1) * sizeof(*ia));
+  ind_t * ja = GC_malloc(cap * sizeof(*ja));
+  val_t * a  = GC_malloc(cap * sizeof(*a));
 
-      /* record parsed values */
-      ja[j]  = ind - 1;
-      a[j++] = val;
+  IO_sort buf = { NULL, NULL, 0 };
+  GC_register_free(IO_sort_free, &buf);
+
+  /* read the requested rows */
+  ind_t j = 0;
+  ia[0] = 0;
+  for (ind_t i = 0; i < n; i++) {
+    GC_assert(0 < (len = getline_nc(&reader, &line)));
+
+    char const * const eol = line + len;
+
+    /* ...room for every pair the line may hold... */
+    ind_t const deg = (ind_t)(IO_ntokens(line, eol) / 2);
+    if (j + deg > cap) {
+      while (j + deg > cap)
+        cap *= 2;
+      ja = GC_realloc(ja, cap * sizeof(*ja));
+      a  = GC_realloc(a, cap * sizeof(*a));
     }
 
-    /* insist that not all rows have already been read */
-    GC_assert(i <= nr);
+    /* parse the line */
+    ind_t m;
+    GC_assert(0 == cluto_pairs(line, eol, nc, deg, ja + j, a + j, &m));
+
+    if (IO_opts.sort)
+      GC_assert(0 == IO_sort_row(m, ja + j, a + j, &buf));
+
+    j += m;
 
     /* record the current number of non-zeros */
-    ia[++i] = j;
+    ia[i + 1] = j;
   }
 
-  /* insist that correct number of values were read */
-  GC_assert(i == nr);
-  GC_assert(j == nnz);
+  GC_free(&buf);
+
+  /* ...the size is only known now, so that is when a slab can be made... */
+  IO_csr csr = { ia, ja, a, NULL, NULL, 0 };
+  GC_assert(0 == IO_slab_pack(&csr, n, j, 0));
 
   /* record relevant info in /M/ */
   /*M->fmt  = 0;*/
   /*M->diag = 0;*/
-  M->sort   = NONE;
+  M->sort   = IO_opts.sort ? ASC : NONE;
   /*M->symm = 0;*/
-  M->nr     = nr;
+  M->nr     = n;
   M->nc     = nc;
-  M->nnz    = nnz;
+  M->nnz    = j;
   /*M->ncon = 0;*/
-  M->ia     = ia;
-  M->ja     = ja;
-  M->a      = a;
+  M->ia     = csr.ia;
+  M->ja     = csr.ja;
+  M->a      = csr.a;
+
+  GC_free(&reader);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse the next row of a cluto file into a row block. */
+/*----------------------------------------------------------------------------*/
+static int
+cluto_row(IO_Rows * const rows, size_t const i)
+{
+  intmax_t len;
+  char const * line;
+
+  (void)i;
+
+  if (0 >= (len = getline_nc(&rows->reader, &line))) {
+    /* insist that correct number of values were read */
+    return (rows->r == rows->nr && rows->nnnz == rows->hnnz) ? 1 : -1;
+  }
+
+  /* insist that not all rows have already been read */
+  if (rows->r == rows->nr)
+    return -1;
+
+  char const * const eol = line + len;
+
+  /* ...room for every pair the line may hold... */
+  if (0 != IO_rows_room(rows, IO_ntokens(line, eol) / 2))
+    return -1;
+
+  /* parse the line, insisting that not all non-zeros have already been read */
+  ind_t n;
+  if (0 != cluto_pairs(line, eol, rows->nc, rows->hnnz - rows->nnnz,
+                       rows->ja + rows->nnz, rows->a + rows->nnz, &n))
+    return -1;
+
+  rows->nnz  += n;
+  rows->nnnz += n;
 
-  GC_free(istream);
-  GC_free(line);
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to open a cluto file for reading in blocks of rows. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_cluto_open(char const * const filename, size_t const blksz,
+              IO_Rows ** const rows)
+{
+  if (0 != IO_rows_init(rows, filename, blksz, cluto_row))
+    return -1;
+
+  IO_Rows * const r = *rows;
+  r->reader.comment = '%';
+
+  /* read the file header */
+  if (0 != cluto_header(&r->reader, &r->nr, &r->nc, &r->hnnz))
+    goto error;
+
+  r->vals = 1;
 
   return 0;
+
+  error:
+  IO_rows_close(r);
+  *rows = NULL;
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Format rows [r0, r1) of a cluto file. */
+/*----------------------------------------------------------------------------*/
+static void
+cluto_rows(IO_writer * const writer, Matrix const * const M, ind_t const r0,
+           ind_t const r1)
+{
+  /* unpack /M/ */
+  ind_t const * const ia = M->ia;
+  ind_t const * const ja = M->ja;
+  val_t const * const a  = M->a;
+
+  for (ind_t i = r0; i < r1; i++) {
+    for (ind_t j = ia[i]; j < ia[i + 1]; j++) {
+      IO_writer_puti(writer, ja[j]+1);
+      IO_writer_putc(writer, ' ');
+      IO_writer_putv(writer, a[j]);
+      IO_writer_putc(writer, ' ');
+    }
+    IO_writer_putc(writer, '\n');
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a cluto file to an output sink, closing it. */
+/*----------------------------------------------------------------------------*/
+static int
+cluto_write(IO_writer * const writer, Matrix const * const M)
+{
+  IO_stats_phase(IO_PHASE_WRITE);
+
+  /* unpack /M/ */
+  ind_t const nr  = M->nr;
+  ind_t const nc  = M->nc;
+  ind_t const nnz = M->nnz;
+
+  IO_writer_printf(writer, PRIind" "PRIind" "PRIind"\n", nr, nc, nnz);
+
+  (void)IO_writer_rows(writer, M, cluto_rows);
+
+  /* ... */
+  return IO_writer_close(writer);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -140,33 +666,54 @@ IO_cluto_load(char const * const filename, Matrix * const M)
 EFIKA_EXPORT int
 IO_cluto_save(char const * const filename, Matrix const * const M)
 {
+  IO_writer writer;
+
   /* validate input */
   if (!pp_all(filename, M))
     return -1;
 
   /* open output file */
-  FILE * ostream = fopen(filename, "w");
-  if (!ostream)
+  if (0 != IO_writer_open(&writer, filename))
     return -1;
 
-  /* unpack /M/ */
-  ind_t const nr  = M->nr;
-  ind_t const nc  = M->nc;
-  ind_t const nnz = M->nnz;
-  ind_t const * const ia = M->ia;
-  ind_t const * const ja = M->ja;
-  val_t const * const a  = M->a;
+  return cluto_write(&writer, M);
+}
 
-  fprintf(ostream, PRIind" "PRIind" "PRIind"\n", nr, nc, nnz);
+/*----------------------------------------------------------------------------*/
+/*! Function to write a cluto file to descriptor fd, such as a pipe or socket,
+ *  which is left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_cluto_save_fd(int const fd, Matrix const * const M)
+{
+  IO_writer writer;
 
-  for (ind_t i = 0; i < nr; i++) {
-    for (ind_t j = ia[i]; j < ia[i + 1]; j++)
-      fprintf(ostream, PRIind" "PRIval" ", ja[j]+1, a[j]);
-    fprintf(ostream, "\n");
-  }
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
 
-  /* ... */
-  fclose(ostream);
+  /* open output sink */
+  if (0 != IO_writer_open_fd(&writer, fd))
+    return -1;
 
-  return 0;
+  return cluto_write(&writer, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a cluto file to stream, which is flushed but left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_cluto_save_stream(FILE * const stream, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  /* open output sink */
+  if (0 != IO_writer_open_stream(&writer, stream))
+    return -1;
+
+  return cluto_write(&writer, M);
 }
@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: MIT */
+#include <string.h>
+
+#include "efika/core.h"
+
+#include "efika/io/coo.h"
+#include "efika/io/rename.h"
+#include "efika/io/touch.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Convert n staged (0-based) coordinate entries into CSR with a stable
+ *  counting sort, so entries within a row keep their staging order. When symm
+ *  is non-zero, each entry (u,v) off the diagonal also produces (v,u)
+ *  immediately after it. ia must have room for nr+1 entries, ja and a for
+ *  every entry produced. w and a may be NULL. */
+/*----------------------------------------------------------------------------*/
+void
+IO_coo_csr(ind_t const nr, ind_t const n, ind_t const * const u,
+           ind_t const * const v, val_t const * const w, int const symm,
+           ind_t * const ia, ind_t * const ja, val_t * const a)
+{
+  ind_t i, k;
+
+  /* count the non-zeros per row */
+  memset(ia, 0, (nr + 1) * sizeof(*ia));
+  for (k = 0; k < n; k++) {
+    ia[u[k]+1]++;
+    if (0 != symm && u[k] != v[k])
+      ia[v[k]+1]++;
+  }
+
+  for (i = 1; i <= nr; i++)
+    ia[i] += ia[i-1];
+
+  /* ...ia[i] is now where row i starts, so its non-zeros can be placed... */
+  IO_touch_nnz(nr, ia, ja, a);
+
+  /* scatter, using ia[i] as the insertion point of row i */
+  for (k = 0; k < n; k++) {
+    if (NULL != a)
+      a[ia[u[k]]] = w[k];
+    ja[ia[u[k]]++] = v[k];
+    if (0 != symm && u[k] != v[k]) {
+      if (NULL != a)
+        a[ia[v[k]]] = w[k];
+      ja[ia[v[k]]++] = u[k];
+    }
+  }
+
+  /* ...which has shifted every row pointer forward by one row */
+  for (i = nr; i > 0; i--)
+    ia[i] = ia[i-1];
+  ia[0] = 0;
+}
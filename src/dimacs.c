@@ -6,6 +6,58 @@
 
 #include "efika/core/pp.h"
 #include "efika/io/rename.h"
+#include "efika/io/stats.h"
+#include "efika/io/writer.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Format rows [r0, r1) of a dimacs file. */
+/*----------------------------------------------------------------------------*/
+static void
+dimacs_rows(IO_writer * const writer, Matrix const * const M, ind_t const r0,
+            ind_t const r1)
+{
+  /* unpack /M/ */
+  int   const fmt = M->fmt;
+  ind_t const * const ia = M->ia;
+  ind_t const * const ja = M->ja;
+  val_t const * const a  = M->a;
+
+  for (ind_t i = r0; i < r1; i++) {
+    for (ind_t j = ia[i]; j < ia[i + 1]; j++) {
+      IO_writer_puts(writer, has_adjwgt(fmt) ? "a " : "e ");
+      IO_writer_puti(writer, i+1);
+      IO_writer_putc(writer, ' ');
+      IO_writer_puti(writer, ja[j]+1);
+      if (has_adjwgt(fmt)) {
+        IO_writer_putc(writer, ' ');
+        IO_writer_putv(writer, a[j]);
+      }
+      IO_writer_putc(writer, '\n');
+    }
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a dimacs file to an output sink, closing it. */
+/*----------------------------------------------------------------------------*/
+static int
+dimacs_write(IO_writer * const writer, Matrix const * const M)
+{
+  IO_stats_phase(IO_PHASE_WRITE);
+
+  /* unpack /M/ */
+  int   const fmt = M->fmt;
+  ind_t const nr  = M->nr;
+  ind_t const nnz = M->nnz;
+
+  IO_writer_printf(writer, "p %s "PRIind" "PRIind"\n",
+    has_adjwgt(fmt) ? "sp" : "edge", nr, nnz);
+
+  (void)IO_writer_rows(writer, M, dimacs_rows);
+
+  /* ... */
+  return IO_writer_close(writer);
+}
 
 /*----------------------------------------------------------------------------*/
 /*! Function to write a dimacs file. */
@@ -13,37 +65,55 @@
 EFIKA_EXPORT int
 IO_dimacs_save(char const * const filename, Matrix const * const M)
 {
+  IO_writer writer;
+
   /* validate input */
   if (!pp_all(filename, M))
     return -1;
 
   /* open output file */
-  FILE * ostream = fopen(filename, "w");
-  if (!ostream)
+  if (0 != IO_writer_open(&writer, filename))
     return -1;
 
-  /* unpack /M/ */
-  int   const fmt = M->fmt;
-  ind_t const nr  = M->nr;
-  ind_t const nnz = M->nnz;
-  ind_t const * const ia = M->ia;
-  ind_t const * const ja = M->ja;
-  val_t const * const a  = M->a;
+  return dimacs_write(&writer, M);
+}
 
-  fprintf(ostream, "p %s "PRIind" "PRIind"\n",
-    has_adjwgt(fmt) ? "sp" : "edge", nr, nnz);
+/*----------------------------------------------------------------------------*/
+/*! Function to write a dimacs file to descriptor fd, such as a pipe or socket,
+ *  which is left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_dimacs_save_fd(int const fd, Matrix const * const M)
+{
+  IO_writer writer;
 
-  for (ind_t i = 0; i < nr; i++) {
-    for (ind_t j = ia[i]; j < ia[i + 1]; j++) {
-      if (has_adjwgt(fmt))
-        fprintf(ostream, "a "PRIind" "PRIind" "PRIval"\n", i+1, ja[j]+1, a[j]);
-      else
-        fprintf(ostream, "e "PRIind" "PRIind"\n", i+1, ja[j]+1);
-    }
-  }
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
 
-  /* ... */
-  fclose(ostream);
+  /* open output sink */
+  if (0 != IO_writer_open_fd(&writer, fd))
+    return -1;
+
+  return dimacs_write(&writer, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a dimacs file to stream, which is flushed but left open.
+ *  */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_dimacs_save_stream(FILE * const stream, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  /* open output sink */
+  if (0 != IO_writer_open_stream(&writer, stream))
+    return -1;
 
-  return 0;
+  return dimacs_write(&writer, M);
 }
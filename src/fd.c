@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: MIT */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+
+#if defined(HAVE_DUP) && defined(HAVE_FDOPEN)
+# include <unistd.h>
+#elif defined(_WIN32)
+# include <io.h>
+# define dup    _dup
+# define close  _close
+# define fdopen _fdopen
+# define HAVE_DUP    1
+# define HAVE_FDOPEN 1
+#endif
+
+#include "efika/io/fd.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Duplicate a descriptor of the caller, so that it can be handed to code that
+ *  closes what it reads from or writes to, leaving the caller's descriptor
+ *  open. Returns -1 when descriptors cannot be duplicated. */
+/*----------------------------------------------------------------------------*/
+int
+IO_fd_dup(int const fd)
+{
+#if defined(HAVE_DUP) && defined(HAVE_FDOPEN)
+  return (0 > fd) ? -1 : dup(fd);
+#else
+  (void)fd;
+  return -1;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Close a descriptor obtained from IO_fd_dup. */
+/*----------------------------------------------------------------------------*/
+int
+IO_fd_close(int const fd)
+{
+#if defined(HAVE_DUP) && defined(HAVE_FDOPEN)
+  return close(fd);
+#else
+  (void)fd;
+  return -1;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Open a stream, with the given fopen mode, on a duplicate of a descriptor of
+ *  the caller, so that closing the stream leaves the caller's descriptor open.
+ *  The stream starts at the descriptor's current position. */
+/*----------------------------------------------------------------------------*/
+FILE *
+IO_fd_open(int const fd, char const * const mode)
+{
+#if defined(HAVE_DUP) && defined(HAVE_FDOPEN)
+  int const dfd = IO_fd_dup(fd);
+  if (-1 == dfd)
+    return NULL;
+
+  FILE * const stream = fdopen(dfd, mode);
+  if (NULL == stream)
+    (void)close(dfd);
+
+  return stream;
+#else
+  (void)fd;
+  (void)mode;
+  return NULL;
+#endif
+}
@@ -0,0 +1,859 @@
+/* SPDX-License-Identifier: MIT */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/core/gc.h"
+#include "efika/core/pp.h"
+#include "efika/io/fd.h"
+#include "efika/io/gap.h"
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+#include "efika/io/slab.h"
+#include "efika/io/stats.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Random access reader of a gap-compressed file. */
+/*----------------------------------------------------------------------------*/
+struct EFIKA_IO_Gap {
+  IO_gap_header   hdr;
+  IO_gap_entry *  idx;  /*!< row index */
+  unsigned char * data; /*!< encoded adjacency */
+  val_t *         a;    /*!< values, NULL if the file has none */
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Encode x as a varint at p, or only measure it when p is NULL. Returns the
+ *  number of bytes. */
+/*----------------------------------------------------------------------------*/
+static inline size_t
+gap_putv(unsigned char * const p, uint64_t x)
+{
+  size_t n = 0;
+
+  for (; x >= 0x80; x >>= 7, n++)
+    if (p)
+      p[n] = (unsigned char)(x | 0x80);
+  if (p)
+    p[n] = (unsigned char)x;
+
+  return n + 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Decode the varint at *p, which must end before end. */
+/*----------------------------------------------------------------------------*/
+static inline int
+gap_getv(unsigned char const ** const p, unsigned char const * const end,
+         uint64_t * const x)
+{
+  uint64_t v = 0;
+
+  for (int s = 0; s < 64; s += 7) {
+    if (*p == end)
+      return -1;
+
+    unsigned const b = *(*p)++;
+
+    v |= (uint64_t)(b & 0x7f) << s;
+    if (!(b & 0x80)) {
+      *x = v;
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Skip n varints at *p, which must end before end. */
+/*----------------------------------------------------------------------------*/
+static inline int
+gap_skip(unsigned char const ** const p, unsigned char const * const end,
+         uint64_t n)
+{
+  unsigned char const * q = *p;
+
+  for (; n && q < end; q++)
+    if (!(*q & 0x80))
+      n--;
+
+  *p = q;
+
+  return n ? -1 : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Encode row i, with n ascending column indices ja, at p, or only measure it
+ *  when p is NULL. Returns the number of bytes. */
+/*----------------------------------------------------------------------------*/
+static size_t
+gap_encode(unsigned char * const p, ind_t const i, ind_t const * const ja,
+           ind_t const n)
+{
+  size_t len = gap_putv(p, n);
+
+  for (ind_t j = 0; j < n; j++) {
+    uint64_t x;
+
+    if (0 == j) {
+      int64_t const d = (int64_t)ja[0] - (int64_t)i;
+      x = (0 > d) ? ((uint64_t)-(d + 1) << 1) | 1 : (uint64_t)d << 1;
+    } else {
+      x = (uint64_t)(ja[j] - ja[j - 1]);
+    }
+
+    len += gap_putv(p ? p + len : NULL, x);
+  }
+
+  return len;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Decode the n column indices of row i at *p into ja, insisting that each is
+ *  less than nc. */
+/*----------------------------------------------------------------------------*/
+static int
+gap_decode(unsigned char const ** const p, unsigned char const * const end,
+           uint64_t const i, uint64_t const nc, uint64_t const n,
+           ind_t * const ja)
+{
+  uint64_t x, c = 0;
+
+  for (uint64_t j = 0; j < n; j++) {
+    if (0 != gap_getv(p, end, &x))
+      return -1;
+
+    if (0 == j) {
+      uint64_t const d = x >> 1;
+
+      if (x & 1) {
+        if (d >= i)
+          return -1;
+        c = i - d - 1;
+      } else {
+        if (d >= nc)
+          return -1;
+        c = i + d;
+      }
+    } else {
+      if (x >= nc - c)
+        return -1;
+      c += x;
+    }
+
+    if (c >= nc)
+      return -1;
+
+    ja[j] = (ind_t)c;
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Number of entries in the row index. */
+/*----------------------------------------------------------------------------*/
+static inline uint64_t
+gap_nidx(IO_gap_header const * const hdr)
+{
+  return (hdr->nr + (uint64_t)hdr->stride - 1) / (uint64_t)hdr->stride + 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Byte length of each array of a matrix described by a header. */
+/*----------------------------------------------------------------------------*/
+static void
+gap_lengths(IO_gap_header const * const hdr, uint64_t * const len)
+{
+  len[0] = gap_nidx(hdr) * sizeof(IO_gap_entry);
+  len[1] = hdr->dlen;
+  len[2] = hdr->off[2] ? hdr->nnz * sizeof(val_t) : 0;
+  len[3] = hdr->off[3] ? hdr->ncon * hdr->nr * sizeof(val_t) : 0;
+  len[4] = hdr->off[4] ? hdr->nr * sizeof(ind_t) : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Validate a header against this build and the size of its file. */
+/*----------------------------------------------------------------------------*/
+static int
+gap_check(IO_gap_header const * const hdr, uint64_t const size)
+{
+  uint64_t len[5];
+
+  if (0 != memcmp(hdr->magic, IO_GAP_MAGIC, sizeof(hdr->magic)) ||
+      IO_GAP_VERSION != hdr->version || IO_GAP_BOM != hdr->bom ||
+      sizeof(ind_t) != hdr->indsize || sizeof(val_t) != hdr->valsize ||
+      0 == hdr->align || 0 != hdr->align % sizeof(uint64_t) ||
+      0 >= hdr->stride || size < hdr->size)
+    return -1;
+
+  /* insist that the dimensions are representable */
+  if ((uint64_t)(ind_t)hdr->nr != hdr->nr ||
+      (uint64_t)(ind_t)hdr->nc != hdr->nc ||
+      (uint64_t)(ind_t)hdr->nnz != hdr->nnz ||
+      (uint64_t)(ind_t)hdr->ncon != hdr->ncon ||
+      (uint64_t)(size_t)hdr->dlen != hdr->dlen)
+    return -1;
+
+  /* insist that arrays are aligned, ordered and inside the file */
+  gap_lengths(hdr, len);
+  uint64_t end = sizeof(*hdr);
+  for (int k = 0; k < 5; k++) {
+    if (0 == hdr->off[k]) {
+      if (2 > k)
+        return -1;
+      continue;
+    }
+    if (hdr->off[k] < end || 0 != hdr->off[k] % hdr->align ||
+        hdr->off[k] > hdr->size || hdr->size - hdr->off[k] < len[k])
+      return -1;
+    end = hdr->off[k] + len[k];
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Validate the row index against its header. */
+/*----------------------------------------------------------------------------*/
+static int
+gap_check_index(IO_gap_header const * const hdr,
+                IO_gap_entry const * const idx)
+{
+  uint64_t const nidx = gap_nidx(hdr);
+
+  if (0 != idx[0].pos || 0 != idx[0].nnz ||
+      hdr->dlen != idx[nidx - 1].pos || hdr->nnz != idx[nidx - 1].nnz)
+    return -1;
+
+  for (uint64_t k = 1; k < nidx; k++)
+    if (idx[k].pos < idx[k - 1].pos || idx[k].nnz < idx[k - 1].nnz)
+      return -1;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Read len bytes at file offset off, skipping forward from *pos, so that
+ *  non-seekable streams can be read. */
+/*----------------------------------------------------------------------------*/
+static int
+gap_read(FILE * const istream, uint64_t * const pos, uint64_t const off,
+         void * const buf, uint64_t const len)
+{
+  char skip[IO_GAP_ALIGN];
+
+  while (*pos < off) {
+    size_t const n = off - *pos < sizeof(skip) ? off - *pos : sizeof(skip);
+    if (n != fread(skip, 1, n, istream))
+      return -1;
+    *pos += n;
+  }
+
+  if (len != fread(buf, 1, len, istream))
+    return -1;
+  *pos += len;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write len bytes at file offset off, zero-filling forward from *pos. */
+/*----------------------------------------------------------------------------*/
+static int
+gap_write(FILE * const ostream, uint64_t * const pos, uint64_t const off,
+          void const * const buf, uint64_t const len)
+{
+  static char const zero[IO_GAP_ALIGN] = { 0 };
+
+  while (*pos < off) {
+    size_t const n = off - *pos < sizeof(zero) ? off - *pos : sizeof(zero);
+    if (n != fwrite(zero, 1, n, ostream))
+      return -1;
+    *pos += n;
+  }
+
+  if (len && len != fwrite(buf, 1, len, ostream))
+    return -1;
+  *pos += len;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Decode the rows of stride k into ia and ja. */
+/*----------------------------------------------------------------------------*/
+static int
+gap_stride(IO_gap_header const * const hdr, unsigned char const * const data,
+           IO_gap_entry const * const idx, uint64_t const k, ind_t * const ia,
+           ind_t * const ja)
+{
+  uint64_t const r0 = k * (uint64_t)hdr->stride;
+  uint64_t const r1 = hdr->nr - r0 < (uint64_t)hdr->stride
+                    ? hdr->nr : r0 + (uint64_t)hdr->stride;
+  unsigned char const * p = data + idx[k].pos;
+  unsigned char const * const end = data + idx[k + 1].pos;
+  uint64_t n = idx[k].nnz, deg;
+
+  for (uint64_t i = r0; i < r1; i++) {
+    if (0 != gap_getv(&p, end, &deg) || deg > idx[k + 1].nnz - n ||
+        0 != gap_decode(&p, end, i, hdr->nc, deg, ja + n))
+      return -1;
+
+    n += deg;
+    ia[i + 1] = (ind_t)n;
+  }
+
+  /* insist that the stride was consumed exactly */
+  return (p == end && n == idx[k + 1].nnz) ? 0 : -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Order entries by column index. */
+/*----------------------------------------------------------------------------*/
+typedef struct gap_pair {
+  ind_t j;
+  val_t v;
+} gap_pair;
+
+static int
+gap_cmp(void const * const x, void const * const y)
+{
+  ind_t const a = ((gap_pair const *)x)->j;
+  ind_t const b = ((gap_pair const *)y)->j;
+  return (a > b) - (a < b);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Whether the rows of /M/ are known or found to be in ascending order. */
+/*----------------------------------------------------------------------------*/
+static int
+gap_sorted(Matrix const * const M)
+{
+  if (ASC == M->sort)
+    return 1;
+
+  for (ind_t i = 0; i < M->nr; i++)
+    for (ind_t j = M->ia[i] + 1; j < M->ia[i + 1]; j++)
+      if (M->ja[j - 1] > M->ja[j])
+        return 0;
+
+  return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Copy the rows of /M/ into ja and a (if not NULL) in ascending order. */
+/*----------------------------------------------------------------------------*/
+static int
+gap_sort(Matrix const * const M, ind_t * const ja, val_t * const a)
+{
+  size_t cap = 0;
+  gap_pair * tmp = NULL;
+
+  for (ind_t i = 0; i < M->nr; i++) {
+    ind_t const j0 = M->ia[i], n = M->ia[i + 1] - j0;
+
+    if (n > cap) {
+      gap_pair * const t = realloc(tmp, n * sizeof(*tmp));
+      if (NULL == t) {
+        free(tmp);
+        return -1;
+      }
+      tmp = t;
+      cap = n;
+    }
+
+    for (ind_t j = 0; j < n; j++) {
+      tmp[j].j = M->ja[j0 + j];
+      tmp[j].v = a ? M->a[j0 + j] : 0;
+    }
+
+    qsort(tmp, n, sizeof(*tmp), gap_cmp);
+
+    for (ind_t j = 0; j < n; j++) {
+      ja[j0 + j] = tmp[j].j;
+      if (a)
+        a[j0 + j] = tmp[j].v;
+    }
+  }
+
+  free(tmp);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Read a gap-compressed file from istream, which is only read forward and
+ *  is left open. */
+/*----------------------------------------------------------------------------*/
+static int
+gap_fload(FILE * const istream, Matrix * const M)
+{
+  /* ...garbage collected function... */
+  GC_func_init();
+
+  uint64_t pos = 0, len[5];
+  IO_gap_header hdr;
+
+  /* read and validate header */
+  GC_assert(0 == gap_read(istream, &pos, 0, &hdr, sizeof(hdr)));
+  GC_assert(0 == gap_check(&hdr, UINT64_MAX));
+  gap_lengths(&hdr, len);
+
+  IO_stats_phase(IO_PHASE_PARSE);
+
+  /* allocate memory for /M/ */
+  IO_gap_entry * const idx = GC_malloc(len[0]);
+  unsigned char * const data = GC_malloc(len[1] + 1);
+  IO_csr csr;
+  GC_assert(0 == IO_csr_alloc(&csr, (ind_t)hdr.nr, (ind_t)hdr.nnz,
+                              0 != hdr.off[2],
+                              hdr.off[3] ? (ind_t)hdr.ncon : 0,
+                              0 != hdr.off[4]));
+  GC_register_free(IO_csr_free, &csr);
+
+  ind_t * const ia   = csr.ia;
+  ind_t * const ja   = csr.ja;
+  val_t * const a    = csr.a;
+  val_t * const vwgt = csr.vwgt;
+  ind_t * const vsiz = csr.vsiz;
+
+  /* read arrays in file order */
+  GC_assert(0 == gap_read(istream, &pos, hdr.off[0], idx, len[0]));
+  GC_assert(0 == gap_read(istream, &pos, hdr.off[1], data, len[1]));
+  if (a)
+    GC_assert(0 == gap_read(istream, &pos, hdr.off[2], a, len[2]));
+  if (vwgt)
+    GC_assert(0 == gap_read(istream, &pos, hdr.off[3], vwgt, len[3]));
+  if (vsiz)
+    GC_assert(0 == gap_read(istream, &pos, hdr.off[4], vsiz, len[4]));
+
+  GC_assert(0 == gap_check_index(&hdr, idx));
+
+  IO_stats_phase(IO_PHASE_BUILD);
+
+  /* decode each stride independently */
+  ind_t const nstride = (ind_t)(gap_nidx(&hdr) - 1);
+  int err = 0;
+  #pragma omp parallel for num_threads(IO_nthreads()) schedule(dynamic, 64) \
+    reduction(|:err)
+  for (ind_t k = 0; k < nstride; k++)
+    err |= gap_stride(&hdr, data, idx, k, ia, ja);
+  GC_assert(0 == err);
+
+  ia[0] = 0;
+
+  GC_free(data);
+  GC_free(idx);
+
+  M->fmt   = hdr.fmt;
+  /*M->diag  = 0;*/
+  M->sort  = ASC;
+  M->symm  = hdr.symm;
+  M->nr    = (ind_t)hdr.nr;
+  M->nc    = (ind_t)hdr.nc;
+  M->nnz   = (ind_t)hdr.nnz;
+  M->ncon  = (ind_t)hdr.ncon;
+  M->ia    = ia;
+  M->ja    = ja;
+  M->a     = a;
+  M->vwgt  = vwgt;
+  M->vsiz  = vsiz;
+
+  if (NULL != IO_stats.stats)
+    IO_stats.stats->bytes += pos;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a gap-compressed file. The rows of /M/ are sorted. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_gap_load(char const * const filename, Matrix * const M)
+{
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  /* open input file */
+  FILE * const istream = fopen(filename, "rb");
+  if (!istream)
+    return -1;
+
+  int const ret = gap_fload(istream, M);
+  (void)fclose(istream);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a gap-compressed file from descriptor fd, such as a pipe or
+ *  socket, which is read from its current position and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_gap_load_fd(int const fd, Matrix * const M)
+{
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open input source */
+  FILE * const istream = IO_fd_open(fd, "rb");
+  if (!istream)
+    return -1;
+
+  int const ret = gap_fload(istream, M);
+  (void)fclose(istream);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a gap-compressed file from stream, which must have been
+ *  opened in binary mode, and is read from its current position and left open.
+ *  */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_gap_load_stream(FILE * const stream, Matrix * const M)
+{
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  return gap_fload(stream, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to open a gap-compressed file for random access to its rows. The
+ *  index, encoded adjacency and values are kept in memory. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_gap_open(char const * const filename, IO_Gap ** const gap)
+{
+  uint64_t pos = 0, len[5];
+
+  /* validate input */
+  if (!pp_all(filename, gap))
+    return -1;
+
+  IO_Gap * const g = calloc(1, sizeof(*g));
+  if (NULL == g)
+    return -1;
+
+  FILE * const istream = fopen(filename, "rb");
+  if (NULL == istream)
+    goto error;
+
+  if (0 != gap_read(istream, &pos, 0, &g->hdr, sizeof(g->hdr)) ||
+      0 != gap_check(&g->hdr, UINT64_MAX))
+    goto error;
+
+  gap_lengths(&g->hdr, len);
+  if ((uint64_t)(size_t)len[0] != len[0] || (uint64_t)(size_t)len[2] != len[2])
+    goto error;
+
+  g->idx  = malloc(len[0]);
+  g->data = malloc(len[1] + 1);
+  if (NULL == g->idx || NULL == g->data)
+    goto error;
+  if (g->hdr.off[2] && NULL == (g->a = malloc(len[2])))
+    goto error;
+
+  if (0 != gap_read(istream, &pos, g->hdr.off[0], g->idx, len[0]) ||
+      0 != gap_read(istream, &pos, g->hdr.off[1], g->data, len[1]) ||
+      (g->a && 0 != gap_read(istream, &pos, g->hdr.off[2], g->a, len[2])) ||
+      0 != gap_check_index(&g->hdr, g->idx))
+    goto error;
+
+  (void)fclose(istream);
+
+  *gap = g;
+
+  return 0;
+
+  error:
+  if (NULL != istream)
+    (void)fclose(istream);
+  IO_gap_close(g);
+  *gap = NULL;
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to get the dimensions and format of a gap-compressed file. Any of
+ *  the outputs may be NULL. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT void
+IO_gap_info(IO_Gap const * const gap, ind_t * const nr, ind_t * const nc,
+            ind_t * const nnz, int * const fmt)
+{
+  if (!pp_all(gap))
+    return;
+
+  if (NULL != nr)
+    *nr = (ind_t)gap->hdr.nr;
+  if (NULL != nc)
+    *nc = (ind_t)gap->hdr.nc;
+  if (NULL != nnz)
+    *nnz = (ind_t)gap->hdr.nnz;
+  if (NULL != fmt)
+    *fmt = gap->hdr.fmt;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to decode row i of a gap-compressed file. Its length is stored in
+ *  *deg, its column indices (in ascending order) in ja and its values in a,
+ *  when these are not NULL; a is left untouched if the file has no values. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_gap_row(IO_Gap const * const gap, ind_t const i, ind_t * const deg,
+           ind_t * const ja, val_t * const a)
+{
+  uint64_t d;
+
+  /* validate input */
+  if (!pp_all(gap, deg))
+    return -1;
+
+  /* unpack /gap/ */
+  IO_gap_header const * const hdr = &gap->hdr;
+  IO_gap_entry const * const idx = gap->idx;
+
+  if ((uint64_t)i >= hdr->nr)
+    return -1;
+
+  uint64_t const k = (uint64_t)i / (uint64_t)hdr->stride;
+  unsigned char const * p = gap->data + idx[k].pos;
+  unsigned char const * const end = gap->data + idx[k + 1].pos;
+  uint64_t n = idx[k].nnz;
+
+  /* skip the preceding rows of the stride */
+  for (uint64_t r = k * (uint64_t)hdr->stride; r < (uint64_t)i; r++) {
+    if (0 != gap_getv(&p, end, &d) || d > hdr->nnz - n ||
+        0 != gap_skip(&p, end, d))
+      return -1;
+    n += d;
+  }
+
+  if (0 != gap_getv(&p, end, &d) || d > hdr->nnz - n)
+    return -1;
+
+  if (NULL != ja && 0 != gap_decode(&p, end, i, hdr->nc, d, ja))
+    return -1;
+
+  if (NULL != a && NULL != gap->a)
+    memcpy(a, gap->a + n, d * sizeof(*a));
+
+  *deg = (ind_t)d;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to close a gap-compressed file opened with IO_gap_open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT void
+IO_gap_close(IO_Gap * const gap)
+{
+  if (NULL == gap)
+    return;
+
+  free(gap->idx);
+  free(gap->data);
+  free(gap->a);
+  free(gap);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a gap-compressed file to ostream, which is written in order and
+ *  flushed, but left open. */
+/*----------------------------------------------------------------------------*/
+static int
+gap_fsave(FILE * const ostream, Matrix const * const M)
+{
+  /* ...garbage collected function... */
+  GC_func_init();
+
+  uint64_t pos = 0, len[5];
+  IO_gap_header hdr;
+
+  /* unpack /M/ */
+  ind_t const nr = M->nr;
+  ind_t const * const ia = M->ia;
+  ind_t const * ja = M->ja;
+  val_t const * a  = M->a;
+
+  /* ...gaps are only non-negative within sorted rows... */
+  if (!gap_sorted(M)) {
+    ind_t * const sja = GC_malloc(M->nnz * sizeof(*sja));
+    val_t * const sa  = a ? GC_malloc(M->nnz * sizeof(*sa)) : NULL;
+    GC_assert(0 == gap_sort(M, sja, sa));
+    ja = sja;
+    a  = sa;
+  }
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, IO_GAP_MAGIC, sizeof(hdr.magic));
+  hdr.version = IO_GAP_VERSION;
+  hdr.bom     = IO_GAP_BOM;
+  hdr.align   = IO_GAP_ALIGN;
+  hdr.indsize = sizeof(ind_t);
+  hdr.valsize = sizeof(val_t);
+  hdr.fmt     = M->fmt;
+  hdr.symm    = M->symm;
+  hdr.stride  = IO_GAP_STRIDE;
+  hdr.nr      = (uint64_t)nr;
+  hdr.nc      = (uint64_t)M->nc;
+  hdr.nnz     = (uint64_t)M->nnz;
+  hdr.ncon    = (uint64_t)M->ncon;
+
+  /* measure every stride, so that the file can be laid out up front */
+  ind_t const nstride = (ind_t)(gap_nidx(&hdr) - 1);
+  IO_gap_entry * const idx = GC_malloc((nstride + 1) * sizeof(*idx));
+
+  #pragma omp parallel for num_threads(IO_nthreads()) schedule(dynamic, 64)
+  for (ind_t k = 0; k < nstride; k++) {
+    ind_t const r0 = k * IO_GAP_STRIDE;
+    ind_t const r1 = nr - r0 < IO_GAP_STRIDE ? nr : r0 + IO_GAP_STRIDE;
+    uint64_t sz = 0;
+
+    for (ind_t i = r0; i < r1; i++)
+      sz += gap_encode(NULL, i, ja + ia[i], ia[i + 1] - ia[i]);
+
+    idx[k + 1].pos = sz;
+    idx[k + 1].nnz = (uint64_t)ia[r1];
+  }
+
+  uint64_t bufsz = 1;
+  idx[0].pos = idx[0].nnz = 0;
+  for (ind_t k = 0; k < nstride; k++) {
+    if (idx[k + 1].pos > bufsz)
+      bufsz = idx[k + 1].pos;
+    idx[k + 1].pos += idx[k].pos;
+  }
+  hdr.dlen = idx[nstride].pos;
+
+  /* mark present arrays, so that their lengths can be computed */
+  hdr.off[0] = hdr.off[1] = 1;
+  hdr.off[2] = NULL != a;
+  hdr.off[3] = NULL != M->vwgt;
+  hdr.off[4] = NULL != M->vsiz;
+  gap_lengths(&hdr, len);
+
+  uint64_t off = (sizeof(hdr) + IO_GAP_ALIGN - 1) / IO_GAP_ALIGN * IO_GAP_ALIGN;
+  for (int k = 0; k < 5; k++) {
+    if (hdr.off[k]) {
+      hdr.off[k] = off;
+      off = (off + len[k] + IO_GAP_ALIGN - 1) / IO_GAP_ALIGN * IO_GAP_ALIGN;
+    }
+  }
+  hdr.size = off;
+
+  unsigned char * const buf = GC_malloc(bufsz);
+
+  IO_stats_phase(IO_PHASE_WRITE);
+
+  GC_assert(0 == gap_write(ostream, &pos, 0, &hdr, sizeof(hdr)));
+  GC_assert(0 == gap_write(ostream, &pos, hdr.off[0], idx, len[0]));
+
+  /* encode and write one stride at a time */
+  for (ind_t k = 0; k < nstride; k++) {
+    ind_t const r0 = k * IO_GAP_STRIDE;
+    ind_t const r1 = nr - r0 < IO_GAP_STRIDE ? nr : r0 + IO_GAP_STRIDE;
+    size_t sz = 0;
+
+    for (ind_t i = r0; i < r1; i++)
+      sz += gap_encode(buf + sz, i, ja + ia[i], ia[i + 1] - ia[i]);
+
+    GC_assert(0 == gap_write(ostream, &pos, hdr.off[1] + idx[k].pos, buf, sz));
+  }
+
+  if (a)
+    GC_assert(0 == gap_write(ostream, &pos, hdr.off[2], a, len[2]));
+  if (M->vwgt)
+    GC_assert(0 == gap_write(ostream, &pos, hdr.off[3], M->vwgt, len[3]));
+  if (M->vsiz)
+    GC_assert(0 == gap_write(ostream, &pos, hdr.off[4], M->vsiz, len[4]));
+  GC_assert(0 == gap_write(ostream, &pos, hdr.size, NULL, 0));
+
+  GC_assert(0 == fflush(ostream));
+
+  if (NULL != IO_stats.stats)
+    IO_stats.stats->bytes += pos;
+
+  GC_free(buf);
+  GC_free(idx);
+  if (ja != M->ja) {
+    GC_free(ja);
+    if (a)
+      GC_free(a);
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a gap-compressed file. Rows that are not in ascending
+ *  order are sorted (with their values) on the way out. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_gap_save(char const * const filename, Matrix const * const M)
+{
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  /* open output file */
+  FILE * const ostream = fopen(filename, "wb");
+  if (!ostream)
+    return -1;
+
+  int ret = gap_fsave(ostream, M);
+  if (0 != fclose(ostream))
+    ret = -1;
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a gap-compressed file to descriptor fd, such as a pipe or
+ *  socket, which is left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_gap_save_fd(int const fd, Matrix const * const M)
+{
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open output sink */
+  FILE * const ostream = IO_fd_open(fd, "wb");
+  if (!ostream)
+    return -1;
+
+  int ret = gap_fsave(ostream, M);
+  if (0 != fclose(ostream))
+    ret = -1;
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a gap-compressed file to stream, which must have been
+ *  opened in binary mode, and is flushed but left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_gap_save_stream(FILE * const stream, Matrix const * const M)
+{
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  return gap_fsave(stream, M);
+}
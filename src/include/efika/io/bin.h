@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_BIN_H
+#define EFIKA_IO_BIN_H 1
+
+#include <stdint.h>
+
+#include "efika/core.h"
+
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_bin_load_tag efika_IO_bin_load_tag
+#define IO_bin_save_tag efika_IO_bin_save_tag
+
+/*----------------------------------------------------------------------------*/
+/*! Binary CSR container.
+ *
+ *  The file starts with an IO_bin_header, followed by the arrays ia, ja, a,
+ *  vwgt and vsiz (in that order, absent arrays have zero length), each stored
+ *  in native byte order at a file offset that is a multiple of align. Readers
+ *  reject files whose magic, version, byte order or type sizes differ from
+ *  their own. The tag is free for the producer to use, e.g. the cache stores
+ *  the key of the text file a sidecar was parsed from; it is zero otherwise,
+ *  and in files written before it existed. */
+/*----------------------------------------------------------------------------*/
+#define IO_BIN_MAGIC   "EFIKAcsr"
+#define IO_BIN_VERSION 1
+#define IO_BIN_BOM     UINT32_C(0x01020304)
+#define IO_BIN_ALIGN   64
+
+typedef struct IO_bin_header {
+  char     magic[8];  /*!< IO_BIN_MAGIC */
+  uint32_t version;   /*!< IO_BIN_VERSION */
+  uint32_t bom;       /*!< IO_BIN_BOM, as written by the producer */
+  uint32_t align;     /*!< alignment of each array in the file */
+  uint8_t  indsize;   /*!< sizeof(ind_t) */
+  uint8_t  valsize;   /*!< sizeof(val_t) */
+  uint8_t  pad[2];
+  int32_t  fmt;
+  int32_t  symm;
+  int32_t  sort;
+  int32_t  reserved;
+  uint64_t nr;
+  uint64_t nc;
+  uint64_t nnz;
+  uint64_t ncon;
+  uint64_t off[5];    /*!< file offsets of ia, ja, a, vwgt, vsiz */
+  uint64_t size;      /*!< total file size */
+  uint64_t tag;       /*!< producer-defined tag, zero if unused */
+} IO_bin_header;
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int IO_bin_load_tag(char const *filename, Matrix *M, uint64_t tag);
+int IO_bin_save_tag(char const *filename, Matrix const *M, uint64_t tag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_BIN_H */
@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_CACHE_H
+#define EFIKA_IO_CACHE_H 1
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_cache_load efika_IO_cache_load
+
+/*! Bytes hashed from each sampled block of a source file. */
+#define IO_CACHE_BLOCK 4096
+
+/*! Number of blocks, evenly spread over a source file, that are hashed. */
+#define IO_CACHE_NBLOCK 16
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int IO_cache_load(IO_Format format, char const *filename, Matrix *M,
+                  int (*load)(char const*, Matrix*));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_CACHE_H */
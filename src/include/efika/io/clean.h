@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_CLEAN_H
+#define EFIKA_IO_CLEAN_H 1
+
+#include "efika/core.h"
+
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_clean_rows efika_IO_clean_rows
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int IO_clean_rows(ind_t nr, ind_t *ia, ind_t *ja, val_t *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_CLEAN_H */
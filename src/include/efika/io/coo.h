@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_COO_H
+#define EFIKA_IO_COO_H 1
+
+#include "efika/core.h"
+
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_coo_csr efika_IO_coo_csr
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void IO_coo_csr(ind_t nr, ind_t n, ind_t const *u, ind_t const *v,
+                val_t const *w, int symm, ind_t *ia, ind_t *ja, val_t *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_COO_H */
@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_FD_H
+#define EFIKA_IO_FD_H 1
+
+#include <stdio.h>
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_fd_dup   efika_IO_fd_dup
+#define IO_fd_close efika_IO_fd_close
+#define IO_fd_open  efika_IO_fd_open
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int    IO_fd_dup(int fd);
+int    IO_fd_close(int fd);
+FILE * IO_fd_open(int fd, char const *mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_FD_H */
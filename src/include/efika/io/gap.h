@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_GAP_H
+#define EFIKA_IO_GAP_H 1
+
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------*/
+/*! Gap-compressed CSR container.
+ *
+ *  The file starts with an IO_gap_header, followed by the row index, the
+ *  encoded adjacency, and the arrays a, vwgt and vsiz (in that order, absent
+ *  arrays have zero length), each at a file offset that is a multiple of
+ *  align. Numbers other than the encoded adjacency are in native byte order,
+ *  and readers reject files whose magic, version, byte order or type sizes
+ *  differ from their own.
+ *
+ *  Each row is encoded as its length followed by its column indices in
+ *  ascending order: the first as its signed distance from the row (zig-zag
+ *  encoded), the rest as the gap from their predecessor. All of these are
+ *  unsigned LEB128 varints. Values are stored in the same order as the
+ *  sorted column indices.
+ *
+ *  The index has an entry for every stride rows, plus a final one, giving the
+ *  position of the row in the encoded adjacency and the number of non-zeros
+ *  that precede it, so that any row is reached by decoding at most stride-1
+ *  others, and each stride can be decoded independently. */
+/*----------------------------------------------------------------------------*/
+#define IO_GAP_MAGIC   "EFIKAgap"
+#define IO_GAP_VERSION 1
+#define IO_GAP_BOM     UINT32_C(0x01020304)
+#define IO_GAP_ALIGN   64
+
+/*! Rows per index entry. */
+#define IO_GAP_STRIDE 64
+
+typedef struct IO_gap_header {
+  char     magic[8];  /*!< IO_GAP_MAGIC */
+  uint32_t version;   /*!< IO_GAP_VERSION */
+  uint32_t bom;       /*!< IO_GAP_BOM, as written by the producer */
+  uint32_t align;     /*!< alignment of each array in the file */
+  uint8_t  indsize;   /*!< sizeof(ind_t) */
+  uint8_t  valsize;   /*!< sizeof(val_t) */
+  uint8_t  pad[2];
+  int32_t  fmt;
+  int32_t  symm;
+  int32_t  stride;    /*!< rows per index entry */
+  int32_t  reserved;
+  uint64_t nr;
+  uint64_t nc;
+  uint64_t nnz;
+  uint64_t ncon;
+  uint64_t dlen;      /*!< byte length of the encoded adjacency */
+  uint64_t off[5];    /*!< file offsets of index, adjacency, a, vwgt, vsiz */
+  uint64_t size;      /*!< total file size */
+} IO_gap_header;
+
+typedef struct IO_gap_entry {
+  uint64_t pos;       /*!< offset of the row in the encoded adjacency */
+  uint64_t nnz;       /*!< non-zeros in all preceding rows */
+} IO_gap_entry;
+
+#endif /* EFIKA_IO_GAP_H */
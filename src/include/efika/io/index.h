@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_INDEX_H
+#define EFIKA_IO_INDEX_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "efika/core.h"
+
+#include "efika/io/reader.h"
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_index_build efika_IO_index_build
+#define IO_index_seek  efika_IO_index_seek
+
+/*----------------------------------------------------------------------------*/
+/*! Line-offset index of a row-per-line text file (METIS, CLUTO), in which the
+ *  first non-comment line is a header and every later non-comment line is a
+ *  row.
+ *
+ *  The file starts with an IO_index_header, followed by one native uint64_t
+ *  per stride rows, entry k giving the byte offset of the line of row
+ *  k*stride. The size and modification time of the indexed file are recorded,
+ *  so that an index is not used once its file has changed. */
+/*----------------------------------------------------------------------------*/
+#define IO_INDEX_MAGIC   "EFIKAidx"
+#define IO_INDEX_VERSION 1
+#define IO_INDEX_BOM     UINT32_C(0x01020304)
+
+/*! Default rows per index entry. */
+#define IO_INDEX_STRIDE 1024
+
+typedef struct IO_index_header {
+  char     magic[8]; /*!< IO_INDEX_MAGIC */
+  uint32_t version;  /*!< IO_INDEX_VERSION */
+  uint32_t bom;      /*!< IO_INDEX_BOM, as written by the producer */
+  uint64_t size;     /*!< size of the indexed file */
+  int64_t  mtime;    /*!< modification time of the indexed file */
+  uint64_t stride;   /*!< rows per entry */
+  uint64_t nrows;    /*!< rows in the indexed file */
+} IO_index_header;
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int IO_index_build(char const *filename, char const *index, size_t stride,
+                   char comment);
+int IO_index_seek(IO_reader *reader, char const *filename, char const *index,
+                  ind_t row, ind_t *first);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_INDEX_H */
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_INFLATE_H
+#define EFIKA_IO_INFLATE_H 1
+
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_inflate_open    efika_IO_inflate_open
+#define IO_inflate_close   efika_IO_inflate_close
+#define IO_inflate_rewind  efika_IO_inflate_rewind
+#define IO_inflate_getline efika_IO_inflate_getline
+
+/*! Size of each decompressed buffer. */
+#define IO_INFLATE_BUFSIZE (1 << 20)
+
+/*! Number of decompressed buffers in flight between producer and parser. */
+#define IO_INFLATE_NBUF 4
+
+/*----------------------------------------------------------------------------*/
+/*! Decompression pipeline. A producer thread inflates the input into a ring of
+ *  fixed-size buffers, which the parser drains one line at a time. */
+/*----------------------------------------------------------------------------*/
+typedef struct IO_inflate IO_inflate;
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int      IO_inflate_open(IO_inflate **gz, int fd, char const *filename);
+void     IO_inflate_close(IO_inflate *gz);
+int      IO_inflate_rewind(IO_inflate *gz);
+intmax_t IO_inflate_getline(IO_inflate *gz, char const **lineptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_INFLATE_H */
@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_METIS_H
+#define EFIKA_IO_METIS_H 1
+
+#include "efika/core.h"
+
+#include "efika/io/reader.h"
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_metis_header efika_IO_metis_header
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int IO_metis_header(IO_reader *reader, ind_t *nr, ind_t *nnz, int *fmt,
+                    ind_t *ncon);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_METIS_H */
@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_OPTIONS_H
+#define EFIKA_IO_OPTIONS_H 1
+
+#include <stdint.h>
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_opts efika_IO_opts
+
+/*----------------------------------------------------------------------------*/
+/*! Process-wide options. */
+/*----------------------------------------------------------------------------*/
+extern IO_Options IO_opts;
+
+/*----------------------------------------------------------------------------*/
+/*! Number of threads a parallel loader should use. */
+/*----------------------------------------------------------------------------*/
+static inline int
+IO_nthreads(void)
+{
+#ifdef _OPENMP
+  int const nthreads = IO_opts.nthreads;
+  return 0 < nthreads ? nthreads : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Number of threads a parallel loader that keeps a count per thread and row
+ *  of an nr-row matrix with nnz non-zeros should use. The counts of all threads
+ *  are capped at the larger of nnz and 2^24, so that they never need much more
+ *  memory than the column indices of the matrix. */
+/*----------------------------------------------------------------------------*/
+static inline int
+IO_nthreads_rows(ind_t const nr, uint64_t const nnz)
+{
+  uint64_t const max = nnz > (UINT64_C(1) << 24) ? nnz : UINT64_C(1) << 24;
+  int const nthreads = IO_nthreads();
+
+  if (0 == nr || (uint64_t)nthreads * nr <= max)
+    return nthreads;
+  return max / nr > 1 ? (int)(max / nr) : 1;
+}
+
+#endif /* EFIKA_IO_OPTIONS_H */
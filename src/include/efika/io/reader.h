@@ -0,0 +1,96 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_READER_H
+#define EFIKA_IO_READER_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "efika/io/inflate.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_reader_open        efika_IO_reader_open
+#define IO_reader_open_fd     efika_IO_reader_open_fd
+#define IO_reader_open_stream efika_IO_reader_open_stream
+#define IO_reader_open_mem    efika_IO_reader_open_mem
+#define IO_reader_close       efika_IO_reader_close
+#define IO_reader_rewind      efika_IO_reader_rewind
+#define IO_reader_seek        efika_IO_reader_seek
+#define IO_reader_tell        efika_IO_reader_tell
+#define IO_reader_getline     efika_IO_reader_getline
+#define IO_reader_split       efika_IO_reader_split
+
+/*----------------------------------------------------------------------------*/
+/*! Input source. Regular files are memory-mapped and walked in place, gzip
+ *  compressed files (and, when zlib is available, anything that is not a
+ *  regular file) are inflated by a decompression pipeline, and anything else is
+ *  read one line at a time through IO_getline. Sources that are not regular
+ *  files, such as FIFOs, and sources opened on a stream or descriptor of the
+ *  caller are read forward only, while buffers of the caller are walked in
+ *  place like a mapped file. */
+/*----------------------------------------------------------------------------*/
+typedef struct IO_reader {
+  char const * base;   /*!< first mapped byte, NULL when not mapped */
+  size_t       size;   /*!< number of mapped bytes */
+  char const * cur;    /*!< next unread mapped byte */
+  FILE *       stream; /*!< fallback stream, NULL when not streaming */
+  IO_inflate * gz;     /*!< decompression pipeline, NULL when not inflating */
+  char *       line;   /*!< IO_getline buffer */
+  size_t       n;      /*!< size of line */
+  char         comment;  /*!< first character of comment lines, if any */
+  uint64_t     lines;    /*!< number of lines read */
+  uint64_t     comments; /*!< number of comment lines read */
+  uint64_t     bytes;    /*!< number of bytes read when not mapped */
+  int          borrowed; /*!< source belongs to the caller, so is not closed */
+  int          forward;  /*!< source cannot be rewound or repositioned */
+} IO_reader;
+
+/*----------------------------------------------------------------------------*/
+/*! Get the next line from a byte range. Returns the number of bytes in the
+ *  line, including its newline if present, or -1 at the end of the range. */
+/*----------------------------------------------------------------------------*/
+static inline intmax_t
+IO_nextline(char const ** const cur, char const * const end,
+            char const ** const lineptr)
+{
+  char const * const beg = *cur;
+
+  if (beg >= end)
+    return -1;
+
+  char const * eol = memchr(beg, '\n', (size_t)(end - beg));
+  eol = (NULL == eol) ? end : eol + 1;
+
+  *lineptr = beg;
+  *cur     = eol;
+
+  return (intmax_t)(eol - beg);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int      IO_reader_open(IO_reader *reader, char const *filename);
+int      IO_reader_open_fd(IO_reader *reader, int fd);
+int      IO_reader_open_stream(IO_reader *reader, FILE *stream);
+int      IO_reader_open_mem(IO_reader *reader, char const *buf, size_t len);
+void     IO_reader_close(IO_reader *reader);
+int      IO_reader_rewind(IO_reader *reader);
+int      IO_reader_seek(IO_reader *reader, uint64_t off);
+uint64_t IO_reader_tell(IO_reader const *reader);
+intmax_t IO_reader_getline(IO_reader *reader, char const **lineptr);
+int      IO_reader_split(IO_reader const *reader, int nparts,
+                         char const **bounds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_READER_H */
@@ -4,16 +4,115 @@
 
 #include "efika/core/rename.h"
 
+#define IO_Async       EFIKA_IO_Async
+#define IO_Format      EFIKA_IO_Format
+#define IO_Gap         EFIKA_IO_Gap
+#define IO_Options     EFIKA_IO_Options
+#define IO_Rows        EFIKA_IO_Rows
+#define IO_Stats       EFIKA_IO_Stats
+
+#define IO_BIN         EFIKA_IO_BIN
+#define IO_CLUTO       EFIKA_IO_CLUTO
+#define IO_DIMACS      EFIKA_IO_DIMACS
+#define IO_GAP         EFIKA_IO_GAP
+#define IO_METIS       EFIKA_IO_METIS
+#define IO_MM          EFIKA_IO_MM
+#define IO_SNAP        EFIKA_IO_SNAP
+#define IO_UGRAPH      EFIKA_IO_UGRAPH
+
+#define IO_DEDUP_NONE  EFIKA_IO_DEDUP_NONE
+#define IO_DEDUP_SUM   EFIKA_IO_DEDUP_SUM
+#define IO_DEDUP_MIN   EFIKA_IO_DEDUP_MIN
+#define IO_DEDUP_MAX   EFIKA_IO_DEDUP_MAX
+#define IO_DEDUP_FIRST EFIKA_IO_DEDUP_FIRST
+
+#define IO_SLAB_NONE    EFIKA_IO_SLAB_NONE
+#define IO_SLAB_ALIGNED EFIKA_IO_SLAB_ALIGNED
+#define IO_SLAB_HUGE    EFIKA_IO_SLAB_HUGE
+
+#define IO_PHASE_OPEN  EFIKA_IO_PHASE_OPEN
+#define IO_PHASE_PARSE EFIKA_IO_PHASE_PARSE
+#define IO_PHASE_BUILD EFIKA_IO_PHASE_BUILD
+#define IO_PHASE_WRITE EFIKA_IO_PHASE_WRITE
+#define IO_NPHASE      EFIKA_IO_NPHASE
+
+#define IO_async_cancel EFIKA_IO_async_cancel
+#define IO_async_test  EFIKA_IO_async_test
+#define IO_async_wait  EFIKA_IO_async_wait
+#define IO_bin_load    EFIKA_IO_bin_load
+#define IO_bin_load_fd EFIKA_IO_bin_load_fd
+#define IO_bin_load_stream EFIKA_IO_bin_load_stream
+#define IO_bin_map     EFIKA_IO_bin_map
+#define IO_bin_unmap   EFIKA_IO_bin_unmap
+#define IO_bin_save    EFIKA_IO_bin_save
+#define IO_bin_save_fd EFIKA_IO_bin_save_fd
+#define IO_bin_save_stream EFIKA_IO_bin_save_stream
+#define IO_bin_convert EFIKA_IO_bin_convert
+#define IO_cluto_index EFIKA_IO_cluto_index
 #define IO_cluto_load  EFIKA_IO_cluto_load
+#define IO_cluto_load_fd EFIKA_IO_cluto_load_fd
+#define IO_cluto_load_stream EFIKA_IO_cluto_load_stream
+#define IO_cluto_load_mem EFIKA_IO_cluto_load_mem
+#define IO_cluto_load_range EFIKA_IO_cluto_load_range
+#define IO_cluto_open  EFIKA_IO_cluto_open
 #define IO_cluto_save  EFIKA_IO_cluto_save
+#define IO_cluto_save_fd EFIKA_IO_cluto_save_fd
+#define IO_cluto_save_stream EFIKA_IO_cluto_save_stream
 #define IO_dimacs_save EFIKA_IO_dimacs_save
+#define IO_dimacs_save_fd EFIKA_IO_dimacs_save_fd
+#define IO_dimacs_save_stream EFIKA_IO_dimacs_save_stream
+#define IO_gap_load    EFIKA_IO_gap_load
+#define IO_gap_load_fd EFIKA_IO_gap_load_fd
+#define IO_gap_load_stream EFIKA_IO_gap_load_stream
+#define IO_gap_open    EFIKA_IO_gap_open
+#define IO_gap_info    EFIKA_IO_gap_info
+#define IO_gap_row     EFIKA_IO_gap_row
+#define IO_gap_close   EFIKA_IO_gap_close
+#define IO_gap_save    EFIKA_IO_gap_save
+#define IO_gap_save_fd EFIKA_IO_gap_save_fd
+#define IO_gap_save_stream EFIKA_IO_gap_save_stream
+#define IO_load_async  EFIKA_IO_load_async
+#define IO_load_ext    EFIKA_IO_load_ext
+#define IO_metis_index EFIKA_IO_metis_index
 #define IO_metis_load  EFIKA_IO_metis_load
+#define IO_metis_load_fd EFIKA_IO_metis_load_fd
+#define IO_metis_load_stream EFIKA_IO_metis_load_stream
+#define IO_metis_load_mem EFIKA_IO_metis_load_mem
+#define IO_metis_load_range EFIKA_IO_metis_load_range
+#define IO_metis_open  EFIKA_IO_metis_open
 #define IO_metis_save  EFIKA_IO_metis_save
+#define IO_metis_save_fd EFIKA_IO_metis_save_fd
+#define IO_metis_save_stream EFIKA_IO_metis_save_stream
 #define IO_mm_load     EFIKA_IO_mm_load
+#define IO_mm_load_fd EFIKA_IO_mm_load_fd
+#define IO_mm_load_stream EFIKA_IO_mm_load_stream
+#define IO_mm_load_mem EFIKA_IO_mm_load_mem
+#define IO_mm_open     EFIKA_IO_mm_open
 #define IO_mm_save     EFIKA_IO_mm_save
+#define IO_mm_save_fd EFIKA_IO_mm_save_fd
+#define IO_mm_save_stream EFIKA_IO_mm_save_stream
+#define IO_options_get EFIKA_IO_options_get
+#define IO_options_set EFIKA_IO_options_set
+#define IO_rows_next   EFIKA_IO_rows_next
+#define IO_rows_close  EFIKA_IO_rows_close
+#define IO_save_async  EFIKA_IO_save_async
+#define IO_save_ext    EFIKA_IO_save_ext
 #define IO_snap_load   EFIKA_IO_snap_load
+#define IO_snap_load_fd EFIKA_IO_snap_load_fd
+#define IO_snap_load_stream EFIKA_IO_snap_load_stream
+#define IO_snap_load_mem EFIKA_IO_snap_load_mem
+#define IO_snap_load_map EFIKA_IO_snap_load_map
+#define IO_snap_open   EFIKA_IO_snap_open
+#define IO_slab_free   EFIKA_IO_slab_free
 #define IO_snap_save   EFIKA_IO_snap_save
+#define IO_snap_save_fd EFIKA_IO_snap_save_fd
+#define IO_snap_save_stream EFIKA_IO_snap_save_stream
 #define IO_ugraph_load EFIKA_IO_ugraph_load
+#define IO_ugraph_load_fd EFIKA_IO_ugraph_load_fd
+#define IO_ugraph_load_stream EFIKA_IO_ugraph_load_stream
+#define IO_ugraph_load_mem EFIKA_IO_ugraph_load_mem
 #define IO_ugraph_save EFIKA_IO_ugraph_save
+#define IO_ugraph_save_fd EFIKA_IO_ugraph_save_fd
+#define IO_ugraph_save_stream EFIKA_IO_ugraph_save_stream
 
 #endif /* EFIKA_IO_RENAME_H */
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_ROWS_H
+#define EFIKA_IO_ROWS_H 1
+
+#include <stddef.h>
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/io/reader.h"
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_rows_init efika_IO_rows_init
+#define IO_rows_room efika_IO_rows_room
+
+/*----------------------------------------------------------------------------*/
+/*! Function that parses the next row of an input source into the block
+ *  buffers. Its non-zeros are appended at rows->nnz (after IO_rows_room), its
+ *  vertex sizes and weights go to slot i. Returns 0 when a row was parsed, 1 at
+ *  the (validated) end of input, and -1 on error. */
+/*----------------------------------------------------------------------------*/
+typedef int (*IO_rows_fn)(IO_Rows *rows, size_t i);
+
+/*----------------------------------------------------------------------------*/
+/*! Row block reader. */
+/*----------------------------------------------------------------------------*/
+struct EFIKA_IO_Rows {
+  IO_reader  reader; /*!< input source */
+  IO_rows_fn row;    /*!< format row parser */
+  size_t     blksz;  /*!< work (non-zeros plus rows) per block */
+
+  int   fmt;         /*!< matrix format, as in Matrix */
+  int   symm;        /*!< symmetric matrix, as in Matrix */
+  int   vals;        /*!< non-zero values are present */
+  ind_t nr;          /*!< number of rows, when known up front */
+  ind_t nc;          /*!< number of columns (largest seen so far for SNAP) */
+  ind_t ncon;        /*!< number of vertex weights per row */
+  ind_t hnnz;        /*!< number of non-zeros given by the header */
+  ind_t nnnz;        /*!< number of non-zeros parsed so far */
+  ind_t r;           /*!< number of rows parsed so far */
+
+  int   pend;        /*!< a coordinate line has been read ahead */
+  ind_t pu, pv;      /*!< ...its (1-based) row and column */
+  val_t pw;          /*!< ...and its value */
+
+  ind_t * ia;        /*!< block buffers */
+  ind_t * ja;
+  val_t * a;
+  ind_t * vsiz;
+  val_t * vwgt;
+  size_t  rcap;      /*!< number of rows the block buffers can hold */
+  size_t  cap;       /*!< number of non-zeros the block buffers can hold */
+  size_t  nnz;       /*!< number of buffered non-zeros */
+  int     carry;     /*!< the last parsed row did not fit in its block */
+  size_t  crow;      /*!< ...and is held in slot crow */
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int IO_rows_init(IO_Rows **rows, char const *filename, size_t blksz,
+                 IO_rows_fn row);
+int IO_rows_room(IO_Rows *rows, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_ROWS_H */
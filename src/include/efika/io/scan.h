@@ -0,0 +1,281 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_SCAN_H
+#define EFIKA_IO_SCAN_H 1
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "efika/core.h"
+
+#include "efika/io/rename.h"
+#include "efika/io/simd.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Field scanners. These work on a byte range [p, end) that need not be
+ *  NUL-terminated and follow the strtol convention: leading whitespace is
+ *  skipped and *endptr is set to p when no conversion takes place. */
+/*----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------*/
+/*! Test for a whitespace character. */
+/*----------------------------------------------------------------------------*/
+static inline int
+IO_isspace(char const c)
+{
+  return ' ' == c || ('\t' <= c && c <= '\r');
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Skip whitespace. */
+/*----------------------------------------------------------------------------*/
+static inline char const *
+IO_skipspace(char const * p, char const * const end)
+{
+  while (p < end && IO_isspace(*p))
+    p++;
+  return p;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Locate the next whitespace delimited token. */
+/*----------------------------------------------------------------------------*/
+static inline char const *
+IO_token(char const * p, char const * const end, char const ** const tokend)
+{
+  p = IO_skipspace(p, end);
+
+  char const * q = p;
+  while (q < end && !IO_isspace(*q))
+    q++;
+  *tokend = q;
+
+  return p;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Count the whitespace delimited tokens. */
+/*----------------------------------------------------------------------------*/
+static inline size_t
+IO_ntokens(char const * p, char const * const end)
+{
+  char const * q;
+  size_t n = 0;
+
+  for (p = IO_token(p, end, &q); p < q; p = IO_token(q, end, &q))
+    n++;
+
+  return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Compare a token to a string. */
+/*----------------------------------------------------------------------------*/
+static inline int
+IO_tokeq(char const * const tok, char const * const tokend, char const * const s)
+{
+  size_t const len = strlen(s);
+  return (size_t)(tokend - tok) == len && 0 == memcmp(tok, s, len);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Accumulate a run of decimal digits into *x, returning the number of digits
+ *  consumed. Runs of more than 19 digits may wrap. When the vectorized kernels
+ *  are available and at least 16 bytes remain, digits are converted 16 at a
+ *  time, otherwise one at a time. */
+/*----------------------------------------------------------------------------*/
+static inline int
+IO_digits(char const ** const pp, char const * const end, uint64_t * const x)
+{
+  static uint64_t const pow10[] = {
+    UINT64_C(1),             UINT64_C(10),             UINT64_C(100),
+    UINT64_C(1000),          UINT64_C(10000),          UINT64_C(100000),
+    UINT64_C(1000000),       UINT64_C(10000000),       UINT64_C(100000000),
+    UINT64_C(1000000000),    UINT64_C(10000000000),    UINT64_C(100000000000),
+    UINT64_C(1000000000000), UINT64_C(10000000000000),
+    UINT64_C(100000000000000), UINT64_C(1000000000000000),
+    UINT64_C(10000000000000000)
+  };
+
+  char const * q = *pp;
+  uint64_t m = *x;
+  int nd = 0;
+
+#if IO_HAVE_SIMD
+  if (IO_simd) {
+    while (end - q >= 16) {
+      uint64_t y;
+      int const n = IO_simd_digits16(q, &y);
+
+      m   = m * pow10[n] + y;
+      q  += n;
+      nd += n;
+
+      if (16 > n)
+        goto done;
+    }
+  }
+#else
+  (void)pow10;
+#endif
+
+  for (; q < end && (unsigned)(*q - '0') < 10; q++, nd++)
+    m = m * 10 + (unsigned)(*q - '0');
+
+#if IO_HAVE_SIMD
+  done:
+#endif
+  *pp = q;
+  *x  = m;
+
+  return nd;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse an unsigned decimal integer. */
+/*----------------------------------------------------------------------------*/
+static inline uintmax_t
+IO_strtou(char const * const p, char const * const end,
+          char const ** const endptr)
+{
+  char const * q = IO_skipspace(p, end);
+  uint64_t m = 0;
+
+  if (q < end && '+' == *q)
+    q++;
+
+  char const * const digits = q;
+  int const nd = IO_digits(&q, end, &m);
+
+  if (0 == nd) {
+    *endptr = p;
+    return 0;
+  }
+  if (19 >= nd) {
+    *endptr = q;
+    return m;
+  }
+
+  /* ...long runs may overflow, redo them with checking... */
+  uintmax_t x = 0;
+  for (q = digits; q < end && (unsigned)(*q - '0') < 10; q++) {
+    unsigned const d = (unsigned)(*q - '0');
+
+    if (x > (UINTMAX_MAX - d) / 10) {
+      errno = ERANGE;
+      *endptr = p;
+      return 0;
+    }
+
+    x = x * 10 + d;
+  }
+
+  *endptr = q;
+
+  return x;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse an index. */
+/*----------------------------------------------------------------------------*/
+static inline ind_t
+IO_strtoi(char const * const p, char const * const end,
+          char const ** const endptr)
+{
+  uintmax_t const x = IO_strtou(p, end, endptr);
+
+  /* insist that the value is representable as an ind_t */
+  if ((uintmax_t)(ind_t)x != x) {
+    errno = ERANGE;
+    *endptr = p;
+    return 0;
+  }
+
+  return (ind_t)x;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse a value. Decimal values whose significand and power of ten are both
+ *  exactly representable in val_t are converted with a single (correctly
+ *  rounded) multiply or divide, everything else falls back to strtov. */
+/*----------------------------------------------------------------------------*/
+static inline val_t
+IO_strtov(char const * const p, char const * const end,
+          char const ** const endptr)
+{
+  static double const pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  uint64_t const mmax = sizeof(val_t) < sizeof(double) ? UINT64_C(1) << 24
+                                                       : UINT64_C(1) << 53;
+  int const emax = sizeof(val_t) < sizeof(double) ? 10 : 22;
+
+  char const * q = IO_skipspace(p, end);
+  char const * const tok = q;
+  int neg = 0, e10 = 0, nd = 0;
+  uint64_t m = 0;
+
+  if (q < end && ('-' == *q || '+' == *q))
+    neg = ('-' == *q++);
+
+  nd = IO_digits(&q, end, &m);
+  if (q < end && '.' == *q) {
+    q++;
+    int const nf = IO_digits(&q, end, &m);
+    nd  += nf;
+    e10 -= nf;
+  }
+
+  if (0 < nd && 19 >= nd) {
+    if (q < end && ('e' == *q || 'E' == *q)) {
+      char const * r = q + 1;
+      int eneg = 0, e = 0;
+
+      if (r < end && ('-' == *r || '+' == *r))
+        eneg = ('-' == *r++);
+      char const * const edigits = r;
+      for (; r < end && (unsigned)(*r - '0') < 10 && e < 10000; r++)
+        e = e * 10 + (*r - '0');
+
+      if (r != edigits) {
+        e10 += eneg ? -e : e;
+        q = r;
+      }
+    }
+
+    if ((q == end || IO_isspace(*q)) && m <= mmax && -emax <= e10 &&
+        e10 <= emax)
+    {
+      val_t x = (val_t)m;
+      if (e10 < 0)
+        x /= (val_t)pow10[-e10];
+      else
+        x *= (val_t)pow10[e10];
+
+      *endptr = q;
+      return neg ? -x : x;
+    }
+  }
+
+  /* ...slow path, hand a NUL-terminated copy of the token to strtov... */
+  char buf[128];
+  char * bufend;
+
+  for (q = tok; q < end && !IO_isspace(*q); q++);
+  if ((size_t)(q - tok) >= sizeof(buf)) {
+    *endptr = p;
+    return 0;
+  }
+
+  memcpy(buf, tok, (size_t)(q - tok));
+  buf[q - tok] = '\0';
+
+  val_t const x = strtov(buf, &bufend);
+  *endptr = (bufend == buf) ? p : tok + (bufend - buf);
+
+  return x;
+}
+
+#endif /* EFIKA_IO_SCAN_H */
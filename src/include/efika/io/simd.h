@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_SIMD_H
+#define EFIKA_IO_SIMD_H 1
+
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------*/
+/*! Vectorized kernels are built for x86 with GCC-compatible compilers and
+ *  selected at run-time, everything else uses the scalar scanners. */
+/*----------------------------------------------------------------------------*/
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define IO_HAVE_SIMD 1
+#else
+# define IO_HAVE_SIMD 0
+#endif
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_simd          efika_IO_simd
+#define IO_simd_digits16 efika_IO_simd_digits16
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Non-zero when the running CPU supports the vectorized kernels, as detected
+ *  on start-up. */
+extern int IO_simd;
+
+/*! Convert the run of decimal digits at the start of the 16 bytes at p,
+ *  returning its length (0 to 16) and storing its value in *x. */
+int IO_simd_digits16(char const *p, uint64_t *x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_SIMD_H */
@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_SLAB_H
+#define EFIKA_IO_SLAB_H 1
+
+#include <stddef.h>
+
+#include "efika/core.h"
+
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_csr_alloc  efika_IO_csr_alloc
+#define IO_csr_free   efika_IO_csr_free
+#define IO_csr_shrink efika_IO_csr_shrink
+#define IO_slab_pack  efika_IO_slab_pack
+
+/*----------------------------------------------------------------------------*/
+/*! Single-slab CSR allocation.
+ *
+ *  A slab starts with an IO_slab_header, followed by the arrays ia, ja, a,
+ *  vwgt and vsiz (in that order, absent arrays take no space), each at an
+ *  offset that is a multiple of IO_SLAB_ALIGN, so that ia is always
+ *  IO_SLAB_ALIGN bytes past the header. Slabs backed by huge pages are mapped
+ *  in multiples of IO_SLAB_HUGEPAGE bytes, at an address aligned to it. */
+/*----------------------------------------------------------------------------*/
+#define IO_SLAB_MAGIC    "EFIKAslb"
+#define IO_SLAB_ALIGN    64
+#define IO_SLAB_HUGEPAGE ((size_t)1 << 21)
+
+typedef struct IO_slab_header {
+  char   magic[8]; /*!< IO_SLAB_MAGIC */
+  void * base;     /*!< start of the allocation holding the slab */
+  size_t size;     /*!< length of the mapping, 0 when allocated by malloc */
+} IO_slab_header;
+
+/*----------------------------------------------------------------------------*/
+/*! Arrays of a CSR matrix being loaded, either carved from one slab or
+ *  allocated separately, as the slab option asks. */
+/*----------------------------------------------------------------------------*/
+typedef struct IO_csr {
+  ind_t * ia;
+  ind_t * ja;
+  val_t * a;
+  val_t * vwgt;
+  ind_t * vsiz;
+  int     slab;    /*!< the arrays are carved from one slab */
+} IO_csr;
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int  IO_csr_alloc(IO_csr *csr, ind_t nr, ind_t nnz, int adj, ind_t nvwgt,
+                  int siz);
+void IO_csr_free(IO_csr *csr);
+void IO_csr_shrink(IO_csr *csr, ind_t nnz);
+int  IO_slab_pack(IO_csr *csr, ind_t nr, ind_t nnz, ind_t nvwgt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_SLAB_H */
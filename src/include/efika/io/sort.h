@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_SORT_H
+#define EFIKA_IO_SORT_H 1
+
+#include <stddef.h>
+
+#include "efika/core.h"
+
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_sort_row  efika_IO_sort_row
+#define IO_sort_rows efika_IO_sort_rows
+#define IO_sort_free efika_IO_sort_free
+
+/*----------------------------------------------------------------------------*/
+/*! Rows up to this length are insertion sorted, longer ones radix sorted. */
+/*----------------------------------------------------------------------------*/
+#define IO_SORT_SHORT 64
+
+/*----------------------------------------------------------------------------*/
+/*! Scratch space of the radix sort, grown on demand and reused across rows. A
+ *  zero-initialized IO_sort is empty. */
+/*----------------------------------------------------------------------------*/
+typedef struct IO_sort {
+  ind_t * ja;
+  val_t * a;
+  size_t  cap;
+} IO_sort;
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int  IO_sort_row(ind_t n, ind_t *ja, val_t *a, IO_sort *buf);
+int  IO_sort_rows(ind_t nr, ind_t const *ia, ind_t *ja, val_t *a);
+void IO_sort_free(IO_sort *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_SORT_H */
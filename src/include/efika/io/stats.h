@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_STATS_H
+#define EFIKA_IO_STATS_H 1
+
+#include "efika/io.h"
+
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Storage class of per-thread variables. */
+/*----------------------------------------------------------------------------*/
+#if defined(_MSC_VER)
+# define IO_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+# define IO_THREAD_LOCAL __thread
+#else
+# define IO_THREAD_LOCAL _Thread_local
+#endif
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_stats     efika_IO_stats
+#define IO_stats_now efika_IO_stats_now
+
+/*----------------------------------------------------------------------------*/
+/*! Statistics being gathered by the calling thread. */
+/*----------------------------------------------------------------------------*/
+typedef struct IO_stats_ctx {
+  IO_Stats * stats; /*!< statistics of the current load/save, NULL when off */
+  int        phase; /*!< current phase */
+  double     t0;    /*!< start of the current phase */
+} IO_stats_ctx;
+
+extern IO_THREAD_LOCAL IO_stats_ctx IO_stats;
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+double IO_stats_now(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/*! Charge the time since the last phase change to the current phase and enter
+ *  a new one. Does nothing unless statistics are being gathered. */
+/*----------------------------------------------------------------------------*/
+static inline void
+IO_stats_phase(int const phase)
+{
+  if (NULL == IO_stats.stats)
+    return;
+
+  double const t = IO_stats_now();
+
+  IO_stats.stats->time[IO_stats.phase] += t - IO_stats.t0;
+  IO_stats.phase = phase;
+  IO_stats.t0    = t;
+}
+
+#endif /* EFIKA_IO_STATS_H */
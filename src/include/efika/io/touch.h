@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_TOUCH_H
+#define EFIKA_IO_TOUCH_H 1
+
+#include "efika/core.h"
+
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+#include "efika/io/slab.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_touch_rows efika_IO_touch_rows
+#define IO_touch_nnz  efika_IO_touch_nnz
+
+/*----------------------------------------------------------------------------*/
+/*! Whether loaders should place the arrays of the matrix they build by first
+ *  touch, according to the row partition in the options. */
+/*----------------------------------------------------------------------------*/
+static inline int
+IO_touch_on(void)
+{
+  return 0 < IO_opts.nparts;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void IO_touch_rows(IO_csr const *csr, ind_t nr, ind_t nvwgt);
+void IO_touch_nnz(ind_t nr, ind_t const *ia, ind_t *ja, val_t *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EFIKA_IO_TOUCH_H */
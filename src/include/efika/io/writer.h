@@ -0,0 +1,173 @@
+/* SPDX-License-Identifier: MIT */
+#ifndef EFIKA_IO_WRITER_H
+#define EFIKA_IO_WRITER_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "efika/core.h"
+
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! IO routines. */
+/*----------------------------------------------------------------------------*/
+#define IO_writer_open        efika_IO_writer_open
+#define IO_writer_open_fd     efika_IO_writer_open_fd
+#define IO_writer_open_stream efika_IO_writer_open_stream
+#define IO_writer_close       efika_IO_writer_close
+#define IO_writer_flush       efika_IO_writer_flush
+#define IO_writer_room        efika_IO_writer_room
+#define IO_writer_printf      efika_IO_writer_printf
+#define IO_writer_rows        efika_IO_writer_rows
+#define IO_vtoa               efika_IO_vtoa
+
+/*! Size of the output buffer. */
+#define IO_WRITER_BUFSIZE (1 << 22)
+
+/*! Room guaranteed to be available by IO_writer_reserve for a single field. */
+#define IO_WRITER_SLACK 64
+
+/*! Work (non-zeros plus rows) formatted by one thread per parallel block. */
+#define IO_WRITER_BLOCK (1 << 18)
+
+/*----------------------------------------------------------------------------*/
+/*! Output sink. Fields are formatted straight into a large buffer, which is
+ *  handed to the (unbuffered) stream in big writes. A sink without a stream
+ *  keeps everything in memory, growing its buffer as needed. Sinks opened on a
+ *  stream or descriptor of the caller are written in order, never
+ *  positioned. */
+/*----------------------------------------------------------------------------*/
+typedef struct IO_writer {
+  FILE *   stream;   /*!< output stream, NULL for a memory sink */
+  char *   buf;      /*!< output buffer */
+  size_t   len;      /*!< number of buffered bytes */
+  size_t   cap;      /*!< size of buf */
+  uint64_t pos;      /*!< number of bytes handed to stream so far */
+  int      err;      /*!< non-zero once any write has failed */
+  int      borrowed; /*!< stream belongs to the caller, so is not closed */
+  int      ordered;  /*!< stream is written in order, never positioned */
+} IO_writer;
+
+/*----------------------------------------------------------------------------*/
+/*! Function that formats rows [r0, r1) of a matrix. */
+/*----------------------------------------------------------------------------*/
+typedef void (*IO_writer_rows_fn)(IO_writer *writer, Matrix const *M, ind_t r0,
+                                  ind_t r1);
+
+/*----------------------------------------------------------------------------*/
+/*! Private API. */
+/*----------------------------------------------------------------------------*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int    IO_writer_open(IO_writer *writer, char const *filename);
+int    IO_writer_open_fd(IO_writer *writer, int fd);
+int    IO_writer_open_stream(IO_writer *writer, FILE *stream);
+int    IO_writer_close(IO_writer *writer);
+int    IO_writer_flush(IO_writer *writer);
+void   IO_writer_room(IO_writer *writer, size_t n);
+void   IO_writer_printf(IO_writer *writer, char const *format, ...);
+int    IO_writer_rows(IO_writer *writer, Matrix const *M,
+                      IO_writer_rows_fn fn);
+size_t IO_vtoa(val_t x, int prec, char *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/*! Make room for at least IO_WRITER_SLACK bytes. */
+/*----------------------------------------------------------------------------*/
+static inline void
+IO_writer_reserve(IO_writer * const writer)
+{
+  if (writer->cap - writer->len < IO_WRITER_SLACK)
+    IO_writer_room(writer, IO_WRITER_SLACK);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a character. */
+/*----------------------------------------------------------------------------*/
+static inline void
+IO_writer_putc(IO_writer * const writer, char const c)
+{
+  IO_writer_reserve(writer);
+  writer->buf[writer->len++] = c;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a string. */
+/*----------------------------------------------------------------------------*/
+static inline void
+IO_writer_puts(IO_writer * const writer, char const * const s)
+{
+  size_t const n = strlen(s);
+
+  if (writer->cap - writer->len < n)
+    IO_writer_room(writer, n);
+  if (writer->cap - writer->len < n)
+    return;
+
+  memcpy(writer->buf + writer->len, s, n);
+  writer->len += n;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Format an unsigned integer in decimal, two digits at a time. Returns the
+ *  number of characters written to buf, which must have room for 20. */
+/*----------------------------------------------------------------------------*/
+static inline size_t
+IO_utoa(uintmax_t x, char * const buf)
+{
+  static char const digits[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+  char tmp[24], * p = tmp + sizeof(tmp);
+
+  while (x >= 100) {
+    unsigned const r = (unsigned)(x % 100);
+    x /= 100;
+    p -= 2;
+    memcpy(p, digits + 2 * r, 2);
+  }
+  if (x >= 10) {
+    p -= 2;
+    memcpy(p, digits + 2 * x, 2);
+  } else {
+    *--p = (char)('0' + x);
+  }
+
+  size_t const n = (size_t)(tmp + sizeof(tmp) - p);
+  memcpy(buf, p, n);
+
+  return n;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write an index. */
+/*----------------------------------------------------------------------------*/
+static inline void
+IO_writer_puti(IO_writer * const writer, ind_t const x)
+{
+  IO_writer_reserve(writer);
+  writer->len += IO_utoa((uintmax_t)x, writer->buf + writer->len);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a value, with as many significant digits as the precision option
+ *  allows, and no more than it takes to read back exactly. */
+/*----------------------------------------------------------------------------*/
+static inline void
+IO_writer_putv(IO_writer * const writer, val_t const x)
+{
+  IO_writer_reserve(writer);
+  writer->len += IO_vtoa(x, IO_opts.precision, writer->buf + writer->len);
+}
+
+#endif /* EFIKA_IO_WRITER_H */
@@ -0,0 +1,202 @@
+/* SPDX-License-Identifier: MIT */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/core/gc.h"
+#include "efika/core/pp.h"
+#include "efika/io/index.h"
+#include "efika/io/reader.h"
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Shim to allow fclose to be registered. */
+/*----------------------------------------------------------------------------*/
+static inline void
+vfclose(FILE * file)
+{
+  (void)fclose(file);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Name of the index of filename: index itself, or the sidecar filename.idx
+ *  when index is NULL. The name must be released with free. */
+/*----------------------------------------------------------------------------*/
+static char *
+index_name(char const * const filename, char const * const index)
+{
+  char const * const sfx = (NULL == index) ? ".idx" : "";
+  char const * const pfx = (NULL == index) ? filename : index;
+
+  size_t const len = strlen(pfx) + strlen(sfx) + 1;
+  char * const name = malloc(len);
+  if (NULL == name)
+    return NULL;
+
+  (void)snprintf(name, len, "%s%s", pfx, sfx);
+
+  return name;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Record the size and modification time of filename in hdr. */
+/*----------------------------------------------------------------------------*/
+static int
+index_stat(char const * const filename, IO_index_header * const hdr)
+{
+  struct stat st;
+
+  if (0 != stat(filename, &st))
+    return -1;
+
+  hdr->size  = (uint64_t)st.st_size;
+  hdr->mtime = (int64_t)st.st_mtime;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Build the line-offset index of filename, with an entry every stride rows
+ *  (IO_INDEX_STRIDE when 0), and write it to index (filename.idx when NULL).
+ *  Lines starting with comment are skipped. */
+/*----------------------------------------------------------------------------*/
+int
+IO_index_build(char const * const filename, char const * const index,
+               size_t const stride, char const comment)
+{
+  /* ...garbage collected function... */
+  GC_func_init();
+
+  intmax_t len;
+  char const * line;
+  IO_reader reader;
+  IO_index_header hdr;
+
+  /* validate input */
+  if (!pp_all(filename))
+    return -1;
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, IO_INDEX_MAGIC, sizeof(hdr.magic));
+  hdr.version = IO_INDEX_VERSION;
+  hdr.bom     = IO_INDEX_BOM;
+  hdr.stride  = (0 < stride) ? (uint64_t)stride : IO_INDEX_STRIDE;
+
+  char * const name = index_name(filename, index);
+  GC_assert(name);
+  GC_register_free(free, name);
+
+  GC_assert(0 == index_stat(filename, &hdr));
+
+  /* open input file */
+  GC_assert(0 == IO_reader_open(&reader, filename));
+  GC_register_free(IO_reader_close, &reader);
+  reader.comment = comment;
+
+  /* skip the header */
+  do {
+    len = IO_reader_getline(&reader, &line);
+  } while (0 < len && comment == line[0]);
+  GC_assert(0 < len);
+
+  size_t cap = 1024;
+  uint64_t * off = GC_malloc(cap * sizeof(*off));
+
+  /* record the offset of every stride-th row */
+  while (1) {
+    uint64_t const pos = IO_reader_tell(&reader);
+
+    if (0 >= (len = IO_reader_getline(&reader, &line)))
+      break;
+    if (comment == line[0])
+      continue;
+
+    if (0 == hdr.nrows % hdr.stride) {
+      size_t const k = (size_t)(hdr.nrows / hdr.stride);
+      if (k == cap) {
+        cap *= 2;
+        off = GC_realloc(off, cap * sizeof(*off));
+      }
+      off[k] = pos;
+    }
+    hdr.nrows++;
+  }
+  GC_assert(-1 == len);
+
+  size_t const nent = (size_t)((hdr.nrows + hdr.stride - 1) / hdr.stride);
+
+  /* write index file */
+  FILE * ostream = fopen(name, "wb");
+  GC_assert(ostream);
+  GC_register_free(vfclose, ostream);
+
+  GC_assert(1 == fwrite(&hdr, sizeof(hdr), 1, ostream));
+  GC_assert(nent == fwrite(off, sizeof(*off), nent, ostream));
+  GC_assert(0 == fflush(ostream));
+
+  GC_free(ostream);
+  GC_free(off);
+  GC_free(&reader);
+  GC_free(name);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Reposition reader, which must have been opened on filename and have read
+ *  its header, at the nearest indexed row at or before row, as found in
+ *  index (filename.idx when NULL), and store that row in *first. Fails,
+ *  leaving reader untouched, unless the index exists, matches the current
+ *  filename and covers row. */
+/*----------------------------------------------------------------------------*/
+int
+IO_index_seek(IO_reader * const reader, char const * const filename,
+              char const * const index, ind_t const row, ind_t * const first)
+{
+  IO_index_header hdr, cur;
+  uint64_t off;
+  int ret = -1;
+
+  /* validate input */
+  if (!pp_all(reader, filename, first))
+    return -1;
+
+  char * const name = index_name(filename, index);
+  if (NULL == name)
+    return -1;
+
+  FILE * const istream = fopen(name, "rb");
+  free(name);
+  if (NULL == istream)
+    return -1;
+
+  if (1 == fread(&hdr, sizeof(hdr), 1, istream) &&
+      0 == memcmp(hdr.magic, IO_INDEX_MAGIC, sizeof(hdr.magic)) &&
+      IO_INDEX_VERSION == hdr.version && IO_INDEX_BOM == hdr.bom &&
+      0 < hdr.stride && (uint64_t)row < hdr.nrows &&
+      0 == index_stat(filename, &cur) && cur.size == hdr.size &&
+      cur.mtime == hdr.mtime)
+  {
+    uint64_t const k = (uint64_t)row / hdr.stride;
+
+    if ((uint64_t)(long)(sizeof(hdr) + k * sizeof(off)) ==
+          sizeof(hdr) + k * sizeof(off) &&
+        0 == fseek(istream, (long)(sizeof(hdr) + k * sizeof(off)), SEEK_SET) &&
+        1 == fread(&off, sizeof(off), 1, istream) && off <= hdr.size &&
+        0 == IO_reader_seek(reader, off))
+    {
+      *first = (ind_t)(k * hdr.stride);
+      ret = 0;
+    }
+  }
+
+  (void)fclose(istream);
+
+  return ret;
+}
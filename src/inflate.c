@@ -0,0 +1,291 @@
+/* SPDX-License-Identifier: MIT */
+#ifdef HAVE_ZLIB
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "efika/io/inflate.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Decompression pipeline state. Buffers [head, head+count) (mod NBUF) hold
+ *  inflated data, the first of which is being parsed when held is set, and
+ *  the producer fills buffer tail whenever count < NBUF. */
+/*----------------------------------------------------------------------------*/
+struct IO_inflate {
+  gzFile          file;   /*!< compressed input */
+  pthread_t       thread; /*!< producer */
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+
+  char *          buf[IO_INFLATE_NBUF];
+  size_t          len[IO_INFLATE_NBUF];
+  int             head;   /*!< first filled buffer */
+  int             tail;   /*!< next buffer to fill */
+  int             count;  /*!< number of filled buffers */
+  int             eof;    /*!< producer reached end of input */
+  int             err;    /*!< producer failed */
+  int             stop;   /*!< producer has been asked to stop */
+  int             run;    /*!< producer has been started and not joined */
+
+  int             held;   /*!< the parser is reading buffer head */
+  char const *    p;      /*!< next unread byte of buffer head */
+  char const *    end;    /*!< end of buffer head */
+  char *          line;   /*!< lines straddling two buffers */
+  size_t          n;      /*!< size of line */
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Producer: inflate into free buffers until end of input. */
+/*----------------------------------------------------------------------------*/
+static void *
+inflate_main(void * const arg)
+{
+  IO_inflate * const gz = arg;
+
+  for (;;) {
+    (void)pthread_mutex_lock(&gz->lock);
+    while (IO_INFLATE_NBUF == gz->count && !gz->stop)
+      (void)pthread_cond_wait(&gz->cond, &gz->lock);
+    int const t = gz->tail;
+    int const stop = gz->stop;
+    (void)pthread_mutex_unlock(&gz->lock);
+
+    if (stop)
+      break;
+
+    int const k = gzread(gz->file, gz->buf[t], IO_INFLATE_BUFSIZE);
+
+    int e = Z_OK;
+    if (0 == k)
+      (void)gzerror(gz->file, &e);
+
+    (void)pthread_mutex_lock(&gz->lock);
+    if (0 < k) {
+      gz->len[t] = (size_t)k;
+      gz->tail   = (t + 1) % IO_INFLATE_NBUF;
+      gz->count++;
+    } else if (0 == k && Z_OK == e) {
+      gz->eof = 1;
+    } else {
+      gz->err = 1;
+    }
+    (void)pthread_cond_broadcast(&gz->cond);
+    (void)pthread_mutex_unlock(&gz->lock);
+
+    if (0 >= k)
+      break;
+  }
+
+  return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Release the buffer being parsed and wait for the next one. Returns 1 when a
+ *  buffer is available, 0 at end of input, and -1 on error. */
+/*----------------------------------------------------------------------------*/
+static int
+inflate_next(IO_inflate * const gz)
+{
+  int ret = 1;
+
+  (void)pthread_mutex_lock(&gz->lock);
+
+  if (gz->held) {
+    gz->head = (gz->head + 1) % IO_INFLATE_NBUF;
+    gz->count--;
+    gz->held = 0;
+    (void)pthread_cond_broadcast(&gz->cond);
+  }
+
+  while (0 == gz->count && !gz->eof && !gz->err)
+    (void)pthread_cond_wait(&gz->cond, &gz->lock);
+
+  if (0 < gz->count) {
+    gz->p    = gz->buf[gz->head];
+    gz->end  = gz->p + gz->len[gz->head];
+    gz->held = 1;
+  } else {
+    ret = gz->err ? -1 : 0;
+  }
+
+  (void)pthread_mutex_unlock(&gz->lock);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Start a decompression pipeline on fd, or on filename when fd is -1. The
+ *  pipeline owns the descriptor. Input that is not compressed is passed
+ *  through unchanged. */
+/*----------------------------------------------------------------------------*/
+int
+IO_inflate_open(IO_inflate ** const gzp, int const fd,
+                char const * const filename)
+{
+  IO_inflate * const gz = calloc(1, sizeof(*gz));
+  if (NULL == gz)
+    return -1;
+
+  gz->file = (-1 == fd) ? gzopen(filename, "rb") : gzdopen(fd, "rb");
+  if (NULL == gz->file) {
+    free(gz);
+    return -1;
+  }
+  (void)gzbuffer(gz->file, 1 << 18);
+
+  for (int i = 0; i < IO_INFLATE_NBUF; i++) {
+    gz->buf[i] = malloc(IO_INFLATE_BUFSIZE);
+    if (NULL == gz->buf[i])
+      goto error;
+  }
+
+  if (0 != pthread_mutex_init(&gz->lock, NULL))
+    goto error;
+  if (0 != pthread_cond_init(&gz->cond, NULL)) {
+    (void)pthread_mutex_destroy(&gz->lock);
+    goto error;
+  }
+  if (0 != pthread_create(&gz->thread, NULL, inflate_main, gz)) {
+    (void)pthread_cond_destroy(&gz->cond);
+    (void)pthread_mutex_destroy(&gz->lock);
+    goto error;
+  }
+  gz->run = 1;
+
+  *gzp = gz;
+
+  return 0;
+
+  error:
+  for (int i = 0; i < IO_INFLATE_NBUF; i++)
+    free(gz->buf[i]);
+  (void)gzclose(gz->file);
+  free(gz);
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Stop the producer. */
+/*----------------------------------------------------------------------------*/
+static void
+inflate_stop(IO_inflate * const gz)
+{
+  if (!gz->run)
+    return;
+
+  (void)pthread_mutex_lock(&gz->lock);
+  gz->stop = 1;
+  (void)pthread_cond_broadcast(&gz->cond);
+  (void)pthread_mutex_unlock(&gz->lock);
+
+  (void)pthread_join(gz->thread, NULL);
+  gz->run = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Restart a decompression pipeline at the beginning of its input, which must
+ *  be seekable. */
+/*----------------------------------------------------------------------------*/
+int
+IO_inflate_rewind(IO_inflate * const gz)
+{
+  inflate_stop(gz);
+
+  gz->head = gz->tail = gz->count = 0;
+  gz->eof  = gz->err  = gz->stop  = 0;
+  gz->held = 0;
+  gz->p    = gz->end  = NULL;
+
+  if (0 != gzrewind(gz->file)) {
+    gz->err = 1;
+    return -1;
+  }
+
+  if (0 != pthread_create(&gz->thread, NULL, inflate_main, gz)) {
+    gz->err = 1;
+    return -1;
+  }
+  gz->run = 1;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Stop a decompression pipeline and release its resources. */
+/*----------------------------------------------------------------------------*/
+void
+IO_inflate_close(IO_inflate * const gz)
+{
+  if (NULL == gz)
+    return;
+
+  inflate_stop(gz);
+  (void)pthread_cond_destroy(&gz->cond);
+  (void)pthread_mutex_destroy(&gz->lock);
+
+  (void)gzclose(gz->file);
+  for (int i = 0; i < IO_INFLATE_NBUF; i++)
+    free(gz->buf[i]);
+  free(gz->line);
+  free(gz);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Get the next line from a decompression pipeline, with the same contract as
+ *  IO_reader_getline. Lines that lie within one buffer are returned in place,
+ *  those that straddle buffers are assembled in a separate line buffer. */
+/*----------------------------------------------------------------------------*/
+intmax_t
+IO_inflate_getline(IO_inflate * const gz, char const ** const lineptr)
+{
+  size_t len = 0;
+
+  for (;;) {
+    if (gz->p == gz->end) {
+      int const ret = inflate_next(gz);
+      if (-1 == ret)
+        return -2;
+      if (0 == ret)
+        break;
+    }
+
+    char const * const eol = memchr(gz->p, '\n', (size_t)(gz->end - gz->p));
+    size_t const k = (size_t)((NULL == eol ? gz->end : eol + 1) - gz->p);
+
+    if (0 == len && NULL != eol) {
+      *lineptr = gz->p;
+      gz->p   += k;
+      return (intmax_t)k;
+    }
+
+    if (len + k > gz->n) {
+      size_t n = gz->n ? gz->n : 1024;
+      while (n < len + k)
+        n *= 2;
+
+      char * const line = realloc(gz->line, n);
+      if (NULL == line)
+        return -2;
+
+      gz->line = line;
+      gz->n    = n;
+    }
+
+    memcpy(gz->line + len, gz->p, k);
+    len   += k;
+    gz->p += k;
+
+    if (NULL != eol)
+      break;
+  }
+
+  if (0 == len)
+    return -1;
+
+  *lineptr = gz->line;
+
+  return (intmax_t)len;
+}
+#endif
@@ -9,181 +9,780 @@
 
 #include "efika/core/gc.h"
 #include "efika/core/pp.h"
-#include "efika/io/getline.h"
+#include "efika/io/cache.h"
+#include "efika/io/index.h"
+#include "efika/io/metis.h"
+#include "efika/io/options.h"
+#include "efika/io/reader.h"
 #include "efika/io/rename.h"
-
-/*----------------------------------------------------------------------------*/
-/*! Shim to allow fclose to be registered. */
-/*----------------------------------------------------------------------------*/
-static inline void
-vfclose(FILE * file)
-{
-  (void)fclose(file);
-}
+#include "efika/io/rows.h"
+#include "efika/io/scan.h"
+#include "efika/io/slab.h"
+#include "efika/io/sort.h"
+#include "efika/io/stats.h"
+#include "efika/io/touch.h"
+#include "efika/io/writer.h"
 
 /*----------------------------------------------------------------------------*/
 /*! Get next non-comment line from a file. */
 /*----------------------------------------------------------------------------*/
 static inline intmax_t
-getline_nc(char ** const lineptr, size_t * const n, FILE * const istream)
+getline_nc(IO_reader * const reader, char const ** const lineptr)
 {
   intmax_t ret;
 
   /* skip comment lines */
   do {
-    ret = IO_getline(lineptr, n, istream);
+    ret = IO_reader_getline(reader, lineptr);
   } while (0 < ret && '%' == *lineptr[0]);
 
   return ret;
 }
 
+/*----------------------------------------------------------------------------*/
+/*! Parse the header line, returning the number of fields converted. */
+/*----------------------------------------------------------------------------*/
+static inline int
+metis_scan_header(char const * const line, char const * const eol,
+                  ind_t * const nr, ind_t * const nnz, int * const fmt,
+                  ind_t * const ncon)
+{
+  char const * p, * q;
+
+  *nr = IO_strtoi(line, eol, &q);
+  if (q == line)
+    return 0;
+  *nnz = IO_strtoi(p = q, eol, &q);
+  if (q == p)
+    return 1;
+  *fmt = (int)IO_strtoi(p = q, eol, &q);
+  if (q == p)
+    return 2;
+  *ncon = IO_strtoi(p = q, eol, &q);
+  if (q == p)
+    return 3;
+  return 4;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Read and validate the header of a metis file, which is its first
+ *  non-comment line. The number of edges is stored in *nnz. */
+/*----------------------------------------------------------------------------*/
+int
+IO_metis_header(IO_reader * const reader, ind_t * const nr, ind_t * const nnz,
+                int * const fmt, ind_t * const ncon)
+{
+  intmax_t len;
+  char const * line;
+
+  /* get first non-comment line in file */
+  if (0 >= (len = getline_nc(reader, &line)))
+    return -1;
+
+  switch (metis_scan_header(line, line + len, nr, nnz, fmt, ncon)) {
+    case 4:
+    /* validate */
+    if (0 == *ncon)
+      return -1;
+    if ( 10 != *fmt &&  11 != *fmt && 110 != *fmt && 111 != *fmt)
+      return -1;
+    /* fall through */
+
+    case 3:
+    /* validate */
+    if (  0 != *fmt &&   1 != *fmt &&  10 != *fmt &&  11 != *fmt &&
+        100 != *fmt && 101 != *fmt && 110 != *fmt && 111 != *fmt)
+      return -1;
+    /* fall through */
+
+    case 2:
+    return 0;
+
+    default:
+    return -1;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Count the rows and non-zeros in a byte range of metis rows, as well as the
+ *  lines and comment lines. The non-zeros of a row follow from its number of
+ *  fields. When deg is not NULL, the non-zeros of the k-th row counted are
+ *  also stored in deg[k]. */
+/*----------------------------------------------------------------------------*/
+static int
+metis_count(char const * cur, char const * const end, int const fmt,
+            ind_t const ncon, uint64_t * const nrows, uint64_t * const nnnz,
+            uint64_t * const lines, uint64_t * const comments,
+            ind_t * const deg)
+{
+  intmax_t len;
+  char const * line;
+
+  size_t const lead = (size_t)has_vtxsiz(fmt) + (has_vtxwgt(fmt) ? ncon : 0);
+  size_t const step = (size_t)(1 + has_adjwgt(fmt));
+
+  while (0 < (len = IO_nextline(&cur, end, &line))) {
+    ++*lines;
+    if ('%' == line[0]) {
+      ++*comments;
+      continue;
+    }
+
+    size_t const ntok = IO_ntokens(line, line + len);
+    if (ntok < lead || 0 != (ntok - lead) % step)
+      return -1;
+
+    if (NULL != deg)
+      deg[*nrows] = (ind_t)((ntok - lead) / step);
+
+    *nnnz += (ntok - lead) / step;
+    ++*nrows;
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse a byte range of metis rows, starting at row i and non-zero nnnz, into
+ *  their final positions, sorting each row as soon as it is parsed when buf is
+ *  not NULL. */
+/*----------------------------------------------------------------------------*/
+static int
+metis_fill(char const * cur, char const * const end, int const fmt,
+           ind_t const ncon, ind_t i, ind_t nnnz, ind_t * const ia,
+           ind_t * const ja, val_t * const a, val_t * const vwgt,
+           ind_t * const vsiz, IO_sort * const buf)
+{
+  intmax_t len;
+  char const * line, * p, * q;
+
+  size_t const lead = (size_t)has_vtxsiz(fmt) + (has_vtxwgt(fmt) ? ncon : 0);
+  size_t const step = (size_t)(1 + has_adjwgt(fmt));
+
+  for (; 0 < (len = IO_nextline(&cur, end, &line)); i++) {
+    if ('%' == line[0]) {
+      i--;
+      continue;
+    }
+
+    char const * const eol = line + len;
+
+    /* ...the non-zeros reserved for this row by metis_count... */
+    ind_t const first = nnnz;
+    ind_t const last = nnnz + (ind_t)((IO_ntokens(line, eol) - lead) / step);
+
+    p = line;
+    if (has_vtxsiz(fmt)) {
+      vsiz[i] = IO_strtoi(p, eol, &q);
+      if (q == p)
+        return -1;
+      p = q;
+    }
+
+    if (has_vtxwgt(fmt)) {
+      for (ind_t j = 0; j < ncon; j++) {
+        vwgt[i * ncon + j] = IO_strtov(p, eol, &q);
+        if (q == p)
+          return -1;
+        p = q;
+      }
+    }
+
+    while (1) {
+      ind_t const v = IO_strtoi(p, eol, &q);
+      if (q == p)
+        break;
+      p = q;
+
+      /* insist that the row stays within its reserved non-zeros */
+      if (nnnz == last)
+        return -1;
+
+      ja[nnnz] = v - 1;
+
+      if (has_adjwgt(fmt)) {
+        a[nnnz] = IO_strtov(p, eol, &q);
+        if (q == p)
+          return -1;
+        p = q;
+      }
+
+      nnnz++;
+    }
+
+    /* insist that the whole line was consumed */
+    if (nnnz != last || eol != IO_skipspace(p, eol))
+      return -1;
+
+    if (NULL != buf && 0 != IO_sort_row(nnnz - first, ja + first,
+                                        (NULL != a) ? a + first : NULL, buf))
+      return -1;
+
+    ia[i+1] = nnnz;
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse a metis file from an open input source. */
+/*----------------------------------------------------------------------------*/
+static int
+metis_parse(IO_reader * const reader, Matrix * const M)
+{
+  /* ...garbage collected function... */
+  GC_func_init();
+
+  int fmt = 0;
+  intmax_t len;
+  ind_t i, j;
+  ind_t nr, nnz, nnnz, ncon = 0;
+  char const * line, * p, * q;
+
+  reader->comment = '%';
+
+  /* read the file header */
+  GC_assert(0 == IO_metis_header(reader, &nr, &nnz, &fmt, &ncon));
+  nnz *= 2;
+
+  IO_stats_phase(IO_PHASE_PARSE);
+
+  /* allocate memory for /M/ */
+  IO_csr csr;
+  GC_assert(0 == IO_csr_alloc(&csr, nr, nnz, has_adjwgt(fmt),
+                              has_vtxwgt(fmt) ? ncon : 0, has_vtxsiz(fmt)));
+  GC_register_free(IO_csr_free, &csr);
+
+  ind_t * const ia   = csr.ia;
+  ind_t * const ja   = csr.ja;
+  val_t * const a    = csr.a;
+  val_t * const vwgt = csr.vwgt;
+  ind_t * const vsiz = csr.vsiz;
+
+  int const nthreads = (NULL != reader->base) ? IO_nthreads() : 1;
+
+  /* ...placing the non-zeros needs the row pointers before the fill... */
+  if (1 < nthreads || (NULL != reader->base && IO_touch_on())) {
+    /* split the remaining lines into one newline-aligned range per thread */
+    char const ** const bounds = GC_malloc((nthreads + 1) * sizeof(*bounds));
+    GC_assert(0 == IO_reader_split(reader, nthreads, bounds));
+
+    /* count the rows and non-zeros of each range */
+    uint64_t * const rows = GC_calloc(nthreads + 1, sizeof(*rows));
+    uint64_t * const nzs  = GC_calloc(nthreads + 1, sizeof(*nzs));
+
+    int err = 0;
+    uint64_t lines = 0, comments = 0;
+    #pragma omp parallel for num_threads(nthreads) schedule(static, 1) \
+      reduction(|:err) reduction(+:lines,comments)
+    for (int t = 0; t < nthreads; t++) {
+      uint64_t tlines = 0, tcomments = 0;
+      err |= metis_count(bounds[t], bounds[t+1], fmt, ncon, rows + t + 1,
+                         nzs + t + 1, &tlines, &tcomments, NULL);
+      lines    += tlines;
+      comments += tcomments;
+    }
+    GC_assert(0 == err);
+
+    reader->lines    += lines;
+    reader->comments += comments;
+
+    /* ...each range starts where the ranges before it end... */
+    for (int t = 0; t < nthreads; t++) {
+      rows[t+1] += rows[t];
+      nzs[t+1]  += nzs[t];
+    }
+    GC_assert((uint64_t)nr == rows[nthreads]);
+    GC_assert((uint64_t)nnz == nzs[nthreads]);
+
+    IO_stats_phase(IO_PHASE_BUILD);
+
+    if (IO_touch_on()) {
+      /* count again, recording the row lengths, to place the non-zeros */
+      #pragma omp parallel for num_threads(nthreads) schedule(static, 1) \
+        reduction(|:err)
+      for (int t = 0; t < nthreads; t++) {
+        uint64_t trows = 0, tnzs = 0, tlines = 0, tcomments = 0;
+        err |= metis_count(bounds[t], bounds[t+1], fmt, ncon, &trows, &tnzs,
+                           &tlines, &tcomments, ia + 1 + rows[t]);
+      }
+      GC_assert(0 == err);
+
+      ia[0] = 0;
+      for (i = 0; i < nr; i++)
+        ia[i+1] += ia[i];
+      IO_touch_nnz(nr, ia, ja, a);
+    }
+
+    /* parse each range into its rows */
+    ia[0] = 0;
+    #pragma omp parallel for num_threads(nthreads) schedule(static, 1) \
+      reduction(|:err)
+    for (int t = 0; t < nthreads; t++) {
+      IO_sort buf = { NULL, NULL, 0 };
+      err |= metis_fill(bounds[t], bounds[t+1], fmt, ncon, (ind_t)rows[t],
+                        (ind_t)nzs[t], ia, ja, a, vwgt, vsiz,
+                        IO_opts.sort ? &buf : NULL);
+      IO_sort_free(&buf);
+    }
+    GC_assert(0 == err);
+
+    GC_free(nzs);
+    GC_free(rows);
+    GC_free(bounds);
+  } else {
+    IO_sort buf = { NULL, NULL, 0 };
+    GC_register_free(IO_sort_free, &buf);
+
+    ia[0] = 0;
+    for (nnnz = 0, i = 0; i < nr; i++) {
+      GC_assert(0 < (len = getline_nc(reader, &line)));
+
+      char const * const eol = line + len;
+
+      p = line;
+      if (has_vtxsiz(fmt)) {
+        vsiz[i] = IO_strtoi(p, eol, &q);
+        GC_assert(q != p);
+        p = q;
+      }
+
+      if (has_vtxwgt(fmt)) {
+        for (j = 0; j < ncon; j++) {
+          vwgt[i * ncon + j] = IO_strtov(p, eol, &q);
+          GC_assert(q != p);
+          p = q;
+        }
+      }
+
+      while (1) {
+        ind_t const v = IO_strtoi(p, eol, &q);
+        if (q == p)
+          break;
+        p = q;
+
+        /* insist that not all non-zeros have already been read */
+        GC_assert(nnnz < nnz);
+
+        ja[nnnz] = v - 1;
+
+        if (has_adjwgt(fmt)) {
+          a[nnnz] = IO_strtov(p, eol, &q);
+          GC_assert(q != p);
+          p = q;
+        }
+
+        nnnz++;
+      }
+
+      /* insist that the whole line was consumed */
+      GC_assert(eol == IO_skipspace(p, eol));
+
+      if (IO_opts.sort)
+        GC_assert(0 == IO_sort_row(nnnz - ia[i], ja + ia[i],
+                                   (NULL != a) ? a + ia[i] : NULL, &buf));
+
+      ia[i+1] = nnnz;
+    }
+    GC_assert(nnnz == nnz);
+
+    while (0 < IO_reader_getline(reader, &line))
+      GC_assert('%' == line[0]);
+
+    GC_free(&buf);
+  }
+
+  M->fmt   = fmt;
+  /*M->diag  = 0;*/
+  M->sort  = IO_opts.sort ? ASC : NONE;
+  M->symm  = 1;
+  M->nr    = nr;
+  M->nc    = nr;
+  M->nnz   = nnz;
+  M->ia    = ia;
+  M->ja    = ja;
+  M->a     = a;
+  M->ncon  = ncon;
+  M->vsiz  = vsiz;
+  M->vwgt  = vwgt;
+
+  return 0;
+}
+
 /*----------------------------------------------------------------------------*/
 /*! Function to read a metis file. */
 /*----------------------------------------------------------------------------*/
+static int
+metis_load(char const * const filename, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  /* open input file */
+  if (0 != IO_reader_open(&reader, filename))
+    return -1;
+
+  int const ret = metis_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a metis file, through the binary cache when enabled. */
+/*----------------------------------------------------------------------------*/
 EFIKA_EXPORT int
 IO_metis_load(char const * const filename, Matrix * const M)
+{
+  return IO_cache_load(IO_METIS, filename, M, metis_load);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a metis file from descriptor fd, such as a pipe or socket,
+ *  which is read from its current position to its end and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_metis_load_fd(int const fd, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_fd(&reader, fd))
+    return -1;
+
+  int const ret = metis_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a metis file from stream, which is read from its current
+ *  position to its end and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_metis_load_stream(FILE * const stream, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_stream(&reader, stream))
+    return -1;
+
+  int const ret = metis_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a metis file from the len bytes at buf, which are parsed in
+ *  place and left untouched. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_metis_load_mem(char const * const buf, size_t const len, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(buf, M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_mem(&reader, buf, len))
+    return -1;
+
+  int const ret = metis_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to build the line-offset index of a metis file, with an entry
+ *  every stride rows (a default when 0), in index (filename.idx when NULL). */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_metis_index(char const * const filename, char const * const index,
+               size_t const stride)
+{
+  return IO_index_build(filename, index, stride, '%');
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read rows [r0, r1) of a metis file into a matrix of r1-r0 rows
+ *  with global column indices. Reading starts from the nearest row recorded in
+ *  the index built by IO_metis_index (filename.idx when NULL); without a usable
+ *  index, the preceding rows are skipped line by line. The rows of a graph do
+ *  not form a symmetric matrix, so M->symm is 0. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_metis_load_range(char const * const filename, char const * const index,
+                    ind_t const r0, ind_t const r1, Matrix * const M)
 {
   /* ...garbage collected function... */
   GC_func_init();
 
   int fmt = 0;
-  size_t n = 0;
+  intmax_t len;
   ind_t i, j;
   ind_t nr, nnz, nnnz, ncon = 0;
-  char * tok, * line = NULL;
+  char const * line, * p, * q;
+  IO_reader reader;
 
   /* validate input */
-  if (!pp_all(filename, M))
+  if (!pp_all(filename, M) || r0 > r1)
     return -1;
 
-  /* register line with the garbage collector */
-  GC_register(&line);
-
   /* open input file */
-  FILE * istream = fopen(filename, "r");
-  GC_assert(istream);
-  GC_register_free(vfclose, istream);
+  GC_assert(0 == IO_reader_open(&reader, filename));
+  GC_register_free(IO_reader_close, &reader);
+  reader.comment = '%';
 
-  /* get first non-comment line in file */
-  GC_assert(0 < getline_nc(&line, &n, istream));
+  /* read the file header */
+  GC_assert(0 == IO_metis_header(&reader, &nr, &nnz, &fmt, &ncon));
+  GC_assert(r1 <= nr);
 
-  switch (sscanf(line, PRIind" "PRIind" %d "PRIind"\n", &nr, &nnz, &fmt, &ncon)) {
-    case 4:
-    /* validate */
-    if (0 == ncon)
-      GC_return -1;
-    if ( 10 != fmt &&  11 != fmt && 110 != fmt && 111 != fmt)
-      GC_return -1;
-    /* fall through */
+  IO_stats_phase(IO_PHASE_PARSE);
 
-    case 3:
-    /* validate */
-    if (  0 != fmt &&   1 != fmt &&  10 != fmt &&  11 != fmt && 100 != fmt &&
-        101 != fmt && 110 != fmt && 111 != fmt)
-      GC_return -1;
-    /* fall through */
+  /* skip to row r0, from the nearest indexed row if there is one */
+  ind_t first = r0;
+  if (r0 < r1 && 0 != IO_index_seek(&reader, filename, index, r0, &first))
+    first = 0;
+  for (i = first; i < r0; i++)
+    GC_assert(0 < getline_nc(&reader, &line));
 
-    case 2:
-    nnz *= 2;
-    break;
+  IO_stats_phase(IO_PHASE_BUILD);
 
-    default:
-    GC_return -1;
-  }
+  /* ...start from the average share of the non-zeros... */
+  ind_t const n = r1 - r0;
+  ind_t cap = (ind_t)(0 < nr ? 2 * (uint64_t)nnz * n / nr : 0) + 1;
 
-  ind_t * const ia = GC_malloc((nr + 1) * sizeof(*ia));
-  ind_t * const ja = GC_malloc(nnz * sizeof(*ja));
+  ind_t * const ia = GC_malloc((n + 1) * sizeof(*ia));
+  ind_t * ja = GC_malloc(cap * sizeof(*ja));
   val_t *a = NULL;
   val_t *vwgt = NULL;
   ind_t *vsiz = NULL;
   if (has_adjwgt(fmt))
-    a = GC_malloc(nnz * sizeof(*a));
+    a = GC_malloc(cap * sizeof(*a));
   if (has_vtxwgt(fmt))
-    vwgt = GC_malloc(ncon * nr * sizeof(*vwgt));
+    vwgt = GC_malloc(ncon * n * sizeof(*vwgt));
   if (has_vtxsiz(fmt))
-    vsiz = GC_malloc(nr * sizeof(*vsiz));
+    vsiz = GC_malloc(n * sizeof(*vsiz));
+
+  IO_sort buf = { NULL, NULL, 0 };
+  GC_register_free(IO_sort_free, &buf);
 
   ia[0] = 0;
-  for (nnnz = 0, i = 0; i < nr; i++) {
-    GC_assert(0 < getline_nc(&line, &n, istream));
+  for (nnnz = 0, i = 0; i < n; i++) {
+    GC_assert(0 < (len = getline_nc(&reader, &line)));
 
-    tok = strtok(line, " \t\n");
-    if (has_vtxsiz(fmt)) {
-      GC_assert(NULL != tok);
+    char const * const eol = line + len;
 
-      vsiz[i] = strtoi(tok, NULL);
-      tok = strtok(NULL, " \t\n");
+    p = line;
+    if (has_vtxsiz(fmt)) {
+      vsiz[i] = IO_strtoi(p, eol, &q);
+      GC_assert(q != p);
+      p = q;
     }
 
     if (has_vtxwgt(fmt)) {
       for (j = 0; j < ncon; j++) {
-        GC_assert(NULL != tok);
-
-        vwgt[i * ncon + j] = strtov(tok, NULL);
-        tok = strtok(NULL, " \t\n");
+        vwgt[i * ncon + j] = IO_strtov(p, eol, &q);
+        GC_assert(q != p);
+        p = q;
       }
     }
 
-    while (NULL != tok) {
-      ja[nnnz] = strtoi(tok, NULL) - 1;
-      tok = strtok(NULL, " \t\n");
+    while (1) {
+      ind_t const v = IO_strtoi(p, eol, &q);
+      if (q == p)
+        break;
+      p = q;
 
-      if (has_adjwgt(fmt)) {
-        GC_assert(NULL != tok);
+      /* insist that the vertex exists */
+      GC_assert(0 < v && v <= nr);
 
-        a[nnnz] = strtov(tok, NULL);
-        tok = strtok(NULL, " \t\n");
+      if (nnnz == cap) {
+        cap *= 2;
+        ja = GC_realloc(ja, cap * sizeof(*ja));
+        if (has_adjwgt(fmt))
+          a = GC_realloc(a, cap * sizeof(*a));
       }
 
-      if (++nnnz == nnz && NULL != tok)
-        GC_return -1;
+      ja[nnnz] = v - 1;
+
+      if (has_adjwgt(fmt)) {
+        a[nnnz] = IO_strtov(p, eol, &q);
+        GC_assert(q != p);
+        p = q;
+      }
+
+      nnnz++;
     }
+
+    /* insist that the whole line was consumed */
+    GC_assert(eol == IO_skipspace(p, eol));
+
+    if (IO_opts.sort)
+      GC_assert(0 == IO_sort_row(nnnz - ia[i], ja + ia[i],
+                                 (NULL != a) ? a + ia[i] : NULL, &buf));
+
     ia[i+1] = nnnz;
   }
-  GC_assert(nnnz == nnz);
 
-  while (!feof(istream) && 0 < IO_getline(&line, &n, istream))
-    GC_assert('%' == line[0]);
+  GC_free(&buf);
+
+  /* ...the size is only known now, so that is when a slab can be made... */
+  IO_csr csr = { ia, ja, a, vwgt, vsiz, 0 };
+  GC_assert(0 == IO_slab_pack(&csr, n, nnnz, has_vtxwgt(fmt) ? ncon : 0));
 
   M->fmt   = fmt;
   /*M->diag  = 0;*/
-  /*M->sort  = NONE;*/
-  M->symm  = 1;
-  M->nr    = nr;
+  M->sort  = IO_opts.sort ? ASC : NONE;
+  M->symm  = 0;
+  M->nr    = n;
   M->nc    = nr;
-  M->nnz   = nnz;
-  M->ia    = ia;
-  M->ja    = ja;
-  M->a     = a;
+  M->nnz   = nnnz;
+  M->ia    = csr.ia;
+  M->ja    = csr.ja;
+  M->a     = csr.a;
   M->ncon  = ncon;
-  M->vsiz  = vsiz;
-  M->vwgt  = vwgt;
+  M->vsiz  = csr.vsiz;
+  M->vwgt  = csr.vwgt;
 
-  GC_free(istream);
-  GC_free(line);
+  GC_free(&reader);
 
   return 0;
 }
 
 /*----------------------------------------------------------------------------*/
-/*! Function to write a metis file. */
+/*! Parse the next row of a metis file into a row block. */
 /*----------------------------------------------------------------------------*/
-EFIKA_EXPORT int
-IO_metis_save(char const * const filename, Matrix const * const M)
+static int
+metis_row(IO_Rows * const rows, size_t const i)
 {
-  /* validate input */
-  if (!pp_all(filename, M))
+  intmax_t len;
+  char const * line, * p, * q;
+
+  /* unpack /rows/ */
+  int   const fmt  = rows->fmt;
+  ind_t const ncon = rows->ncon;
+
+  if (rows->r == rows->nr) {
+    if (rows->nnnz != rows->hnnz)
+      return -1;
+    while (0 < IO_reader_getline(&rows->reader, &line))
+      if ('%' != line[0])
+        return -1;
+    return 1;
+  }
+
+  if (0 >= (len = getline_nc(&rows->reader, &line)))
     return -1;
 
-  /* open output file */
-  FILE * ostream = fopen(filename, "w");
-  if (!ostream)
+  char const * const eol = line + len;
+
+  p = line;
+  if (has_vtxsiz(fmt)) {
+    rows->vsiz[i] = IO_strtoi(p, eol, &q);
+    if (q == p)
+      return -1;
+    p = q;
+  }
+
+  if (has_vtxwgt(fmt)) {
+    for (ind_t j = 0; j < ncon; j++) {
+      rows->vwgt[i * ncon + j] = IO_strtov(p, eol, &q);
+      if (q == p)
+        return -1;
+      p = q;
+    }
+  }
+
+  while (1) {
+    ind_t const v = IO_strtoi(p, eol, &q);
+    if (q == p)
+      break;
+    p = q;
+
+    /* insist that not all non-zeros have already been read */
+    if (rows->nnnz >= rows->hnnz || 0 != IO_rows_room(rows, 1))
+      return -1;
+
+    rows->ja[rows->nnz] = v - 1;
+
+    if (has_adjwgt(fmt)) {
+      rows->a[rows->nnz] = IO_strtov(p, eol, &q);
+      if (q == p)
+        return -1;
+      p = q;
+    }
+
+    rows->nnz++;
+    rows->nnnz++;
+  }
+
+  /* insist that the whole line was consumed */
+  return (eol == IO_skipspace(p, eol)) ? 0 : -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to open a metis file for reading in blocks of rows. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_metis_open(char const * const filename, size_t const blksz,
+              IO_Rows ** const rows)
+{
+  int fmt = 0;
+  ind_t nr, nnz, ncon = 0;
+
+  if (0 != IO_rows_init(rows, filename, blksz, metis_row))
     return -1;
 
+  IO_Rows * const r = *rows;
+  r->reader.comment = '%';
+
+  /* read the file header */
+  if (0 != IO_metis_header(&r->reader, &nr, &nnz, &fmt, &ncon))
+    goto error;
+
+  r->fmt  = fmt;
+  r->symm = 1;
+  r->vals = has_adjwgt(fmt);
+  r->nr   = nr;
+  r->nc   = nr;
+  r->ncon = ncon;
+  r->hnnz = 2 * nnz;
+
+  return 0;
+
+  error:
+  IO_rows_close(r);
+  *rows = NULL;
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Format rows [r0, r1) of a metis file. */
+/*----------------------------------------------------------------------------*/
+static void
+metis_rows(IO_writer * const writer, Matrix const * const M, ind_t const r0,
+           ind_t const r1)
+{
   /* unpack /M/ */
-  int   const fmt = M->fmt;
-  ind_t const nr   = M->nr;
-  ind_t const nnz  = M->nnz;
+  int   const fmt  = M->fmt;
   ind_t const ncon = M->ncon;
   ind_t const * const ia   = M->ia;
   ind_t const * const ja   = M->ja;
@@ -191,29 +790,112 @@ IO_metis_save(char const * const filename, Matrix const * const M)
   val_t const * const vwgt = M->vwgt;
   ind_t const * const vsiz = M->vsiz;
 
-  fprintf(ostream, PRIind" "PRIind, nr, nnz/2);
-  if (fmt > 0)
-    fprintf(ostream, " %03d "PRIind, fmt, ncon);
-  fprintf(ostream, "\n");
-
-  for (ind_t i = 0; i < nr; i++) {
-    if (has_vtxsiz(fmt))
-      fprintf(ostream, PRIind" ", vsiz[i]);
+  for (ind_t i = r0; i < r1; i++) {
+    if (has_vtxsiz(fmt)) {
+      IO_writer_puti(writer, vsiz[i]);
+      IO_writer_putc(writer, ' ');
+    }
 
-    if (has_vtxwgt(fmt))
-      for (ind_t j = 0; j < ncon; j++)
-        fprintf(ostream, PRIval" ", vwgt[i * ncon + j]);
+    if (has_vtxwgt(fmt)) {
+      for (ind_t j = 0; j < ncon; j++) {
+        IO_writer_putv(writer, vwgt[i * ncon + j]);
+        IO_writer_putc(writer, ' ');
+      }
+    }
 
     for (ind_t j = ia[i]; j < ia[i + 1]; j++) {
-      fprintf(ostream, PRIind" ", ja[j]+1);
-      if (has_adjwgt(fmt))
-        fprintf(ostream, PRIval" ", a[j]);
+      IO_writer_puti(writer, ja[j]+1);
+      IO_writer_putc(writer, ' ');
+      if (has_adjwgt(fmt)) {
+        IO_writer_putv(writer, a[j]);
+        IO_writer_putc(writer, ' ');
+      }
     }
-    fprintf(ostream, "\n");
+    IO_writer_putc(writer, '\n');
   }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a metis file to an output sink, closing it. */
+/*----------------------------------------------------------------------------*/
+static int
+metis_write(IO_writer * const writer, Matrix const * const M)
+{
+  IO_stats_phase(IO_PHASE_WRITE);
+
+  /* unpack /M/ */
+  int   const fmt = M->fmt;
+  ind_t const nr   = M->nr;
+  ind_t const nnz  = M->nnz;
+  ind_t const ncon = M->ncon;
+
+  IO_writer_printf(writer, PRIind" "PRIind, nr, nnz/2);
+  if (fmt > 0)
+    IO_writer_printf(writer, " %03d", fmt);
+  if (has_vtxwgt(fmt))
+    IO_writer_printf(writer, " "PRIind, ncon);
+  IO_writer_putc(writer, '\n');
+
+  (void)IO_writer_rows(writer, M, metis_rows);
 
   /* ... */
-  fclose(ostream);
+  return IO_writer_close(writer);
+}
 
-  return 0;
+/*----------------------------------------------------------------------------*/
+/*! Function to write a metis file. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_metis_save(char const * const filename, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  /* open output file */
+  if (0 != IO_writer_open(&writer, filename))
+    return -1;
+
+  return metis_write(&writer, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a metis file to descriptor fd, such as a pipe or socket,
+ *  which is left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_metis_save_fd(int const fd, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open output sink */
+  if (0 != IO_writer_open_fd(&writer, fd))
+    return -1;
+
+  return metis_write(&writer, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a metis file to stream, which is flushed but left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_metis_save_stream(FILE * const stream, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  /* open output sink */
+  if (0 != IO_writer_open_stream(&writer, stream))
+    return -1;
+
+  return metis_write(&writer, M);
 }
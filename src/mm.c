@@ -8,146 +8,428 @@
 
 #include "efika/core/gc.h"
 #include "efika/core/pp.h"
-#include "efika/io/getline.h"
+#include "efika/io/cache.h"
+#include "efika/io/clean.h"
+#include "efika/io/coo.h"
+#include "efika/io/options.h"
+#include "efika/io/reader.h"
 #include "efika/io/rename.h"
+#include "efika/io/rows.h"
+#include "efika/io/scan.h"
+#include "efika/io/slab.h"
+#include "efika/io/sort.h"
+#include "efika/io/stats.h"
+#include "efika/io/touch.h"
+#include "efika/io/writer.h"
 
 /*----------------------------------------------------------------------------*/
-/*! Shim to allow fclose to be registered. */
+/*! Parse a coordinate line, returning the number of fields converted. */
 /*----------------------------------------------------------------------------*/
-static inline void
-vfclose(FILE * file)
+static inline int
+mm_scan(char const * const line, char const * const eol, int const fmt,
+        ind_t * const u, ind_t * const v, val_t * const w)
 {
-  (void)fclose(file);
+  char const * p, * q;
+
+  *u = IO_strtoi(line, eol, &q);
+  if (q == line)
+    return 0;
+  *v = IO_strtoi(p = q, eol, &q);
+  if (q == p)
+    return 1;
+  if (!has_adjwgt(fmt))
+    return 2;
+  *w = IO_strtov(p = q, eol, &q);
+  if (q == p)
+    return 2;
+  return 3;
 }
 
 /*----------------------------------------------------------------------------*/
-/*! Function to read a matrix market file. */
+/*! Parse the header line, skip comment lines, and parse the size line. */
 /*----------------------------------------------------------------------------*/
-EFIKA_EXPORT int
-IO_mm_load(char const * const filename, Matrix * const M)
+static int
+mm_header(IO_reader * const reader, int * const fmt, int * const symm,
+          ind_t * const nr, ind_t * const nc, ind_t * const nnz)
 {
-  /* ...garbage collected function... */
-  GC_func_init();
+  intmax_t len;
+  char const * line, * tok, * eot, * p;
 
-  int fmt = 0, symm = 0;
-  size_t n = 0;
-  ind_t i;
-  ind_t u, v, nr = 0, nc = 0, nnz = 0, nnnz = 0;
-  val_t w;
-  char * line = NULL, * tok = NULL;
+  /* read header line */
+  if (0 >= (len = IO_reader_getline(reader, &line)))
+    return -1;
+  reader->comment = '%';
+  char const * eol = line + len;
+  tok = IO_token(line, eol, &eot);
+  if (!IO_tokeq(tok, eot, "%%MatrixMarket"))
+    return -1;
+  tok = IO_token(eot, eol, &eot);
+  if (!IO_tokeq(tok, eot, "matrix"))
+    return -1;
+  tok = IO_token(eot, eol, &eot);
+  if (!IO_tokeq(tok, eot, "coordinate"))
+    return -1;
+  tok = IO_token(eot, eol, &eot);
+  if (IO_tokeq(tok, eot, "real"))
+    *fmt = 1;
+  else if (!IO_tokeq(tok, eot, "pattern"))
+    return -1;
+  tok = IO_token(eot, eol, &eot);
+  if (IO_tokeq(tok, eot, "symmetric"))
+    *symm = 1;
+  else if (!IO_tokeq(tok, eot, "general"))
+    return -1;
 
-  /* validate input */
-  if (!pp_all(filename, M))
+  /* skip comment lines */
+  while (0 < (len = IO_reader_getline(reader, &line)) && '%' == line[0]);
+  if (0 >= len)
     return -1;
 
-  /* register line with the garbage collector */
-  GC_register(&line);
+  /* read size line */
+  eol = line + len;
+  *nr = IO_strtoi(line, eol, &p);
+  if (p == line)
+    return -1;
+  *nc = IO_strtoi(tok = p, eol, &p);
+  if (p == tok)
+    return -1;
+  *nnz = IO_strtoi(tok = p, eol, &p);
+  if (p == tok)
+    return -1;
 
-  /* open input file */
-  FILE * istream = fopen(filename, "r");
-  GC_assert(istream);
-  GC_register_free(vfclose, istream);
+  return 0;
+}
 
-  /* read header line */
-  GC_assert(0 < IO_getline(&line, &n, istream));
-  GC_assert(NULL != (tok = strtok(line," \t")));
-  GC_assert(0 == memcmp(tok, "%%MatrixMarket", 15));
-  GC_assert(NULL != (tok = strtok(NULL," \t")));
-  GC_assert(0 == memcmp(tok, "matrix", 7));
-  GC_assert(NULL != (tok = strtok(NULL," \t")));
-  GC_assert(0 == memcmp(tok, "coordinate", 11));
-  GC_assert(NULL != (tok = strtok(NULL," ")));
-  if (0 == memcmp(tok, "real", 5))
-    fmt = 1;
-  else
-    GC_assert(0 == memcmp(tok, "pattern", 8));
-  GC_assert(NULL != (tok = strtok(NULL," \t\n")));
-  if (0 == memcmp(tok, "symmetric", 10))
-    symm = 1;
-  else
-    GC_assert(0 == memcmp(tok, "general", 8));
+/*----------------------------------------------------------------------------*/
+/*! Whether entry (u,v) also produces (v,u). Symmetric files (symm 1) store one
+ *  triangle and general matrices that are symmetrized on load (symm 2) gain
+ *  the other, either way by mirroring the off-diagonal entries, so diagonal
+ *  entries are stored once. */
+/*----------------------------------------------------------------------------*/
+static inline int
+mm_mirror(int const symm, ind_t const u, ind_t const v)
+{
+  return 0 != symm && u != v;
+}
 
-  /* skip comment lines */
-  while (0 < IO_getline(&line, &n, istream) && '%' == line[0]);
+/*----------------------------------------------------------------------------*/
+/*! Count the non-zeros per row in a byte range of coordinate lines, as well as
+ *  the lines and comment lines. */
+/*----------------------------------------------------------------------------*/
+static int
+mm_count(char const * cur, char const * const end, int const fmt,
+         int const symm, ind_t const nr, ind_t const nc, ind_t * const cnt,
+         ind_t * const nnnz, uint64_t * const lines, uint64_t * const comments)
+{
+  intmax_t len;
+  ind_t u, v;
+  val_t w;
+  char const * line;
 
-  /* read size line */
-  GC_assert(3 == sscanf(line, PRIind" "PRIind" "PRIind"\n", &nr, &nc, &nnz));
+  while (0 < (len = IO_nextline(&cur, end, &line))) {
+    ++*lines;
+    if ('%' == line[0]) {
+      ++*comments;
+      continue;
+    }
 
-  if (1 == symm) {
-    GC_assert(nr == nc);
-    nnz *= 2;
+    if ((has_adjwgt(fmt) ? 3 : 2) != mm_scan(line, line + len, fmt, &u, &v, &w))
+      return -1;
+    if (0 == u || 0 == v || u > nr || v > nc || (1 == symm && u < v))
+      return -1;
+
+    cnt[u-1]++;
+    ++*nnnz;
+    if (mm_mirror(symm, u, v)) {
+      cnt[v-1]++;
+      ++*nnnz;
+    }
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Convert per-range row counts into row pointers and per-range row offsets.
+ *  Range t's entries for row i follow those of ranges 0..t-1, which preserves
+ *  the file order within each row. */
+/*----------------------------------------------------------------------------*/
+static void
+mm_offsets(int const nparts, ind_t const nr, ind_t * const cnt,
+           ind_t * const ia)
+{
+  #pragma omp parallel for num_threads(nparts) schedule(static)
+  for (ind_t i = 0; i < nr; i++) {
+    ind_t sum = 0;
+    for (int t = 0; t < nparts; t++)
+      sum += cnt[(size_t)t * nr + i];
+    ia[i+1] = sum;
   }
 
-  ind_t * const tmp = GC_calloc(nr + 1, sizeof(*tmp));
+  ia[0] = 0;
+  for (ind_t i = 0; i < nr; i++)
+    ia[i+1] += ia[i];
 
-  while (0 < IO_getline(&line, &n, istream)) {
+  #pragma omp parallel for num_threads(nparts) schedule(static)
+  for (ind_t i = 0; i < nr; i++) {
+    ind_t off = ia[i];
+    for (int t = 0; t < nparts; t++) {
+      ind_t const c = cnt[(size_t)t * nr + i];
+      cnt[(size_t)t * nr + i] = off;
+      off += c;
+    }
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Scatter a byte range of (already validated) coordinate lines. */
+/*----------------------------------------------------------------------------*/
+static void
+mm_fill(char const * cur, char const * const end, int const fmt,
+        int const symm, ind_t * const off, ind_t * const ja, val_t * const a)
+{
+  intmax_t len;
+  ind_t u = 0, v = 0;
+  val_t w = 0;
+  char const * line;
+
+  while (0 < (len = IO_nextline(&cur, end, &line))) {
     if ('%' == line[0])
       continue;
 
+    (void)mm_scan(line, line + len, fmt, &u, &v, &w);
+
     if (has_adjwgt(fmt))
-      GC_assert(3 == sscanf(line, PRIind" "PRIind" "PRIval"\n", &u, &v, &w));
-    else
-      GC_assert(2 == sscanf(line, PRIind" "PRIind"\n", &u, &v));
-
-    GC_assert(0 != u && 0 != v);
-    GC_assert(u <= nr && v <= nc);
-    GC_assert(1 != symm || u >= v);
-
-    tmp[u]++;
-    if (1 == symm)
-      tmp[v]++;
-    nnnz += (ind_t)(1+symm);
+      a[off[u-1]] = w;
+    ja[off[u-1]++] = v-1;
+    if (mm_mirror(symm, u, v)) {
+      if (has_adjwgt(fmt))
+        a[off[v-1]] = w;
+      ja[off[v-1]++] = u-1;
+    }
   }
+}
 
-  GC_assert(nnz == nnnz);
+/*----------------------------------------------------------------------------*/
+/*! Parse a matrix market file from an open input source. */
+/*----------------------------------------------------------------------------*/
+static int
+mm_parse(IO_reader * const reader, Matrix * const M)
+{
+  /* ...garbage collected function... */
+  GC_func_init();
 
-  ind_t * const ia = GC_malloc((nr + 1) * sizeof(*ia));
-  ind_t * const ja = GC_malloc(nnz * sizeof(*ja));
-  val_t *a = NULL;
-  if (has_adjwgt(fmt))
-    a = GC_malloc(nnz * sizeof(*a));
+  int fmt = 0, symm = 0;
+  intmax_t len;
+  ind_t i;
+  ind_t u, v, nr = 0, nc = 0, nent = 0, nnz = 0, nnnz = 0;
+  val_t w;
+  char const * line;
 
-  ia[0] = 0;
-  for (i = 1; i <= nr; i++) {
-    tmp[i] += tmp[i-1];
-    ia[i] = tmp[i];
-  }
+  /* read header and size lines */
+  GC_assert(0 == mm_header(reader, &fmt, &symm, &nr, &nc, &nent));
 
-  rewind(istream);
+  IO_stats_phase(IO_PHASE_PARSE);
 
-  /* read header line */
-  GC_assert(0 < IO_getline(&line, &n, istream));
+  /* ...a general matrix is symmetrized by mirroring its entries... */
+  int const mirror = (0 == symm && 1 == IO_opts.symmetrize) ? 2 : symm;
+  if (0 != mirror)
+    GC_assert(nr == nc);
 
-  /* skip comment lines */
-  while (0 < IO_getline(&line, &n, istream) && '%' == line[0]);
-  /* skip size line */
+  IO_csr csr;
+  ind_t * ia, * ja;
+  val_t * a;
+
+  int const nthreads = (NULL != reader->base) ? IO_nthreads_rows(nr, nent) : 1;
+
+  /* ...input that can only be read once is staged, even for two passes... */
+  if (1 < nthreads) {
+    /* split the remaining lines into one newline-aligned range per thread */
+    char const ** const bounds = GC_malloc((nthreads + 1) * sizeof(*bounds));
+    GC_assert(0 == IO_reader_split(reader, nthreads, bounds));
+
+    /* count the non-zeros per row for each range */
+    ind_t * const cnt = GC_calloc((size_t)nthreads * nr, sizeof(*cnt));
+
+    int err = 0;
+    uint64_t lines = 0, comments = 0;
+    #pragma omp parallel for num_threads(nthreads) schedule(static, 1) \
+      reduction(|:err) reduction(+:nnnz,lines,comments)
+    for (int t = 0; t < nthreads; t++) {
+      ind_t tnnz = 0;
+      uint64_t tlines = 0, tcomments = 0;
+      err |= mm_count(bounds[t], bounds[t+1], fmt, mirror, nr, nc,
+                      cnt + (size_t)t * nr, &tnnz, &tlines, &tcomments);
+      nnnz     += tnnz;
+      lines    += tlines;
+      comments += tcomments;
+    }
+    GC_assert(0 == err);
 
-  while (0 < IO_getline(&line, &n, istream)) {
-    if ('%' == line[0])
-      continue;
+    reader->lines    += lines;
+    reader->comments += comments;
 
-    if (has_adjwgt(fmt))
-      GC_assert(3 == sscanf(line, PRIind" "PRIind" "PRIval"\n", &u, &v, &w));
-    else
-      GC_assert(2 == sscanf(line, PRIind" "PRIind"\n", &u, &v));
+    GC_assert((uint64_t)nent == lines - comments);
+    nnz = nnnz;
+
+    IO_stats_phase(IO_PHASE_BUILD);
+
+    GC_assert(0 == IO_csr_alloc(&csr, nr, nnz, has_adjwgt(fmt), 0, 0));
+    GC_register_free(IO_csr_free, &csr);
+    ia = csr.ia;
+    ja = csr.ja;
+    a  = csr.a;
+
+    mm_offsets(nthreads, nr, cnt, ia);
+    IO_touch_nnz(nr, ia, ja, a);
+
+    /* scatter each range into its reserved slots */
+    #pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+    for (int t = 0; t < nthreads; t++)
+      mm_fill(bounds[t], bounds[t+1], fmt, mirror, cnt + (size_t)t * nr, ja, a);
+
+    GC_free(cnt);
+    GC_free(bounds);
+  } else if (1 == IO_opts.twopass && !reader->forward) {
+    ind_t * const tmp = GC_calloc(nr + 1, sizeof(*tmp));
+    ind_t k = 0;
+
+    while (0 < (len = IO_reader_getline(reader, &line))) {
+      if ('%' == line[0])
+        continue;
 
+      if (has_adjwgt(fmt))
+        GC_assert(3 == mm_scan(line, line + len, fmt, &u, &v, &w));
+      else
+        GC_assert(2 == mm_scan(line, line + len, fmt, &u, &v, &w));
+
+      GC_assert(0 != u && 0 != v);
+      GC_assert(u <= nr && v <= nc);
+      GC_assert(1 != symm || u >= v);
+
+      tmp[u]++;
+      nnnz++;
+      if (mm_mirror(mirror, u, v)) {
+        tmp[v]++;
+        nnnz++;
+      }
+      k++;
+    }
+
+    GC_assert(nent == k);
+    nnz = nnnz;
+
+    IO_stats_phase(IO_PHASE_BUILD);
+
+    GC_assert(0 == IO_csr_alloc(&csr, nr, nnz, has_adjwgt(fmt), 0, 0));
+    GC_register_free(IO_csr_free, &csr);
+    ia = csr.ia;
+    ja = csr.ja;
+    a  = csr.a;
+
+    ia[0] = 0;
+    for (i = 1; i <= nr; i++) {
+      tmp[i] += tmp[i-1];
+      ia[i] = tmp[i];
+    }
+    IO_touch_nnz(nr, ia, ja, a);
+
+    GC_assert(0 == IO_reader_rewind(reader));
+
+    /* read header line */
+    GC_assert(0 < IO_reader_getline(reader, &line));
+
+    /* skip comment lines */
+    while (0 < IO_reader_getline(reader, &line) && '%' == line[0]);
+    /* skip size line */
+
+    while (0 < (len = IO_reader_getline(reader, &line))) {
+      if ('%' == line[0])
+        continue;
+
+      if (has_adjwgt(fmt))
+        GC_assert(3 == mm_scan(line, line + len, fmt, &u, &v, &w));
+      else
+        GC_assert(2 == mm_scan(line, line + len, fmt, &u, &v, &w));
+
+      if (has_adjwgt(fmt))
+        a[tmp[u-1]] = w;
+      ja[tmp[u-1]++] = v-1;
+      if (mm_mirror(mirror, u, v)) {
+        if (has_adjwgt(fmt))
+          a[tmp[v-1]] = w;
+        ja[tmp[v-1]++] = u-1;
+      }
+    }
+
+    GC_free(tmp);
+  } else {
+    /* stage the entries, so that the file is read only once */
+    ind_t * const su = GC_malloc(nent * sizeof(*su));
+    ind_t * const sv = GC_malloc(nent * sizeof(*sv));
+    val_t * sw = NULL;
     if (has_adjwgt(fmt))
-      a[tmp[u-1]] = w;
-    ja[tmp[u-1]++] = v-1;
-    if (1 == symm) {
+      sw = GC_malloc(nent * sizeof(*sw));
+
+    ind_t k = 0;
+    while (0 < (len = IO_reader_getline(reader, &line))) {
+      if ('%' == line[0])
+        continue;
+
       if (has_adjwgt(fmt))
-        a[tmp[v-1]] = w;
-      ja[tmp[v-1]++] = u-1;
+        GC_assert(3 == mm_scan(line, line + len, fmt, &u, &v, &w));
+      else
+        GC_assert(2 == mm_scan(line, line + len, fmt, &u, &v, &w));
+
+      GC_assert(0 != u && 0 != v);
+      GC_assert(u <= nr && v <= nc);
+      GC_assert(1 != symm || u >= v);
+      GC_assert(k < nent);
+
+      su[k] = u-1;
+      sv[k] = v-1;
+      if (has_adjwgt(fmt))
+        sw[k] = w;
+      k++;
+      nnnz += (ind_t)(1 + mm_mirror(mirror, u-1, v-1));
     }
+
+    GC_assert(nent == k);
+    nnz = nnnz;
+
+    IO_stats_phase(IO_PHASE_BUILD);
+
+    GC_assert(0 == IO_csr_alloc(&csr, nr, nnz, has_adjwgt(fmt), 0, 0));
+    GC_register_free(IO_csr_free, &csr);
+    ia = csr.ia;
+    ja = csr.ja;
+    a  = csr.a;
+
+    IO_coo_csr(nr, k, su, sv, sw, mirror, ia, ja, a);
+
+    if (has_adjwgt(fmt))
+      GC_free(sw);
+    GC_free(sv);
+    GC_free(su);
+  }
+
+  /* ...drop self-loops and merge duplicates, if asked to... */
+  GC_assert(0 == IO_clean_rows(nr, ia, ja, a));
+  if (ia[nr] < nnz) {
+    IO_csr_shrink(&csr, ia[nr]);
+    ja = csr.ja;
+    a  = csr.a;
   }
+  nnz = ia[nr];
 
-  while (!feof(istream) && 0 < IO_getline(&line, &n, istream))
-    GC_assert('%' == line[0]);
+  /* ...rows are complete only once every entry is scattered... */
+  if (IO_opts.sort)
+    GC_assert(0 == IO_sort_rows(nr, ia, ja, a));
 
   M->fmt   = fmt;
   /*M->diag  = 0;*/
-  /*M->sort  = NONE;*/
-  M->symm  = symm;
+  M->sort  = IO_opts.sort ? ASC : NONE;
+  M->symm  = (0 != mirror);
   M->nr    = nr;
   M->nc    = nc;
   M->nnz   = nnz;
@@ -156,54 +438,327 @@ IO_mm_load(char const * const filename, Matrix * const M)
   M->ja    = ja;
   M->a     = a;
 
-  GC_free(istream);
-  GC_free(line);
-
   return 0;
 }
 
 /*----------------------------------------------------------------------------*/
-/*! Function to write a matrix market file. */
+/*! Function to read a matrix market file. */
 /*----------------------------------------------------------------------------*/
-EFIKA_EXPORT int
-IO_mm_save(char const * const filename, Matrix const * const M)
+static int
+mm_load(char const * const filename, Matrix * const M)
 {
+  IO_reader reader;
+
   /* validate input */
   if (!pp_all(filename, M))
     return -1;
 
-  /* open output file */
-  FILE * ostream = fopen(filename, "w");
-  if (!ostream)
+  /* open input file */
+  if (0 != IO_reader_open(&reader, filename))
+    return -1;
+
+  int const ret = mm_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a mm file, through the binary cache when enabled. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_mm_load(char const * const filename, Matrix * const M)
+{
+  return IO_cache_load(IO_MM, filename, M, mm_load);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a matrix market file from descriptor fd, such as a pipe or
+ *  socket, which is read from its current position to its end and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_mm_load_fd(int const fd, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_fd(&reader, fd))
+    return -1;
+
+  int const ret = mm_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a matrix market file from stream, which is read from its
+ *  current position to its end and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_mm_load_stream(FILE * const stream, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_stream(&reader, stream))
+    return -1;
+
+  int const ret = mm_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a matrix market file from the len bytes at buf, which are
+ *  parsed in place and left untouched. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_mm_load_mem(char const * const buf, size_t const len, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(buf, M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_mem(&reader, buf, len))
     return -1;
 
+  int const ret = mm_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse the next row of a row-sorted matrix market file into a row block. The
+ *  first entry of the following row is held back in rows. */
+/*----------------------------------------------------------------------------*/
+static int
+mm_row(IO_Rows * const rows, size_t const i)
+{
+  intmax_t len;
+  char const * line;
+
+  /* unpack /rows/ */
+  int   const fmt = rows->fmt;
+  ind_t const r   = rows->r;
+
+  (void)i;
+
+  while (1) {
+    if (!rows->pend) {
+      do {
+        len = IO_reader_getline(&rows->reader, &line);
+      } while (0 < len && '%' == line[0]);
+
+      /* ...rows after the last entry are empty... */
+      if (0 >= len) {
+        if (r < rows->nr)
+          return 0;
+        return (rows->nnnz == rows->hnnz) ? 1 : -1;
+      }
+
+      ind_t u, v;
+      val_t w = 0;
+
+      if ((has_adjwgt(fmt) ? 3 : 2) != mm_scan(line, line + len, fmt, &u, &v,
+                                                &w))
+        return -1;
+      if (0 == u || 0 == v || u > rows->nr || v > rows->nc)
+        return -1;
+
+      /* insist that rows appear in order */
+      if (u - 1 < r || rows->nnnz >= rows->hnnz)
+        return -1;
+
+      rows->pend = 1;
+      rows->pu   = u;
+      rows->pv   = v;
+      rows->pw   = w;
+    }
+
+    if (rows->pu - 1 > r)
+      return 0;
+
+    if (0 != IO_rows_room(rows, 1))
+      return -1;
+
+    if (has_adjwgt(fmt))
+      rows->a[rows->nnz] = rows->pw;
+    rows->ja[rows->nnz++] = rows->pv - 1;
+    rows->nnnz++;
+    rows->pend = 0;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to open a matrix market file for reading in blocks of rows. The
+ *  entries must be sorted by row and the matrix must be general, since the
+ *  mirror of an entry of a symmetric matrix may belong to an earlier block. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_mm_open(char const * const filename, size_t const blksz,
+           IO_Rows ** const rows)
+{
+  int fmt = 0, symm = 0;
+
+  if (0 != IO_rows_init(rows, filename, blksz, mm_row))
+    return -1;
+
+  IO_Rows * const r = *rows;
+
+  /* read header and size lines */
+  if (0 != mm_header(&r->reader, &fmt, &symm, &r->nr, &r->nc, &r->hnnz) ||
+      1 == symm)
+  {
+    IO_rows_close(r);
+    *rows = NULL;
+    return -1;
+  }
+
+  r->fmt  = fmt;
+  r->vals = has_adjwgt(fmt);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Format rows [r0, r1) of a matrix market file. */
+/*----------------------------------------------------------------------------*/
+static void
+mm_rows(IO_writer * const writer, Matrix const * const M, ind_t const r0,
+        ind_t const r1)
+{
   /* unpack /M/ */
   int   const fmt  = M->fmt;
   int   const symm = M->symm;
-  ind_t const nr  = M->nr;
-  ind_t const nnz = M->nnz;
   ind_t const * const ia = M->ia;
   ind_t const * const ja = M->ja;
   val_t const * const a  = M->a;
 
-  fprintf(ostream, "%%%%MatrixMarket matrix coordinate %s %s\n",
-    1 == fmt ? "pattern" : " real", 1 == symm ? "symmetric" : "general");
-
-  fprintf(ostream, PRIind" "PRIind" "PRIind"\n", nr, nr, nnz/(ind_t)(1 + symm));
-
-  for (ind_t i = 0; i < nr; i++) {
+  for (ind_t i = r0; i < r1; i++) {
     for (ind_t j = ia[i]; j < ia[i + 1]; j++) {
-      if ((0 == symm) || (1 == symm && i > ja[j])) {
-        if (has_adjwgt(fmt))
-          fprintf(ostream, PRIind" "PRIind" "PRIval"\n", i + 1, ja[j] + 1, a[j]);
-        else
-          fprintf(ostream, PRIind" "PRIind"\n", i + 1, ja[j] + 1);
+      if ((0 == symm) || (1 == symm && i >= ja[j])) {
+        IO_writer_puti(writer, i + 1);
+        IO_writer_putc(writer, ' ');
+        IO_writer_puti(writer, ja[j] + 1);
+        if (has_adjwgt(fmt)) {
+          IO_writer_putc(writer, ' ');
+          IO_writer_putv(writer, a[j]);
+        }
+        IO_writer_putc(writer, '\n');
       }
     }
   }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a matrix market file to an output sink, closing it. */
+/*----------------------------------------------------------------------------*/
+static int
+mm_write(IO_writer * const writer, Matrix const * const M)
+{
+  IO_stats_phase(IO_PHASE_WRITE);
+
+  /* unpack /M/ */
+  int   const fmt  = M->fmt;
+  int   const symm = M->symm;
+  ind_t const nr  = M->nr;
+  ind_t const nc  = M->nc;
+  ind_t const nnz = M->nnz;
+  ind_t const * const ia = M->ia;
+  ind_t const * const ja = M->ja;
+
+  /* ...only the lower triangle of a symmetric matrix is stored, its diagonal
+   * entries once... */
+  ind_t nent = nnz;
+  if (1 == symm) {
+    ind_t ndiag = 0;
+    for (ind_t i = 0; i < nr; i++)
+      for (ind_t j = ia[i]; j < ia[i + 1]; j++)
+        if (i == ja[j])
+          ndiag++;
+    nent = (nnz + ndiag) / 2;
+  }
+
+  IO_writer_printf(writer, "%%%%MatrixMarket matrix coordinate %s %s\n",
+    has_adjwgt(fmt) ? "real" : "pattern", 1 == symm ? "symmetric" : "general");
+
+  IO_writer_printf(writer, PRIind" "PRIind" "PRIind"\n", nr, nc, nent);
+
+  (void)IO_writer_rows(writer, M, mm_rows);
 
   /* ... */
-  fclose(ostream);
+  return IO_writer_close(writer);
+}
 
-  return 0;
+/*----------------------------------------------------------------------------*/
+/*! Function to write a matrix market file. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_mm_save(char const * const filename, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  /* open output file */
+  if (0 != IO_writer_open(&writer, filename))
+    return -1;
+
+  return mm_write(&writer, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a matrix market file to descriptor fd, such as a pipe or
+ *  socket, which is left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_mm_save_fd(int const fd, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open output sink */
+  if (0 != IO_writer_open_fd(&writer, fd))
+    return -1;
+
+  return mm_write(&writer, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a matrix market file to stream, which is flushed but left
+ *  open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_mm_save_stream(FILE * const stream, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  /* open output sink */
+  if (0 != IO_writer_open_stream(&writer, stream))
+    return -1;
+
+  return mm_write(&writer, M);
 }
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: MIT */
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/core/pp.h"
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Process-wide options. */
+/*----------------------------------------------------------------------------*/
+IO_Options IO_opts = {
+  .nthreads   = 1,
+  .twopass    = 0,
+  .cache      = NULL,
+  .idbase     = 1,
+  .compact    = 0,
+  .sort       = 0,
+  .noloops    = 0,
+  .dedup      = IO_DEDUP_NONE,
+  .symmetrize = 0,
+  .slab       = IO_SLAB_NONE,
+  .nparts     = 0,
+  .part       = NULL,
+  .precision  = 0
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Function to get the process-wide options. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT void
+IO_options_get(IO_Options * const opts)
+{
+  if (!pp_all(opts))
+    return;
+
+  *opts = IO_opts;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to set the process-wide options used by all subsequent loads and
+ *  saves. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT void
+IO_options_set(IO_Options const * const opts)
+{
+  if (!pp_all(opts))
+    return;
+
+  IO_opts = *opts;
+}
@@ -0,0 +1,321 @@
+/* SPDX-License-Identifier: MIT */
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_MMAP
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "efika/io/fd.h"
+#include "efika/io/getline.h"
+#include "efika/io/inflate.h"
+#include "efika/io/reader.h"
+#include "efika/io/stats.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Open an input source. */
+/*----------------------------------------------------------------------------*/
+int
+IO_reader_open(IO_reader * const reader, char const * const filename)
+{
+  memset(reader, 0, sizeof(*reader));
+
+#ifdef HAVE_MMAP
+  int const fd = open(filename, O_RDONLY);
+  if (-1 == fd)
+    return -1;
+
+  struct stat st;
+  if (-1 == fstat(fd, &st)) {
+    (void)close(fd);
+    return -1;
+  }
+
+  /* ...FIFOs and devices opened by name can only be read once... */
+  reader->forward = !S_ISREG(st.st_mode);
+
+#ifdef HAVE_ZLIB
+  /* ...inflate compressed files and anything that cannot be peeked at... */
+  unsigned char magic[2];
+  if (!S_ISREG(st.st_mode) ||
+      (2 == pread(fd, magic, 2, 0) && 0x1f == magic[0] && 0x8b == magic[1]))
+  {
+    if (0 != IO_inflate_open(&reader->gz, fd, filename)) {
+      (void)close(fd);
+      return -1;
+    }
+    return 0;
+  }
+#endif
+
+  if (S_ISREG(st.st_mode)) {
+    if (0 < st.st_size) {
+      void * const base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                               fd, 0);
+      if (MAP_FAILED != base) {
+        (void)posix_madvise(base, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+        reader->base = base;
+        reader->size = (size_t)st.st_size;
+        reader->cur  = base;
+      }
+    }
+
+    if (NULL != reader->base || 0 == st.st_size) {
+      (void)close(fd);
+      return 0;
+    }
+  }
+
+  /* ...not a regular file (or mmap failed), fall back to streaming... */
+  reader->stream = fdopen(fd, "r");
+  if (NULL == reader->stream) {
+    (void)close(fd);
+    return -1;
+  }
+#else
+  reader->stream = fopen(filename, "r");
+  if (NULL == reader->stream)
+    return -1;
+
+# ifdef HAVE_ZLIB
+  unsigned char magic[2];
+  if (2 == fread(magic, 1, 2, reader->stream) && 0x1f == magic[0] &&
+      0x8b == magic[1])
+  {
+    (void)fclose(reader->stream);
+    reader->stream = NULL;
+    return IO_inflate_open(&reader->gz, -1, filename);
+  }
+  rewind(reader->stream);
+# endif
+#endif
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Open an input source on a duplicate of descriptor fd of the caller, such as
+ *  a pipe or socket, from its current position. With zlib, the input is passed
+ *  through the decompression pipeline, so that gzip compressed input is
+ *  inflated. */
+/*----------------------------------------------------------------------------*/
+int
+IO_reader_open_fd(IO_reader * const reader, int const fd)
+{
+  memset(reader, 0, sizeof(*reader));
+
+  reader->forward = 1;
+
+#ifdef HAVE_ZLIB
+  int const dfd = IO_fd_dup(fd);
+  if (-1 == dfd)
+    return -1;
+
+  if (0 != IO_inflate_open(&reader->gz, dfd, NULL)) {
+    (void)IO_fd_close(dfd);
+    return -1;
+  }
+#else
+  reader->stream = IO_fd_open(fd, "r");
+  if (NULL == reader->stream)
+    return -1;
+#endif
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Open an input source on stream, which belongs to the caller and is read
+ *  from its current position, but neither rewound nor closed. */
+/*----------------------------------------------------------------------------*/
+int
+IO_reader_open_stream(IO_reader * const reader, FILE * const stream)
+{
+  memset(reader, 0, sizeof(*reader));
+
+  reader->stream   = stream;
+  reader->borrowed = 1;
+  reader->forward  = 1;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Open an input source on the len bytes at buf, which belong to the caller
+ *  and are walked in place, so must outlive the source. */
+/*----------------------------------------------------------------------------*/
+int
+IO_reader_open_mem(IO_reader * const reader, char const * const buf,
+                   size_t const len)
+{
+  memset(reader, 0, sizeof(*reader));
+
+  reader->base     = buf;
+  reader->size     = len;
+  reader->cur      = buf;
+  reader->borrowed = 1;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Close an input source, adding its counts to the statistics of the calling
+ *  thread. */
+/*----------------------------------------------------------------------------*/
+void
+IO_reader_close(IO_reader * const reader)
+{
+  if (NULL != IO_stats.stats) {
+    IO_stats.stats->bytes    += (NULL != reader->base) ? reader->size
+                                                       : reader->bytes;
+    IO_stats.stats->lines    += reader->lines;
+    IO_stats.stats->comments += reader->comments;
+  }
+
+#ifdef HAVE_MMAP
+  if (NULL != reader->base && !reader->borrowed)
+    (void)munmap((void *)reader->base, reader->size);
+#endif
+  if (NULL != reader->stream && !reader->borrowed)
+    (void)fclose(reader->stream);
+#ifdef HAVE_ZLIB
+  IO_inflate_close(reader->gz);
+#endif
+  free(reader->line);
+
+  memset(reader, 0, sizeof(*reader));
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Reposition an input source to its first byte. */
+/*----------------------------------------------------------------------------*/
+int
+IO_reader_rewind(IO_reader * const reader)
+{
+  if (reader->forward)
+    return -1;
+
+#ifdef HAVE_ZLIB
+  if (NULL != reader->gz)
+    return IO_inflate_rewind(reader->gz);
+#endif
+  if (NULL != reader->stream)
+    return fseek(reader->stream, 0, SEEK_SET);
+
+  reader->cur = reader->base;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Reposition an input source to byte off, which should be the start of a
+ *  line. Compressed sources cannot be repositioned. */
+/*----------------------------------------------------------------------------*/
+int
+IO_reader_seek(IO_reader * const reader, uint64_t const off)
+{
+  if (NULL != reader->gz || reader->forward)
+    return -1;
+
+  if (NULL != reader->stream) {
+    if ((uint64_t)(long)off != off)
+      return -1;
+    return fseek(reader->stream, (long)off, SEEK_SET);
+  }
+
+  if (off > reader->size)
+    return -1;
+
+  reader->cur = reader->base + off;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Byte offset of the next line of an input source that has only been read
+ *  forward from its first byte. */
+/*----------------------------------------------------------------------------*/
+uint64_t
+IO_reader_tell(IO_reader const * const reader)
+{
+  if (NULL != reader->base)
+    return (uint64_t)(reader->cur - reader->base);
+
+  return reader->bytes;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Get the next line from an input source. On success, *lineptr points to the
+ *  first byte of the line, which is not NUL-terminated, and the number of bytes
+ *  in the line, including its newline if present, is returned. At end of input
+ *  -1 is returned, and -2 when the input ends early because it could not be
+ *  decompressed. */
+/*----------------------------------------------------------------------------*/
+intmax_t
+IO_reader_getline(IO_reader * const reader, char const ** const lineptr)
+{
+  intmax_t ret;
+
+#ifdef HAVE_ZLIB
+  if (NULL != reader->gz) {
+    ret = IO_inflate_getline(reader->gz, lineptr);
+  } else
+#endif
+  if (NULL != reader->stream) {
+    ret = IO_getline(&reader->line, &reader->n, reader->stream);
+    *lineptr = reader->line;
+  } else {
+    ret = IO_nextline(&reader->cur, reader->base + reader->size, lineptr);
+  }
+
+  if (0 < ret) {
+    reader->lines++;
+    reader->comments += (reader->comment == (*lineptr)[0]);
+    reader->bytes    += (uint64_t)ret;
+  }
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Split the unread part of a mapped input source into nparts byte ranges of
+ *  roughly equal size, each starting at the beginning of a line. Range i is
+ *  [bounds[i], bounds[i+1]), so bounds must have room for nparts+1 entries.
+ *  Ranges may be empty. Only mapped sources can be split. */
+/*----------------------------------------------------------------------------*/
+int
+IO_reader_split(IO_reader const * const reader, int const nparts,
+                char const ** const bounds)
+{
+  if (NULL == reader->base || 1 > nparts)
+    return -1;
+
+  char const * const beg = reader->cur;
+  char const * const end = reader->base + reader->size;
+  size_t const len = (size_t)(end - beg);
+
+  bounds[0] = beg;
+  for (int i = 1; i < nparts; i++) {
+    char const * p = beg + len / (size_t)nparts * (size_t)i;
+
+    /* ...advance to the start of the next line... */
+    if (p < bounds[i - 1])
+      p = bounds[i - 1];
+    if (p > beg && '\n' != p[-1]) {
+      p = memchr(p, '\n', (size_t)(end - p));
+      p = (NULL == p) ? end : p + 1;
+    }
+
+    bounds[i] = p;
+  }
+  bounds[nparts] = end;
+
+  return 0;
+}
@@ -0,0 +1,220 @@
+/* SPDX-License-Identifier: MIT */
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/core/pp.h"
+#include "efika/io/reader.h"
+#include "efika/io/rename.h"
+#include "efika/io/rows.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Grow an array to hold n elements of size sz. */
+/*----------------------------------------------------------------------------*/
+static int
+rows_grow(void * const ptr, size_t const n, size_t const sz)
+{
+  void * const p = realloc(*(void **)ptr, n * sz);
+  if (NULL == p)
+    return -1;
+
+  *(void **)ptr = p;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Ensure that the block buffers can hold n rows. */
+/*----------------------------------------------------------------------------*/
+static int
+rows_slots(IO_Rows * const rows, size_t const n)
+{
+  if (n <= rows->rcap)
+    return 0;
+
+  size_t rcap = rows->rcap ? rows->rcap : 1024;
+  while (rcap < n)
+    rcap *= 2;
+
+  if (0 != rows_grow(&rows->ia, rcap + 1, sizeof(*rows->ia)))
+    return -1;
+  if (has_vtxsiz(rows->fmt) &&
+      0 != rows_grow(&rows->vsiz, rcap, sizeof(*rows->vsiz)))
+    return -1;
+  if (has_vtxwgt(rows->fmt) &&
+      0 != rows_grow(&rows->vwgt, rcap * rows->ncon, sizeof(*rows->vwgt)))
+    return -1;
+
+  rows->rcap = rcap;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Allocate a row block reader and open its input source. */
+/*----------------------------------------------------------------------------*/
+int
+IO_rows_init(IO_Rows ** const rows, char const * const filename,
+             size_t const blksz, IO_rows_fn const row)
+{
+  if (!pp_all(rows, filename) || 0 == blksz)
+    return -1;
+
+  IO_Rows * const r = calloc(1, sizeof(*r));
+  if (NULL == r)
+    return -1;
+
+  if (0 != IO_reader_open(&r->reader, filename)) {
+    free(r);
+    return -1;
+  }
+
+  r->row   = row;
+  r->blksz = blksz;
+
+  *rows = r;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Ensure that the block buffers can hold n more non-zeros. */
+/*----------------------------------------------------------------------------*/
+int
+IO_rows_room(IO_Rows * const rows, size_t const n)
+{
+  if (rows->nnz + n <= rows->cap && (!rows->vals || NULL != rows->a))
+    return 0;
+
+  size_t cap = rows->cap ? rows->cap : rows->blksz;
+  while (cap < rows->nnz + n)
+    cap *= 2;
+
+  if (0 != rows_grow(&rows->ja, cap, sizeof(*rows->ja)))
+    return -1;
+  if (rows->vals) {
+    int const fresh = (NULL == rows->a);
+
+    if (0 != rows_grow(&rows->a, cap, sizeof(*rows->a)))
+      return -1;
+
+    /* values showing up part way through a block are zero before that */
+    if (fresh)
+      memset(rows->a, 0, rows->nnz * sizeof(*rows->a));
+  }
+
+  rows->cap = cap;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read the next block of rows. The block is stored in B, whose
+ *  arrays belong to rows and are overwritten by the next call, so B must not be
+ *  freed. Its row pointers start at zero and *r0 is set to the index of its
+ *  first row. A block holds whole rows and at most the reader's block size of
+ *  non-zeros plus rows, unless it consists of a single longer row. Returns 0
+ *  for a block, 1 at the end of input, and -1 on error. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_rows_next(IO_Rows * const rows, ind_t * const r0, Matrix * const B)
+{
+  size_t nr = 0;
+
+  /* validate input */
+  if (!pp_all(rows, r0, B))
+    return -1;
+
+  if (0 != rows_slots(rows, 1))
+    return -1;
+
+  rows->ia[0] = 0;
+
+  /* ...start with the row that did not fit in the previous block... */
+  if (rows->carry) {
+    size_t const c   = rows->crow;
+    size_t const beg = rows->ia[c];
+    size_t const n   = rows->nnz - beg;
+
+    memmove(rows->ja, rows->ja + beg, n * sizeof(*rows->ja));
+    if (NULL != rows->a)
+      memmove(rows->a, rows->a + beg, n * sizeof(*rows->a));
+    if (has_vtxsiz(rows->fmt))
+      rows->vsiz[0] = rows->vsiz[c];
+    if (has_vtxwgt(rows->fmt))
+      memmove(rows->vwgt, rows->vwgt + c * rows->ncon,
+              rows->ncon * sizeof(*rows->vwgt));
+
+    rows->ia[1] = (ind_t)n;
+    rows->nnz   = n;
+    rows->carry = 0;
+    nr = 1;
+  } else {
+    rows->nnz = 0;
+  }
+
+  ind_t const first = rows->r - (ind_t)nr;
+
+  while (0 == nr || nr + rows->nnz < rows->blksz) {
+    if (0 != rows_slots(rows, nr + 1))
+      return -1;
+
+    int const ret = rows->row(rows, nr);
+    if (-1 == ret)
+      return -1;
+    if (1 == ret)
+      break;
+
+    rows->r++;
+
+    /* ...a row that overflows a non-empty block starts the next one... */
+    if (0 < nr && rows->blksz < nr + 1 + rows->nnz) {
+      rows->carry = 1;
+      rows->crow  = nr;
+      break;
+    }
+
+    rows->ia[++nr] = (ind_t)rows->nnz;
+  }
+
+  if (0 == nr)
+    return 1;
+
+  B->fmt  = rows->fmt;
+  B->sort = NONE;
+  B->symm = rows->symm;
+  B->nr   = (ind_t)nr;
+  B->nc   = rows->nc;
+  B->nnz  = rows->ia[nr];
+  B->ncon = rows->ncon;
+  B->ia   = rows->ia;
+  B->ja   = rows->ja;
+  B->a    = rows->a;
+  B->vsiz = rows->vsiz;
+  B->vwgt = rows->vwgt;
+
+  *r0 = first;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to close a row block reader and release its buffers. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT void
+IO_rows_close(IO_Rows * const rows)
+{
+  if (NULL == rows)
+    return;
+
+  IO_reader_close(&rows->reader);
+  free(rows->ia);
+  free(rows->ja);
+  free(rows->a);
+  free(rows->vsiz);
+  free(rows->vwgt);
+  free(rows);
+}
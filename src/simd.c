@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: MIT */
+#include <stdint.h>
+
+#include "efika/io/simd.h"
+
+int IO_simd = 0;
+
+#if IO_HAVE_SIMD
+# include <immintrin.h>
+
+/*----------------------------------------------------------------------------*/
+/*! Detect the vectorized kernels supported by the running CPU. This runs once,
+ *  before main and before any thread could load a file, so that IO_simd is
+ *  only ever read afterwards. */
+/*----------------------------------------------------------------------------*/
+__attribute__((constructor)) static void
+simd_init(void)
+{
+  __builtin_cpu_init();
+  IO_simd = (0 != __builtin_cpu_supports("sse4.2"));
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Convert a run of up to 16 decimal digits. The run is located with a byte
+ *  compare and movemask, moved to the top of the register with a shuffle, so
+ *  that it is preceded by zeros, and reduced pairwise (2, 4, 8 and 16 digits)
+ *  with multiply-adds. */
+/*----------------------------------------------------------------------------*/
+__attribute__((target("sse4.2"))) int
+IO_simd_digits16(char const * const p, uint64_t * const x)
+{
+  /* shuffle moving the first n bytes to the top, for n in 0..16, taken from
+   * &shift[n]; 0x80 lanes become zero */
+  static int8_t const shift[32] = {
+    -128, -128, -128, -128, -128, -128, -128, -128,
+    -128, -128, -128, -128, -128, -128, -128, -128,
+       0,    1,    2,    3,    4,    5,    6,    7,
+       8,    9,   10,   11,   12,   13,   14,   15
+  };
+
+  __m128i const in = _mm_loadu_si128((__m128i const *)p);
+  __m128i const d  = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+
+  /* non-digit lanes are those with (unsigned)d > 9 */
+  __m128i const nd = _mm_cmpgt_epi8(_mm_min_epu8(d, _mm_set1_epi8(10)),
+                                    _mm_set1_epi8(9));
+  unsigned const mask = (unsigned)_mm_movemask_epi8(nd);
+  int const n = mask ? __builtin_ctz(mask) : 16;
+
+  if (0 == n) {
+    *x = 0;
+    return 0;
+  }
+
+  __m128i v = _mm_shuffle_epi8(d,
+    _mm_loadu_si128((__m128i const *)(shift + n)));
+
+  v = _mm_maddubs_epi16(v, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1,
+                                         10, 1, 10, 1, 10, 1, 10, 1));
+  v = _mm_madd_epi16(v, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+  v = _mm_packus_epi32(v, v);
+  v = _mm_madd_epi16(v, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+  *x = (uint64_t)(uint32_t)_mm_cvtsi128_si32(v) * 100000000 +
+       (uint32_t)_mm_extract_epi32(v, 1);
+
+  return n;
+}
+#else
+int
+IO_simd_digits16(char const * const p, uint64_t * const x)
+{
+  (void)p;
+  *x = 0;
+  return 0;
+}
+#endif
@@ -0,0 +1,277 @@
+/* SPDX-License-Identifier: MIT */
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/core/pp.h"
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+#include "efika/io/slab.h"
+#include "efika/io/touch.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Round n up to a multiple of align, which is a power of two. */
+/*----------------------------------------------------------------------------*/
+static inline uintptr_t
+slab_round(uintptr_t const n, uintptr_t const align)
+{
+  return (n + align - 1) & ~(align - 1);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Map len bytes, a multiple of IO_SLAB_HUGEPAGE, of anonymous memory aligned
+ *  to IO_SLAB_HUGEPAGE and backed by huge pages: explicit ones when the system
+ *  has some reserved, transparent ones otherwise. Returns NULL when anonymous
+ *  mappings are not available. */
+/*----------------------------------------------------------------------------*/
+static void *
+slab_map(size_t const len)
+{
+#if defined(HAVE_MMAP) && defined(MAP_ANONYMOUS)
+  void * p;
+
+# ifdef MAP_HUGETLB
+  p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (MAP_FAILED != p)
+    return p;
+# endif
+
+  /* ...map an extra huge page and trim the mapping to an aligned run... */
+  size_t const ext = len + IO_SLAB_HUGEPAGE;
+
+  p = mmap(NULL, ext, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+           0);
+  if (MAP_FAILED == p)
+    return NULL;
+
+  uintptr_t const beg = (uintptr_t)p;
+  uintptr_t const pos = slab_round(beg, IO_SLAB_HUGEPAGE);
+
+  if (pos > beg)
+    (void)munmap(p, pos - beg);
+  if (pos + len < beg + ext)
+    (void)munmap((void *)(pos + len), beg + ext - (pos + len));
+
+  p = (void *)pos;
+
+# ifdef MADV_HUGEPAGE
+  (void)madvise(p, len, MADV_HUGEPAGE);
+# endif
+
+  return p;
+#else
+  (void)len;
+  return NULL;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Release the slab whose first array is ia. */
+/*----------------------------------------------------------------------------*/
+static int
+slab_release(void * const ia)
+{
+  IO_slab_header * const hdr =
+    (IO_slab_header *)((char *)ia - IO_SLAB_ALIGN);
+
+  if (0 != memcmp(hdr->magic, IO_SLAB_MAGIC, sizeof(hdr->magic)))
+    return -1;
+
+#ifdef HAVE_MMAP
+  if (0 != hdr->size)
+    return munmap(hdr->base, hdr->size);
+#endif
+  free(hdr->base);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Allocate the arrays of a matrix with nr rows and nnz non-zeros: ia and ja,
+ *  a when adj is set, nvwgt vertex weights per row and vsiz when siz is set.
+ *  Absent arrays are NULL. The arrays are carved from one slab when the slab
+ *  option is set, and allocated separately otherwise. */
+/*----------------------------------------------------------------------------*/
+int
+IO_csr_alloc(IO_csr * const csr, ind_t const nr, ind_t const nnz,
+             int const adj, ind_t const nvwgt, int const siz)
+{
+  size_t len[5];
+
+  len[0] = ((size_t)nr + 1) * sizeof(ind_t);
+  len[1] = (size_t)nnz * sizeof(ind_t);
+  len[2] = adj ? (size_t)nnz * sizeof(val_t) : 0;
+  len[3] = (size_t)nvwgt * nr * sizeof(val_t);
+  len[4] = siz ? (size_t)nr * sizeof(ind_t) : 0;
+
+  int const has[5] = { 1, 1, !!adj, 0 < nvwgt, !!siz };
+  void * arr[5] = { NULL, NULL, NULL, NULL, NULL };
+
+  memset(csr, 0, sizeof(*csr));
+
+  if (IO_SLAB_NONE == IO_opts.slab) {
+    for (int k = 0; k < 5; k++) {
+      if (!has[k])
+        continue;
+      if (NULL == (arr[k] = malloc(len[k] ? len[k] : 1))) {
+        for (int j = 0; j < k; j++)
+          free(arr[j]);
+        return -1;
+      }
+    }
+  } else {
+    size_t off[5], size = IO_SLAB_ALIGN;
+
+    for (int k = 0; k < 5; k++) {
+      off[k] = size;
+      size   = slab_round(size + len[k], IO_SLAB_ALIGN);
+    }
+
+    void * raw = NULL;
+    char * base = NULL;
+    size_t map = 0;
+
+    if (IO_SLAB_HUGE == IO_opts.slab) {
+      map = slab_round(size, IO_SLAB_HUGEPAGE);
+      if (NULL != (raw = slab_map(map)))
+        base = raw;
+      else
+        map = 0;
+    }
+    if (NULL == base) {
+      /* ...no huge pages, so align a plain allocation... */
+      if (NULL == (raw = malloc(size + IO_SLAB_ALIGN)))
+        return -1;
+      base = (char *)slab_round((uintptr_t)raw, IO_SLAB_ALIGN);
+    }
+
+    IO_slab_header * const hdr = (IO_slab_header *)base;
+    memcpy(hdr->magic, IO_SLAB_MAGIC, sizeof(hdr->magic));
+    hdr->base = raw;
+    hdr->size = map;
+
+    for (int k = 0; k < 5; k++)
+      if (has[k])
+        arr[k] = base + off[k];
+
+    csr->slab = 1;
+  }
+
+  csr->ia   = arr[0];
+  csr->ja   = arr[1];
+  csr->a    = arr[2];
+  csr->vwgt = arr[3];
+  csr->vsiz = arr[4];
+
+  /* ...place the row arrays before anything else writes them... */
+  IO_touch_rows(csr, nr, nvwgt);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Release arrays obtained from IO_csr_alloc. */
+/*----------------------------------------------------------------------------*/
+void
+IO_csr_free(IO_csr * const csr)
+{
+  if (csr->slab) {
+    if (NULL != csr->ia)
+      (void)slab_release(csr->ia);
+  } else {
+    free(csr->ia);
+    free(csr->ja);
+    free(csr->a);
+    free(csr->vwgt);
+    free(csr->vsiz);
+  }
+
+  memset(csr, 0, sizeof(*csr));
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Return the memory past the first nnz non-zeros of separately allocated
+ *  arrays to the allocator; slabs are left as they are. */
+/*----------------------------------------------------------------------------*/
+void
+IO_csr_shrink(IO_csr * const csr, ind_t const nnz)
+{
+  if (csr->slab || 0 == nnz)
+    return;
+
+  ind_t * const ja = realloc(csr->ja, nnz * sizeof(*ja));
+  if (NULL != ja)
+    csr->ja = ja;
+
+  if (NULL != csr->a) {
+    val_t * const a = realloc(csr->a, nnz * sizeof(*a));
+    if (NULL != a)
+      csr->a = a;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Move separately allocated arrays, of a matrix with nr rows, nnz non-zeros
+ *  and nvwgt vertex weights per row, into one slab when the slab option is
+ *  set, for loaders that cannot size their arrays up front. The arrays are
+ *  left as they are on failure. */
+/*----------------------------------------------------------------------------*/
+int
+IO_slab_pack(IO_csr * const csr, ind_t const nr, ind_t const nnz,
+             ind_t const nvwgt)
+{
+  IO_csr slab;
+
+  if (IO_SLAB_NONE == IO_opts.slab || csr->slab)
+    return 0;
+
+  if (0 != IO_csr_alloc(&slab, nr, nnz, NULL != csr->a, nvwgt,
+                        NULL != csr->vsiz))
+    return -1;
+
+  memcpy(slab.ia, csr->ia, ((size_t)nr + 1) * sizeof(*slab.ia));
+  IO_touch_nnz(nr, slab.ia, slab.ja, slab.a);
+  memcpy(slab.ja, csr->ja, (size_t)nnz * sizeof(*slab.ja));
+  if (NULL != slab.a)
+    memcpy(slab.a, csr->a, (size_t)nnz * sizeof(*slab.a));
+  if (NULL != slab.vwgt)
+    memcpy(slab.vwgt, csr->vwgt, (size_t)nvwgt * nr * sizeof(*slab.vwgt));
+  if (NULL != slab.vsiz)
+    memcpy(slab.vsiz, csr->vsiz, (size_t)nr * sizeof(*slab.vsiz));
+
+  IO_csr_free(csr);
+  *csr = slab;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to release a matrix loaded while the slab option was set. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_slab_free(Matrix * const M)
+{
+  /* validate input */
+  if (!pp_all(M, M->ia))
+    return -1;
+
+  if (0 != slab_release(M->ia))
+    return -1;
+
+  M->ia   = NULL;
+  M->ja   = NULL;
+  M->a    = NULL;
+  M->vwgt = NULL;
+  M->vsiz = NULL;
+
+  return 0;
+}
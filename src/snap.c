@@ -1,4 +1,5 @@
 /* SPDX-License-Identifier: MIT */
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,117 +9,354 @@
 
 #include "efika/core/gc.h"
 #include "efika/core/pp.h"
-#include "efika/io/getline.h"
+#include "efika/io/cache.h"
+#include "efika/io/clean.h"
+#include "efika/io/coo.h"
+#include "efika/io/options.h"
+#include "efika/io/reader.h"
 #include "efika/io/rename.h"
+#include "efika/io/rows.h"
+#include "efika/io/scan.h"
+#include "efika/io/slab.h"
+#include "efika/io/sort.h"
+#include "efika/io/stats.h"
+#include "efika/io/touch.h"
+#include "efika/io/writer.h"
 
 #define INIT_TMPSIZE 1024
+#define INIT_IDSIZE  1024
 
 /*----------------------------------------------------------------------------*/
-/*! Shim to allow fclose to be registered. */
+/*! Vertex numbering of a snap file. Ids are either offset by a fixed base, or
+ *  compacted to 0..n-1 in order of first appearance through an open-addressing
+ *  (linear probing) hash table, which is kept at most half full. */
 /*----------------------------------------------------------------------------*/
-static inline void
-vfclose(FILE * file)
+typedef struct snap_ids {
+  int         compact; /*!< compact the ids */
+  uintmax_t   base;    /*!< first id, when not compacting */
+  size_t      mask;    /*!< table size - 1, a power of two minus one */
+  uintmax_t * key;     /*!< table keys */
+  ind_t *     val;     /*!< table values, vertex + 1, 0 for empty slots */
+  uintmax_t * ids;     /*!< id of each vertex */
+  ind_t       n;       /*!< number of vertices */
+} snap_ids;
+
+/*----------------------------------------------------------------------------*/
+/*! Table slot of an id. */
+/*----------------------------------------------------------------------------*/
+static inline size_t
+snap_hash(uintmax_t const x, size_t const mask)
 {
-  (void)fclose(file);
+  uint64_t const h = (uint64_t)x * UINT64_C(0x9e3779b97f4a7c15);
+  return (size_t)(h ^ (h >> 29)) & mask;
 }
 
 /*----------------------------------------------------------------------------*/
-/*! Function to read a snap file. */
+/*! Release a vertex numbering. */
 /*----------------------------------------------------------------------------*/
-EFIKA_EXPORT int
-IO_snap_load(char const * const filename, Matrix * const M)
+static void
+snap_ids_free(snap_ids * const ids)
 {
-  /* ...garbage collected function... */
-  GC_func_init();
-
-  size_t n = 0;
-  ind_t tmpsz = INIT_TMPSIZE;
-  ind_t nr = 0, nnz = 0;
-  char *line = NULL;
+  free(ids->key);
+  free(ids->val);
+  free(ids->ids);
+  memset(ids, 0, sizeof(*ids));
+}
 
-  /* validate input */
-  if (!pp_all(filename, M))
+/*----------------------------------------------------------------------------*/
+/*! Double the table of a vertex numbering, or create it. */
+/*----------------------------------------------------------------------------*/
+static int
+snap_ids_grow(snap_ids * const ids)
+{
+  size_t const size = (NULL == ids->key) ? INIT_IDSIZE : 2 * (ids->mask + 1);
+
+  uintmax_t * const key = malloc(size * sizeof(*key));
+  ind_t * const val = calloc(size, sizeof(*val));
+  uintmax_t * const map = realloc(ids->ids, size / 2 * sizeof(*map));
+  if (NULL != map)
+    ids->ids = map;
+  if (NULL == key || NULL == val || NULL == map) {
+    free(key);
+    free(val);
     return -1;
+  }
 
-  /* register line with the garbage collector */
-  GC_register(&line);
+  free(ids->key);
+  free(ids->val);
+  ids->key  = key;
+  ids->val  = val;
+  ids->mask = size - 1;
+
+  /* re-insert the known ids */
+  for (ind_t k = 0; k < ids->n; k++) {
+    size_t h = snap_hash(map[k], ids->mask);
+    while (val[h])
+      h = (h + 1) & ids->mask;
+    key[h] = map[k];
+    val[h] = k + 1;
+  }
 
-  /* open input file */
-  FILE * istream = fopen(filename, "r");
-  GC_assert(istream);
-  GC_register_free(vfclose, istream);
+  return 0;
+}
 
-  ind_t *tmp = GC_calloc((tmpsz + 1), sizeof(*tmp));
+/*----------------------------------------------------------------------------*/
+/*! Map an id to its vertex, numbering ids as they first appear when
+ *  compacting. */
+/*----------------------------------------------------------------------------*/
+static inline int
+snap_ids_get(snap_ids * const ids, uintmax_t const x, ind_t * const v)
+{
+  if (!ids->compact) {
+    /* insist that the vertex is representable */
+    if (x < ids->base || (uintmax_t)(ind_t)(x - ids->base) != x - ids->base)
+      return -1;
+    *v = (ind_t)(x - ids->base);
+    return 0;
+  }
 
-  while (0 < IO_getline(&line, &n, istream)) {
-    if ('#' == line[0])
-      continue;
+  if ((size_t)ids->n == (ids->mask + 1) / 2 && 0 != snap_ids_grow(ids))
+    return -1;
+
+  size_t h = snap_hash(x, ids->mask);
+  for (; ids->val[h]; h = (h + 1) & ids->mask) {
+    if (ids->key[h] == x) {
+      *v = ids->val[h] - 1;
+      return 0;
+    }
+  }
+
+  ids->key[h] = x;
+  ids->ids[ids->n] = x;
+  ids->val[h] = ++ids->n;
+  *v = ids->n - 1;
 
-    ind_t u, v;
-    val_t w;
+  return 0;
+}
 
-    GC_assert(2 <= sscanf(line, PRIind" "PRIind" "PRIval"\n", &u, &v, &w));
-    GC_assert(0 != u || 0 != v);
+/*----------------------------------------------------------------------------*/
+/*! Parse an edge line, returning the number of fields converted. */
+/*----------------------------------------------------------------------------*/
+static inline int
+snap_scan(char const * const line, char const * const eol, uintmax_t * const u,
+          uintmax_t * const v, val_t * const w)
+{
+  char const * p, * q;
+
+  *u = IO_strtou(line, eol, &q);
+  if (q == line)
+    return 0;
+  *v = IO_strtou(p = q, eol, &q);
+  if (q == p)
+    return 1;
+  *w = IO_strtov(p = q, eol, &q);
+  if (q == p)
+    return 2;
+  return 3;
+}
 
-    if (u > nr)
-      nr = u;
-    if (v > nr)
-      nr = v;
+/*----------------------------------------------------------------------------*/
+/*! Parse a snap file from an open input source, compacting its vertex ids if
+ *  asked to, in which case the id of each vertex is stored in a new array *map
+ *  (when map is not NULL). */
+/*----------------------------------------------------------------------------*/
+static int
+snap_parse(IO_reader * const reader, Matrix * const M, int const compact,
+           uintmax_t ** const map)
+{
+  /* ...garbage collected function... */
+  GC_func_init();
 
-    ind_t const otmpsz = tmpsz;
-    while (nr > tmpsz)
-      tmpsz *= 2;
-    if (tmpsz > otmpsz) {
-      tmp = GC_realloc(tmp, (tmpsz + 1) * sizeof(*tmp));
-      memset(tmp+otmpsz, 0, (tmpsz + 1 - otmpsz) * sizeof(*tmp));
+  intmax_t len;
+  ind_t nr = 0, nnz = 0;
+  char const * line;
+  snap_ids ids;
+
+  reader->comment = '#';
+
+  memset(&ids, 0, sizeof(ids));
+  ids.compact = compact;
+  ids.base    = (uintmax_t)IO_opts.idbase;
+  GC_register_free(snap_ids_free, &ids);
+
+  IO_stats_phase(IO_PHASE_PARSE);
+
+  /* ...a directed edge (u,v) also produces (v,u) when symmetrizing... */
+  int const mirror = IO_opts.symmetrize ? 2 : 0;
+
+  IO_csr csr;
+  ind_t * ia, * ja;
+  val_t * a;
+
+  /* ...input that can only be read once is staged instead... */
+  if (1 == IO_opts.twopass && !reader->forward) {
+    int wgt = 0;
+    ind_t tmpsz = INIT_TMPSIZE;
+    ind_t *tmp = GC_calloc((tmpsz + 1), sizeof(*tmp));
+
+    while (0 < (len = IO_reader_getline(reader, &line))) {
+      if ('#' == line[0])
+        continue;
+
+      uintmax_t x, y;
+      ind_t u, v;
+      val_t w;
+
+      int const k = snap_scan(line, line + len, &x, &y, &w);
+      GC_assert(2 <= k);
+      GC_assert(0 == snap_ids_get(&ids, x, &u));
+      GC_assert(0 == snap_ids_get(&ids, y, &v));
+
+      if (u >= nr)
+        nr = u + 1;
+      if (v >= nr)
+        nr = v + 1;
+      wgt |= (3 == k);
+
+      ind_t const otmpsz = tmpsz;
+      while (nr > tmpsz)
+        tmpsz *= 2;
+      if (tmpsz > otmpsz) {
+        tmp = GC_realloc(tmp, (tmpsz + 1) * sizeof(*tmp));
+        memset(tmp+otmpsz, 0, (tmpsz + 1 - otmpsz) * sizeof(*tmp));
+      }
+
+      tmp[u + 1]++;
+      nnz++;
+      if (mirror && u != v) {
+        tmp[v + 1]++;
+        nnz++;
+      }
     }
+    GC_assert(-1 == len);
 
-    tmp[u]++;
-    nnz++;
-  }
+    IO_stats_phase(IO_PHASE_BUILD);
 
-  ind_t * const ia = GC_malloc((nr + 1) * sizeof(ind_t));
-  ind_t * const ja = GC_malloc(nnz * sizeof(ind_t));
-  val_t *a = NULL;
+    GC_assert(0 == IO_csr_alloc(&csr, nr, nnz, wgt, 0, 0));
+    GC_register_free(IO_csr_free, &csr);
+    ia = csr.ia;
+    ja = csr.ja;
+    a  = csr.a;
 
-  ia[0] = 0;
-  for (ind_t i = 1; i <= nr; i++) {
-    tmp[i] += tmp[i-1];
-    ia[i] = tmp[i];
-  }
+    ia[0] = 0;
+    for (ind_t i = 1; i <= nr; i++) {
+      tmp[i] += tmp[i-1];
+      ia[i] = tmp[i];
+    }
+    IO_touch_nnz(nr, ia, ja, a);
 
-  rewind(istream);
+    GC_assert(0 == IO_reader_rewind(reader));
 
-  while (0 < IO_getline(&line, &n, istream)) {
-    if ('#' == line[0])
-      continue;
+    while (0 < (len = IO_reader_getline(reader, &line))) {
+      if ('#' == line[0])
+        continue;
 
-    ind_t u, v;
-    val_t w;
+      uintmax_t x, y;
+      ind_t u, v;
+      val_t w;
 
-    switch (sscanf(line, PRIind" "PRIind" "PRIval"\n", &u, &v, &w)) {
-      case 3:
-      if (NULL == a)
-        a = GC_malloc(nnz * sizeof(*a));
-      a[tmp[u-1]] = w;
-      /* fall through */
+      int const k = snap_scan(line, line + len, &x, &y, &w);
+      GC_assert(2 <= k);
+      GC_assert(0 == snap_ids_get(&ids, x, &u));
+      GC_assert(0 == snap_ids_get(&ids, y, &v));
 
-      case 2:
-      ja[tmp[u - 1]++] = v - 1;
-      break;
+      if (NULL != a)
+        a[tmp[u]] = (3 == k) ? w : 0;
+      ja[tmp[u]++] = v;
+      if (mirror && u != v) {
+        if (NULL != a)
+          a[tmp[v]] = (3 == k) ? w : 0;
+        ja[tmp[v]++] = u;
+      }
+    }
 
-      default:
-      GC_return -1;
+    GC_free(tmp);
+  } else {
+    /* stage the edges, so that the file is read only once */
+    ind_t cap = INIT_TMPSIZE, n = 0;
+    ind_t * su = GC_malloc(cap * sizeof(*su));
+    ind_t * sv = GC_malloc(cap * sizeof(*sv));
+    val_t * sw = NULL;
+
+    while (0 < (len = IO_reader_getline(reader, &line))) {
+      if ('#' == line[0])
+        continue;
+
+      uintmax_t x, y;
+      ind_t u, v;
+      val_t w;
+
+      int const k = snap_scan(line, line + len, &x, &y, &w);
+      GC_assert(2 <= k);
+      GC_assert(0 == snap_ids_get(&ids, x, &u));
+      GC_assert(0 == snap_ids_get(&ids, y, &v));
+
+      if (u >= nr)
+        nr = u + 1;
+      if (v >= nr)
+        nr = v + 1;
+
+      if (n == cap) {
+        cap *= 2;
+        su = GC_realloc(su, cap * sizeof(*su));
+        sv = GC_realloc(sv, cap * sizeof(*sv));
+        if (NULL != sw)
+          sw = GC_realloc(sw, cap * sizeof(*sw));
+      }
+      if (3 == k && NULL == sw)
+        sw = GC_calloc(cap, sizeof(*sw));
+
+      su[n] = u;
+      sv[n] = v;
+      if (NULL != sw)
+        sw[n] = (3 == k) ? w : 0;
+      n++;
+      nnz += (ind_t)(1 + (mirror && u != v));
     }
+    GC_assert(-1 == len);
+
+    IO_stats_phase(IO_PHASE_BUILD);
+
+    GC_assert(0 == IO_csr_alloc(&csr, nr, nnz, NULL != sw, 0, 0));
+    GC_register_free(IO_csr_free, &csr);
+    ia = csr.ia;
+    ja = csr.ja;
+    a  = csr.a;
+
+    IO_coo_csr(nr, n, su, sv, sw, mirror, ia, ja, a);
+
+    if (NULL != sw)
+      GC_free(sw);
+    GC_free(sv);
+    GC_free(su);
   }
 
-  while (!feof(istream) && 0 < IO_getline(&line, &n, istream))
-    GC_assert('#' == line[0]);
+  /* ...drop self-loops and merge duplicates, if asked to... */
+  GC_assert(0 == IO_clean_rows(nr, ia, ja, a));
+  if (ia[nr] < nnz) {
+    IO_csr_shrink(&csr, ia[nr]);
+    ja = csr.ja;
+    a  = csr.a;
+  }
+  nnz = ia[nr];
+
+  /* ...rows are complete only once every entry is scattered... */
+  if (IO_opts.sort)
+    GC_assert(0 == IO_sort_rows(nr, ia, ja, a));
+
+  /* ...hand the id of each vertex over to the caller... */
+  if (NULL != map) {
+    uintmax_t * const m = malloc((nr ? nr : 1) * sizeof(*m));
+    GC_assert(m);
+    if (nr)
+      memcpy(m, ids.ids, nr * sizeof(*m));
+    *map = m;
+  }
 
   /*M->fmt   = 0;*/
   /*M->diag  = 0;*/
-  /*M->sort  = NONE;*/
-  /*M->symm  = 0;*/
+  M->sort  = IO_opts.sort ? ASC : NONE;
+  M->symm  = mirror ? 1 : 0;
   M->nr    = nr;
   M->nc    = nr;
   M->nnz   = nnz;
@@ -127,44 +365,330 @@ IO_snap_load(char const * const filename, Matrix * const M)
   M->ja    = ja;
   M->a     = a;
 
-  GC_free(istream);
-  GC_free(line);
+  GC_free(&ids);
 
   return 0;
 }
 
 /*----------------------------------------------------------------------------*/
-/*! Function to write a snap file. */
+/*! Read a snap file, compacting its vertex ids if asked to. */
 /*----------------------------------------------------------------------------*/
-EFIKA_EXPORT int
-IO_snap_save(char const * const filename, Matrix const * const M)
+static int
+snap_read(char const * const filename, Matrix * const M, int const compact,
+          uintmax_t ** const map)
 {
+  IO_reader reader;
+
   /* validate input */
   if (!pp_all(filename, M))
     return -1;
 
-  /* open output file */
-  FILE * ostream = fopen(filename, "w");
-  if (!ostream)
+  /* open input file */
+  if (0 != IO_reader_open(&reader, filename))
+    return -1;
+
+  int const ret = snap_parse(&reader, M, compact, map);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a snap file. */
+/*----------------------------------------------------------------------------*/
+static int
+snap_load(char const * const filename, Matrix * const M)
+{
+  return snap_read(filename, M, IO_opts.compact, NULL);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a snap file, through the binary cache when enabled. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_snap_load(char const * const filename, Matrix * const M)
+{
+  return IO_cache_load(IO_SNAP, filename, M, snap_load);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a snap file from descriptor fd, such as a pipe or socket,
+ *  which is read from its current position to its end and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_snap_load_fd(int const fd, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_fd(&reader, fd))
+    return -1;
+
+  int const ret = snap_parse(&reader, M, IO_opts.compact, NULL);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a snap file from stream, which is read from its current
+ *  position to its end and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_snap_load_stream(FILE * const stream, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_stream(&reader, stream))
     return -1;
 
+  int const ret = snap_parse(&reader, M, IO_opts.compact, NULL);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a snap file from the len bytes at buf, which are parsed in
+ *  place and left untouched. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_snap_load_mem(char const * const buf, size_t const len, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(buf, M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_mem(&reader, buf, len))
+    return -1;
+
+  int const ret = snap_parse(&reader, M, IO_opts.compact, NULL);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a snap file, compacting its vertex ids to 0..n-1 in order
+ *  of first appearance, and return the id of each vertex in a new array *map,
+ *  which must be released with free. The binary cache is not used. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_snap_load_map(char const * const filename, Matrix * const M,
+                 uintmax_t ** const map)
+{
+  /* validate input */
+  if (!pp_all(map))
+    return -1;
+
+  return snap_read(filename, M, 1, map);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Parse the next row of a row-sorted snap file into a row block. The first
+ *  edge of the following row is held back in rows. Since the number of
+ *  vertices is only known at the end of the input, it is taken to be the
+ *  largest vertex seen so far. Ids are offset by the id base, never
+ *  compacted. */
+/*----------------------------------------------------------------------------*/
+static int
+snap_row(IO_Rows * const rows, size_t const i)
+{
+  intmax_t len;
+  char const * line;
+
+  /* unpack /rows/ */
+  ind_t const r = rows->r;
+
+  uintmax_t const base = (uintmax_t)IO_opts.idbase;
+
+  (void)i;
+
+  while (1) {
+    if (!rows->pend) {
+      do {
+        len = IO_reader_getline(&rows->reader, &line);
+      } while (0 < len && '#' == line[0]);
+
+      /* ...vertices after the last edge have empty rows... */
+      if (-1 > len)
+        return -1;
+      if (0 >= len)
+        return (r < rows->nr) ? 0 : 1;
+
+      uintmax_t x, y;
+      val_t w = 0;
+
+      /* ...vertices are numbered from one here... */
+      int const k = snap_scan(line, line + len, &x, &y, &w);
+      if (2 > k || x < base || y < base)
+        return -1;
+
+      ind_t const u = (ind_t)(x - base + 1);
+      ind_t const v = (ind_t)(y - base + 1);
+      if ((uintmax_t)u != x - base + 1 || (uintmax_t)v != y - base + 1)
+        return -1;
+
+      /* insist that rows appear in order */
+      if (u - 1 < r)
+        return -1;
+
+      if (u > rows->nr)
+        rows->nr = u;
+      if (v > rows->nr)
+        rows->nr = v;
+      rows->nc = rows->nr;
+
+      /* ...values start with the first weighted edge... */
+      if (3 == k)
+        rows->vals = 1;
+      else
+        w = 0;
+
+      rows->pend = 1;
+      rows->pu   = u;
+      rows->pv   = v;
+      rows->pw   = w;
+    }
+
+    if (rows->pu - 1 > r)
+      return 0;
+
+    if (0 != IO_rows_room(rows, 1))
+      return -1;
+
+    if (rows->vals)
+      rows->a[rows->nnz] = rows->pw;
+    rows->ja[rows->nnz++] = rows->pv - 1;
+    rows->nnnz++;
+    rows->pend = 0;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to open a snap file for reading in blocks of rows. The edges must
+ *  be sorted by source vertex. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_snap_open(char const * const filename, size_t const blksz,
+             IO_Rows ** const rows)
+{
+  if (0 != IO_rows_init(rows, filename, blksz, snap_row))
+    return -1;
+
+  (*rows)->reader.comment = '#';
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Format rows [r0, r1) of a snap file. */
+/*----------------------------------------------------------------------------*/
+static void
+snap_rows(IO_writer * const writer, Matrix const * const M, ind_t const r0,
+          ind_t const r1)
+{
   /* unpack /M/ */
-  ind_t const nr = M->nr;
   ind_t const * const ia = M->ia;
   ind_t const * const ja = M->ja;
   val_t const * const a  = M->a;
 
-  for (ind_t i = 0; i < nr; i++) {
+  ind_t const base = (ind_t)IO_opts.idbase;
+
+  for (ind_t i = r0; i < r1; i++) {
     for (ind_t j = ia[i]; j < ia[i + 1]; j++) {
-      fprintf(ostream, PRIind" "PRIind, i + 1, ja[j] + 1);
-      if (NULL != a)
-        fprintf(ostream, " "PRIval, a[j]);
-      fprintf(ostream, "\n");
+      IO_writer_puti(writer, i + base);
+      IO_writer_putc(writer, ' ');
+      IO_writer_puti(writer, ja[j] + base);
+      if (NULL != a) {
+        IO_writer_putc(writer, ' ');
+        IO_writer_putv(writer, a[j]);
+      }
+      IO_writer_putc(writer, '\n');
     }
   }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a snap file to an output sink, closing it. */
+/*----------------------------------------------------------------------------*/
+static int
+snap_write(IO_writer * const writer, Matrix const * const M)
+{
+  IO_stats_phase(IO_PHASE_WRITE);
+
+  (void)IO_writer_rows(writer, M, snap_rows);
 
   /* ... */
-  fclose(ostream);
+  return IO_writer_close(writer);
+}
 
-  return 0;
+/*----------------------------------------------------------------------------*/
+/*! Function to write a snap file. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_snap_save(char const * const filename, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  /* open output file */
+  if (0 != IO_writer_open(&writer, filename))
+    return -1;
+
+  return snap_write(&writer, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a snap file to descriptor fd, such as a pipe or socket,
+ *  which is left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_snap_save_fd(int const fd, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open output sink */
+  if (0 != IO_writer_open_fd(&writer, fd))
+    return -1;
+
+  return snap_write(&writer, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a snap file to stream, which is flushed but left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_snap_save_stream(FILE * const stream, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
+
+  /* open output sink */
+  if (0 != IO_writer_open_stream(&writer, stream))
+    return -1;
+
+  return snap_write(&writer, M);
 }
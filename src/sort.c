@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: MIT */
+#include <stdlib.h>
+#include <string.h>
+
+#include "efika/core.h"
+
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+#include "efika/io/sort.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Sort a short row by insertion, moving its values alongside. */
+/*----------------------------------------------------------------------------*/
+static void
+sort_insertion(ind_t const n, ind_t * const ja, val_t * const a)
+{
+  for (ind_t j = 1; j < n; j++) {
+    ind_t const key = ja[j];
+    val_t const val = (NULL != a) ? a[j] : 0;
+
+    ind_t k = j;
+    for (; k > 0 && ja[k-1] > key; k--) {
+      ja[k] = ja[k-1];
+      if (NULL != a)
+        a[k] = a[k-1];
+    }
+    ja[k] = key;
+    if (NULL != a)
+      a[k] = val;
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Sort a long row with a least-significant-digit radix sort on bytes, moving
+ *  its values alongside. Only the bytes in which the indices of the row differ
+ *  are sorted on. */
+/*----------------------------------------------------------------------------*/
+static int
+sort_radix(ind_t const n, ind_t * const ja, val_t * const a,
+           IO_sort * const buf)
+{
+  if (buf->cap < (size_t)n) {
+    ind_t * const tja = realloc(buf->ja, n * sizeof(*tja));
+    if (NULL == tja)
+      return -1;
+    buf->ja = tja;
+
+    val_t * const ta = realloc(buf->a, n * sizeof(*ta));
+    if (NULL == ta)
+      return -1;
+    buf->a = ta;
+
+    buf->cap = n;
+  }
+
+  ind_t diff = 0;
+  for (ind_t j = 1; j < n; j++)
+    diff |= ja[j] ^ ja[0];
+
+  ind_t * sja = ja, * dja = buf->ja;
+  val_t * sa  = a,  * da  = (NULL != a) ? buf->a : NULL;
+
+  for (unsigned shift = 0; shift < 8 * sizeof(ind_t); shift += 8) {
+    if (0 == ((diff >> shift) & 0xff))
+      continue;
+
+    size_t cnt[256] = { 0 };
+
+    for (ind_t j = 0; j < n; j++)
+      cnt[(sja[j] >> shift) & 0xff]++;
+
+    for (size_t d = 0, sum = 0; d < 256; d++) {
+      size_t const c = cnt[d];
+      cnt[d] = sum;
+      sum += c;
+    }
+
+    for (ind_t j = 0; j < n; j++) {
+      size_t const k = cnt[(sja[j] >> shift) & 0xff]++;
+      dja[k] = sja[j];
+      if (NULL != a)
+        da[k] = sa[j];
+    }
+
+    ind_t * const tja = sja;
+    sja = dja;
+    dja = tja;
+
+    val_t * const ta = sa;
+    sa = da;
+    da = ta;
+  }
+
+  /* ...after an odd number of passes the row is in the scratch space... */
+  if (sja != ja) {
+    memcpy(ja, sja, n * sizeof(*ja));
+    if (NULL != a)
+      memcpy(a, sa, n * sizeof(*a));
+  }
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Sort the n column indices of a row in ascending order, permuting its values
+ *  (when a is not NULL) alongside. Rows that are already sorted are left
+ *  alone. */
+/*----------------------------------------------------------------------------*/
+int
+IO_sort_row(ind_t const n, ind_t * const ja, val_t * const a,
+            IO_sort * const buf)
+{
+  ind_t j = 1;
+  while (j < n && ja[j-1] <= ja[j])
+    j++;
+  if (j >= n)
+    return 0;
+
+  if (n <= IO_SORT_SHORT) {
+    sort_insertion(n, ja, a);
+    return 0;
+  }
+
+  return sort_radix(n, ja, a, buf);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Sort every row of a CSR matrix, in parallel. */
+/*----------------------------------------------------------------------------*/
+int
+IO_sort_rows(ind_t const nr, ind_t const * const ia, ind_t * const ja,
+             val_t * const a)
+{
+  int err = 0;
+
+  #pragma omp parallel num_threads(IO_nthreads()) reduction(|:err)
+  {
+    IO_sort buf = { NULL, NULL, 0 };
+
+    #pragma omp for schedule(dynamic, 256)
+    for (ind_t i = 0; i < nr; i++)
+      err |= IO_sort_row(ia[i+1] - ia[i], ja + ia[i],
+                         (NULL != a) ? a + ia[i] : NULL, &buf);
+
+    IO_sort_free(&buf);
+  }
+
+  return err ? -1 : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Release the scratch space of the radix sort. */
+/*----------------------------------------------------------------------------*/
+void
+IO_sort_free(IO_sort * const buf)
+{
+  free(buf->ja);
+  free(buf->a);
+  memset(buf, 0, sizeof(*buf));
+}
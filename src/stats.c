@@ -0,0 +1,154 @@
+/* SPDX-License-Identifier: MIT */
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/core/pp.h"
+#include "efika/io/rename.h"
+#include "efika/io/stats.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Statistics being gathered by the calling thread. */
+/*----------------------------------------------------------------------------*/
+IO_THREAD_LOCAL IO_stats_ctx IO_stats;
+
+/*----------------------------------------------------------------------------*/
+/*! Seconds on a monotonic clock. */
+/*----------------------------------------------------------------------------*/
+double
+IO_stats_now(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+  struct timespec ts;
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#else
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Start gathering statistics for the calling thread. */
+/*----------------------------------------------------------------------------*/
+static double
+stats_begin(IO_Stats * const stats)
+{
+  if (NULL == stats)
+    return 0;
+
+  memset(stats, 0, sizeof(*stats));
+
+  IO_stats.stats = stats;
+  IO_stats.phase = IO_PHASE_OPEN;
+  IO_stats.t0    = IO_stats_now();
+
+  return IO_stats.t0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Stop gathering statistics for the calling thread and record the size of M,
+ *  when given. */
+/*----------------------------------------------------------------------------*/
+static void
+stats_end(IO_Stats * const stats, double const t0, Matrix const * const M)
+{
+  if (NULL == stats)
+    return;
+
+  IO_stats_phase(IO_stats.phase);
+
+  stats->total = IO_stats.t0 - t0;
+
+  memset(&IO_stats, 0, sizeof(IO_stats));
+
+  if (NULL == M)
+    return;
+
+  /* ...counted in 64 bits, as nr * ncon may not fit an ind_t... */
+  uint64_t const nr  = M->nr;
+  uint64_t const nnz = M->nnz;
+
+  stats->nnz  = nnz;
+  stats->size = (nr + 1) * sizeof(*M->ia) + nnz * sizeof(*M->ja);
+  if (NULL != M->a)
+    stats->size += nnz * sizeof(*M->a);
+  if (NULL != M->vwgt)
+    stats->size += nr * M->ncon * sizeof(*M->vwgt);
+  if (NULL != M->vsiz)
+    stats->size += nr * sizeof(*M->vsiz);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a file in the given format, optionally gathering
+ *  statistics about the load. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_load_ext(IO_Format const format, char const * const filename,
+            Matrix * const M, IO_Stats * const stats)
+{
+  int (*load)(char const *, Matrix *);
+
+  switch (format) {
+    case IO_BIN:    load = IO_bin_load;    break;
+    case IO_CLUTO:  load = IO_cluto_load;  break;
+    case IO_GAP:    load = IO_gap_load;    break;
+    case IO_METIS:  load = IO_metis_load;  break;
+    case IO_MM:     load = IO_mm_load;     break;
+    case IO_SNAP:   load = IO_snap_load;   break;
+    case IO_UGRAPH: load = IO_ugraph_load; break;
+    default:        return -1;
+  }
+
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  double const t0 = stats_begin(stats);
+
+  int const ret = load(filename, M);
+
+  stats_end(stats, t0, (0 == ret) ? M : NULL);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a file in the given format, optionally gathering
+ *  statistics about the save. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_save_ext(IO_Format const format, char const * const filename,
+            Matrix const * const M, IO_Stats * const stats)
+{
+  int (*save)(char const *, Matrix const *);
+
+  switch (format) {
+    case IO_BIN:    save = IO_bin_save;    break;
+    case IO_CLUTO:  save = IO_cluto_save;  break;
+    case IO_DIMACS: save = IO_dimacs_save; break;
+    case IO_GAP:    save = IO_gap_save;    break;
+    case IO_METIS:  save = IO_metis_save;  break;
+    case IO_MM:     save = IO_mm_save;     break;
+    case IO_SNAP:   save = IO_snap_save;   break;
+    case IO_UGRAPH: save = IO_ugraph_save; break;
+    default:        return -1;
+  }
+
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
+
+  double const t0 = stats_begin(stats);
+
+  int const ret = save(filename, M);
+
+  stats_end(stats, t0, M);
+  if (NULL != stats)
+    stats->size = 0;
+
+  return ret;
+}
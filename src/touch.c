@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: MIT */
+#include <stdint.h>
+#include <string.h>
+
+#include "efika/core.h"
+
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+#include "efika/io/slab.h"
+#include "efika/io/touch.h"
+
+/*----------------------------------------------------------------------------*/
+/*! First row of part k of the nparts parts of nr rows: the caller's boundary,
+ *  clamped to the rows, or that of equal blocks, as schedule(static) makes,
+ *  when no partition was given. The parts always start at row 0 and end at
+ *  row nr. */
+/*----------------------------------------------------------------------------*/
+static ind_t
+touch_bound(int const k, int const nparts, ind_t const nr)
+{
+  ind_t const * const part = IO_opts.part;
+
+  if (0 == k)
+    return 0;
+  if (nparts == k)
+    return nr;
+  if (NULL == part)
+    return (ind_t)((uint64_t)nr * k / nparts);
+  return (part[k] < nr) ? part[k] : nr;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Touch the per-row arrays of a matrix with nr rows and nvwgt vertex weights
+ *  per row, each part of the rows from thread k of an nparts-thread team, so
+ *  that their pages are placed near the threads that will process them. */
+/*----------------------------------------------------------------------------*/
+void
+IO_touch_rows(IO_csr const * const csr, ind_t const nr, ind_t const nvwgt)
+{
+  int const nparts = IO_opts.nparts;
+
+  if (0 >= nparts)
+    return;
+
+  #pragma omp parallel for num_threads(nparts) schedule(static, 1)
+  for (int k = 0; k < nparts; k++) {
+    ind_t const r0 = touch_bound(k, nparts, nr);
+    ind_t const r1 = touch_bound(k + 1, nparts, nr);
+    if (r0 >= r1)
+      continue;
+
+    /* ...ia has one more entry, which goes with the last part... */
+    size_t const n = (size_t)(r1 - r0) + (nr == r1);
+    memset(csr->ia + r0, 0, n * sizeof(*csr->ia));
+    if (NULL != csr->vwgt)
+      memset(csr->vwgt + (size_t)r0 * nvwgt, 0,
+             (size_t)(r1 - r0) * nvwgt * sizeof(*csr->vwgt));
+    if (NULL != csr->vsiz)
+      memset(csr->vsiz + r0, 0, (size_t)(r1 - r0) * sizeof(*csr->vsiz));
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Touch the non-zeros of a matrix with nr rows, whose row pointers ia are
+ *  final, each part of the rows from thread k of an nparts-thread team. Parts
+ *  whose row pointers are out of order, as in a corrupt file that has yet to
+ *  be rejected, are left alone. */
+/*----------------------------------------------------------------------------*/
+void
+IO_touch_nnz(ind_t const nr, ind_t const * const ia, ind_t * const ja,
+             val_t * const a)
+{
+  int const nparts = IO_opts.nparts;
+
+  if (0 >= nparts)
+    return;
+
+  #pragma omp parallel for num_threads(nparts) schedule(static, 1)
+  for (int k = 0; k < nparts; k++) {
+    ind_t const r0 = touch_bound(k, nparts, nr);
+    ind_t const r1 = touch_bound(k + 1, nparts, nr);
+    if (r0 >= r1 || ia[r0] < ia[0] || ia[r0] > ia[r1] || ia[r1] > ia[nr])
+      continue;
+
+    size_t const n = (size_t)(ia[r1] - ia[r0]);
+    memset(ja + ia[r0], 0, n * sizeof(*ja));
+    if (NULL != a)
+      memset(a + ia[r0], 0, n * sizeof(*a));
+  }
+}
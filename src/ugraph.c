@@ -1,233 +1,518 @@
 /* SPDX-License-Identifier: MIT */
-#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/core/gc.h"
+#include "efika/core/pp.h"
+#include "efika/io/cache.h"
+#include "efika/io/metis.h"
+#include "efika/io/options.h"
+#include "efika/io/reader.h"
+#include "efika/io/rename.h"
+#include "efika/io/scan.h"
+#include "efika/io/slab.h"
+#include "efika/io/sort.h"
+#include "efika/io/stats.h"
+#include "efika/io/touch.h"
+#include "efika/io/writer.h"
 
-#include "../common.h"
-#include "../insist.h"
+/*----------------------------------------------------------------------------*/
+/*! Get next non-comment line from a file. */
+/*----------------------------------------------------------------------------*/
+static inline intmax_t
+getline_nc(IO_reader * const reader, char const ** const lineptr)
+{
+  intmax_t ret;
+
+  /* skip comment lines */
+  do {
+    ret = IO_reader_getline(reader, lineptr);
+  } while (0 < ret && '%' == *lineptr[0]);
+
+  return ret;
+}
 
 /*----------------------------------------------------------------------------*/
-/*! Function to read a ugraph file. */
+/*! Split the rows of the upper triangle into nparts ranges of about the same
+ *  number of non-zeros, range t being rows [bounds[t], bounds[t+1]). */
 /*----------------------------------------------------------------------------*/
-extern int
-IO_ugraph_load(FILE * const istream, Matrix * const m)
+static void
+ugraph_split(int const nparts, ind_t const nr, ind_t const * const uia,
+             ind_t * const bounds)
 {
-  int ret=-1, fmt=0;
-  size_t n=0;
-  ind_t i, j, v, tmp;
-  ind_t nr, nnz, nnnz, ncon=0;
-  char * tok, * line=NULL;
-  ind_t * tia=NULL, * ia=NULL, * ja=NULL, * vsiz=NULL;
-  val_t * a=NULL, * vwgt=NULL;
+  ind_t i = 0;
+
+  bounds[0] = 0;
+  for (int t = 1; t < nparts; t++) {
+    uint64_t const target = (uint64_t)uia[nr] * (uint64_t)t / (uint64_t)nparts;
+    while (i < nr && (uint64_t)uia[i] < target)
+      i++;
+    bounds[t] = i;
+  }
+  bounds[nparts] = nr;
+}
 
-  insist(NULL != istream);
-  insist(NULL != m);
+/*----------------------------------------------------------------------------*/
+/*! Mirror the upper triangle uia/uja/ua into the full symmetric matrix
+ *  ia/ja/a. Each range of rows counts, then scatters, its mirrored entries
+ *  into slots reserved for it in every row, so that ranges proceed
+ *  independently. Row i holds its mirrored entries, in ascending order,
+ *  followed by its own entries in file order. cnt must hold nparts*nr zeros. */
+/*----------------------------------------------------------------------------*/
+static void
+ugraph_symmetrize(int const nparts, ind_t const nr, ind_t const * const bounds,
+                  ind_t * const cnt, ind_t const * const uia,
+                  ind_t const * const uja, val_t const * const ua,
+                  ind_t * const ia, ind_t * const ja, val_t * const a)
+{
+  /* count the mirrored entries per row for each range */
+  #pragma omp parallel for num_threads(nparts) schedule(static, 1)
+  for (int t = 0; t < nparts; t++) {
+    ind_t * const tcnt = cnt + (size_t)t * nr;
+    for (ind_t i = bounds[t]; i < bounds[t+1]; i++)
+      for (ind_t j = uia[i]; j < uia[i+1]; j++)
+        if (uja[j] != i)
+          tcnt[uja[j]]++;
+  }
 
-  do {
-    insist(0 < getline(&line, &n, istream));
-  } while ('%' == line[0]);
-
-  switch (sscanf(line, IND_T" "IND_T" %d "IND_T"\n", &nr, &nnz, &fmt, &ncon))
-  {
-    case 4:
-    /* validate */
-    if (0 == ncon) {
-      //gkl_pwarn("ncon cannot equal 0\n");
-      goto CLEANUP;
-    }
-    if ( 10 != fmt &&  11 != fmt && 110 != fmt && 111 != fmt) {
-      //gkl_pwarn("invalid format value (%d) with non-zero ncon\n", fmt);
-      goto CLEANUP;
+  /* convert the counts into row pointers and per-range row offsets */
+  #pragma omp parallel for num_threads(nparts) schedule(static)
+  for (ind_t i = 0; i < nr; i++) {
+    ind_t sum = uia[i+1] - uia[i];
+    for (int t = 0; t < nparts; t++)
+      sum += cnt[(size_t)t * nr + i];
+    ia[i+1] = sum;
+  }
+
+  ia[0] = 0;
+  for (ind_t i = 0; i < nr; i++)
+    ia[i+1] += ia[i];
+  IO_touch_nnz(nr, ia, ja, a);
+
+  #pragma omp parallel for num_threads(nparts) schedule(static)
+  for (ind_t i = 0; i < nr; i++) {
+    ind_t off = ia[i];
+    for (int t = 0; t < nparts; t++) {
+      ind_t const c = cnt[(size_t)t * nr + i];
+      cnt[(size_t)t * nr + i] = off;
+      off += c;
     }
-    /* fall through */
-
-    case 3:
-    /* validate */
-    if (  0 != fmt &&   1 != fmt &&  10 != fmt &&  11 != fmt && 100 != fmt &&
-        101 != fmt && 110 != fmt && 111 != fmt) {
-      //gkl_pwarn("invalid format value (%d)\n", fmt);
-      goto CLEANUP;
+  }
+
+  /* place the own entries of each row and scatter their mirrors */
+  #pragma omp parallel for num_threads(nparts) schedule(static, 1)
+  for (int t = 0; t < nparts; t++) {
+    ind_t * const tcnt = cnt + (size_t)t * nr;
+    for (ind_t i = bounds[t]; i < bounds[t+1]; i++) {
+      ind_t const len = uia[i+1] - uia[i];
+      ind_t const off = ia[i+1] - len;
+
+      memcpy(ja + off, uja + uia[i], len * sizeof(*ja));
+      if (NULL != a)
+        memcpy(a + off, ua + uia[i], len * sizeof(*a));
+
+      for (ind_t j = uia[i]; j < uia[i+1]; j++) {
+        if (uja[j] != i) {
+          if (NULL != a)
+            a[tcnt[uja[j]]] = ua[j];
+          ja[tcnt[uja[j]]++] = i;
+        }
+      }
     }
-    /* fall through */
+  }
+}
 
-    case 2:
-    nnz *= 2;
-    break;
+/*----------------------------------------------------------------------------*/
+/*! Parse a ugraph file from an open input source. */
+/*----------------------------------------------------------------------------*/
+static int
+ugraph_parse(IO_reader * const reader, Matrix * const M)
+{
+  /* ...garbage collected function... */
+  GC_func_init();
 
-    default:
-    //gkl_pwarn("too many entries on header line\n");
-    goto CLEANUP;
-  }
+  int fmt = 0;
+  intmax_t len;
+  ind_t i, j;
+  ind_t nr, nnz, nnnz, ndiag = 0, ncon = 0;
+  char const * line, * p, * q;
+
+  reader->comment = '%';
+
+  /* read the file header */
+  GC_assert(0 == IO_metis_header(reader, &nr, &nnz, &fmt, &ncon));
 
-  insist(NULL != (tia=(ind_t *) calloc((nr+1), sizeof(ind_t))));
-  insist(NULL != (ia=(ind_t *) malloc((nr+1)*sizeof(ind_t))));
-  insist(NULL != (ja=(ind_t *) malloc(nnz*sizeof(ind_t))));
+  IO_stats_phase(IO_PHASE_PARSE);
+
+  ind_t * const uia = GC_malloc((nr + 1) * sizeof(*uia));
+  ind_t * const uja = GC_malloc(nnz * sizeof(*uja));
+  val_t *ua = NULL;
+  val_t *vwgt = NULL;
+  ind_t *vsiz = NULL;
   if (has_adjwgt(fmt))
-    insist(NULL != (a=(val_t *) malloc(nnz*sizeof(val_t))));
+    ua = GC_malloc(nnz * sizeof(*ua));
   if (has_vtxwgt(fmt))
-    insist(NULL != (vwgt=(val_t *) malloc(ncon*nr*sizeof(val_t))));
+    vwgt = GC_malloc(ncon * nr * sizeof(*vwgt));
   if (has_vtxsiz(fmt))
-    insist(NULL != (vsiz=(ind_t *) malloc(nr*sizeof(ind_t))));
-
-  //gkl_print("   nr="IND_T", nc="IND_T", nnz="IND_T"\n", nr, nr, nnz);
-  //gkl_print("   fmt=%d, symm=%d, sort=%d\n\n", fmt, 1, 0);
+    vsiz = GC_malloc(nr * sizeof(*vsiz));
 
-  for (nnnz=0,i=0; i<nr; ++i) {
-    insist(0 < getline(&line, &n, istream));
+  uia[0] = 0;
+  for (nnnz = 0, i = 0; i < nr; i++) {
+    GC_assert(0 < (len = getline_nc(reader, &line)));
 
-    if ('%' == line[0]) {
-      i--;
-      continue;
-    }
+    char const * const eol = line + len;
 
-    tok = strtok(line, " \t\n");
+    p = line;
     if (has_vtxsiz(fmt)) {
-      insist(NULL != tok);
-
-      vsiz[i] = strtoi(tok, NULL);
-      tok = strtok(NULL, " \t\n");
+      vsiz[i] = IO_strtoi(p, eol, &q);
+      GC_assert(q != p);
+      p = q;
     }
 
     if (has_vtxwgt(fmt)) {
-      for (j=0; j<ncon; ++j) {
-        insist(NULL != tok);
-
-        vwgt[i*ncon+j] = strtov(tok, NULL);
-        tok = strtok(NULL, " \t\n");
+      for (j = 0; j < ncon; j++) {
+        vwgt[i * ncon + j] = IO_strtov(p, eol, &q);
+        GC_assert(q != p);
+        p = q;
       }
     }
 
-    tmp = tia[i];
-    tia[i] = nnnz;
-    nnnz += tmp;
+    while (1) {
+      ind_t const v = IO_strtoi(p, eol, &q);
+      if (q == p)
+        break;
+      p = q;
 
-    while (NULL != tok) {
-      v = strtoi(tok, NULL)-1;
+      /* insist that not all non-zeros have already been read */
+      GC_assert(nnnz < nnz);
 
-      if (v < i) {
-        //gkl_pwarn("non-zero specified from lower triangle\n");
-        goto CLEANUP;
-      }
+      /* insist that the non-zero is in the upper triangle */
+      GC_assert(i < v && v <= nr);
 
-      ja[nnnz] = v;
-      tia[v]++;
+      uja[nnnz] = v - 1;
+      if (v - 1 == i)
+        ndiag++;
 
       if (has_adjwgt(fmt)) {
-        insist(NULL != tok);
-
-        a[nnnz] = strtov(tok, NULL);
-        tok = strtok(NULL, " \t\n");
+        ua[nnnz] = IO_strtov(p, eol, &q);
+        GC_assert(q != p);
+        p = q;
       }
 
-      tok = strtok(NULL, " \t\n");
-      if (++nnnz == nnz && NULL != tok) {
-        //gkl_pwarn("too many edges specified in file\n");
-        goto CLEANUP;
-      }
+      nnnz++;
     }
+
+    /* insist that the whole line was consumed */
+    GC_assert(eol == IO_skipspace(p, eol));
+
+    uia[i+1] = nnnz;
   }
-  tia[i] = nnnz;
+  GC_assert(nnnz == nnz);
+
+  while (0 < IO_reader_getline(reader, &line))
+    GC_assert('%' == line[0]);
+
+  IO_stats_phase(IO_PHASE_BUILD);
+
+  /* ...diagonal entries have no mirror... */
+  nnz = 2 * nnz - ndiag;
+
+  int const nparts = IO_nthreads_rows(nr, nnz);
+
+  ind_t * const bounds = GC_malloc((nparts + 1) * sizeof(*bounds));
+  ind_t * const cnt = GC_calloc((size_t)nparts * nr, sizeof(*cnt));
+
+  /* allocate memory for /M/, into which the vertex data is moved */
+  IO_csr csr;
+  GC_assert(0 == IO_csr_alloc(&csr, nr, nnz, has_adjwgt(fmt),
+                              has_vtxwgt(fmt) ? ncon : 0, has_vtxsiz(fmt)));
+  GC_register_free(IO_csr_free, &csr);
+
+  ind_t * const ia = csr.ia;
+  ind_t * const ja = csr.ja;
+  val_t * const a  = csr.a;
+
+  if (NULL != csr.vwgt)
+    memcpy(csr.vwgt, vwgt, ncon * nr * sizeof(*vwgt));
+  if (NULL != csr.vsiz)
+    memcpy(csr.vsiz, vsiz, nr * sizeof(*vsiz));
+
+  /* ...rows of the upper triangle in order mirror into ordered rows... */
+  if (IO_opts.sort)
+    GC_assert(0 == IO_sort_rows(nr, uia, uja, ua));
+
+  ugraph_split(nparts, nr, uia, bounds);
+  ugraph_symmetrize(nparts, nr, bounds, cnt, uia, uja, ua, ia, ja, a);
+
+  GC_free(cnt);
+  GC_free(bounds);
+  if (NULL != vsiz)
+    GC_free(vsiz);
+  if (NULL != vwgt)
+    GC_free(vwgt);
+  if (NULL != ua)
+    GC_free(ua);
+  GC_free(uja);
+  GC_free(uia);
+
+  M->fmt   = fmt;
+  /*M->diag  = 0;*/
+  M->sort  = IO_opts.sort ? ASC : NONE;
+  M->symm  = 1;
+  M->nr    = nr;
+  M->nc    = nr;
+  M->nnz   = nnz;
+  M->ia    = ia;
+  M->ja    = ja;
+  M->a     = a;
+  M->ncon  = ncon;
+  M->vsiz  = csr.vsiz;
+  M->vwgt  = csr.vwgt;
+
+  return 0;
+}
 
-  insist(nnnz == nnz);
+/*----------------------------------------------------------------------------*/
+/*! Function to read a ugraph file, which is a metis file that lists only the
+ *  upper triangle of its graph: row i holds neighbors v >= i, and the header
+ *  counts these entries. The other triangle is mirrored on load. */
+/*----------------------------------------------------------------------------*/
+static int
+ugraph_load(char const * const filename, Matrix * const M)
+{
+  IO_reader reader;
 
-  while (!feof(istream) && 0 < getline(&line, &n, istream))
-    insist('%' == line[0]);
+  /* validate input */
+  if (!pp_all(filename, M))
+    return -1;
 
-  memcpy(ia, tia, (nr+1)*sizeof(ind_t));
+  /* open input file */
+  if (0 != IO_reader_open(&reader, filename))
+    return -1;
 
-  for (i=0; i<nr; ++i) {
-    for (j=tia[i]; j<tia[i+1]; ++j) {
-      if (ja[j] > i) {
-        if (has_adjwgt(fmt))
-          a[tia[ja[j]]] = a[j];
-        ja[tia[ja[j]]++] = i;
-      }
-    }
-  }
+  int const ret = ugraph_parse(&reader, M);
+  IO_reader_close(&reader);
 
-  m->fmt   = fmt;
-  /*m->diag  = 0;*/
-  /*m->sort  = NONE;*/
-  m->symm  = 1;
-  m->nr    = nr;
-  m->nc    = nr;
-  m->nnz   = nnz;
-  m->ia    = ia;
-  m->ja    = ja;
-  m->a     = a;
-  m->ncon  = ncon;
-  m->vsiz  = vsiz;
-  m->vwgt  = vwgt;
-
-  ret = 0;
-
-  CLEANUP:
-  if (-1 == ret) {
-    free(ia);
-    free(ja);
-    free(a);
-    free(vsiz);
-    free(vwgt);
-  }
-  free(line);
-  free(tia);
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a ugraph file, through the binary cache when enabled. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_ugraph_load(char const * const filename, Matrix * const M)
+{
+  return IO_cache_load(IO_UGRAPH, filename, M, ugraph_load);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a ugraph file from descriptor fd, such as a pipe or socket,
+ *  which is read from its current position to its end and left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_ugraph_load_fd(int const fd, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_fd(&reader, fd))
+    return -1;
+
+  int const ret = ugraph_parse(&reader, M);
+  IO_reader_close(&reader);
 
   return ret;
 }
 
 /*----------------------------------------------------------------------------*/
-/*! Function to write a ugraph file. */
+/*! Function to read a ugraph file from stream, which is read from its current
+ *  position to its end and left open. */
 /*----------------------------------------------------------------------------*/
-extern int
-IO_ugraph_save(FILE * const ostream, Matrix const * const m)
+EFIKA_EXPORT int
+IO_ugraph_load_stream(FILE * const stream, Matrix * const M)
 {
-  int fmt, ret=-1;
-  ind_t i, j;
-  ind_t nr, nnz, ncon;
-  ind_t const * ia, * ja, * vsiz;
-  val_t const * a, * vwgt;
+  IO_reader reader;
 
-  insist(NULL != ostream);
-  insist(NULL != m);
+  /* validate input */
+  if (!pp_all(stream, M))
+    return -1;
 
-  if (1 != m->symm)
+  /* open input source */
+  if (0 != IO_reader_open_stream(&reader, stream))
     return -1;
 
-  fmt  = m->fmt;
-  nr   = m->nr;
-  nnz  = m->nnz;
-  ncon = m->ncon;
-  ia   = m->ia;
-  ja   = m->ja;
-  a    = m->a;
-  vwgt = m->vwgt;
-  vsiz = m->vsiz;
-
-  fprintf(ostream, IND_T" "IND_T, nr, nnz/2);
-  if (fmt > 0)
-    fprintf(ostream, " %03d "IND_T, fmt, ncon);
-  fprintf(ostream, "\n");
-
-  for (i=0; i<nr; ++i) {
-    if (has_vtxsiz(fmt))
-      fprintf(ostream, IND_T" ", vsiz[i]);
-
-    if (has_vtxwgt(fmt))
-      for (j=0; j<ncon; ++j)
-        fprintf(ostream, VAL_T" ", vwgt[i*ncon+j]);
-
-    for (j=ia[i]; j<ia[i+1]; ++j) {
-      if (i < ja[j]) {
-        fprintf(ostream, IND_T" ", ja[j]+1);
-        if (has_adjwgt(fmt))
-          fprintf(ostream, VAL_T" ", a[j]);
+  int const ret = ugraph_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to read a ugraph file from the len bytes at buf, which are parsed
+ *  in place and left untouched. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_ugraph_load_mem(char const * const buf, size_t const len, Matrix * const M)
+{
+  IO_reader reader;
+
+  /* validate input */
+  if (!pp_all(buf, M))
+    return -1;
+
+  /* open input source */
+  if (0 != IO_reader_open_mem(&reader, buf, len))
+    return -1;
+
+  int const ret = ugraph_parse(&reader, M);
+  IO_reader_close(&reader);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Format rows [r0, r1) of a ugraph file. */
+/*----------------------------------------------------------------------------*/
+static void
+ugraph_rows(IO_writer * const writer, Matrix const * const M, ind_t const r0,
+            ind_t const r1)
+{
+  /* unpack /M/ */
+  int   const fmt  = M->fmt;
+  ind_t const ncon = M->ncon;
+  ind_t const * const ia   = M->ia;
+  ind_t const * const ja   = M->ja;
+  val_t const * const a    = M->a;
+  val_t const * const vwgt = M->vwgt;
+  ind_t const * const vsiz = M->vsiz;
+
+  for (ind_t i = r0; i < r1; i++) {
+    if (has_vtxsiz(fmt)) {
+      IO_writer_puti(writer, vsiz[i]);
+      IO_writer_putc(writer, ' ');
+    }
+
+    if (has_vtxwgt(fmt)) {
+      for (ind_t j = 0; j < ncon; j++) {
+        IO_writer_putv(writer, vwgt[i * ncon + j]);
+        IO_writer_putc(writer, ' ');
       }
     }
-    fprintf(ostream, "\n");
+
+    for (ind_t j = ia[i]; j < ia[i + 1]; j++) {
+      if (i <= ja[j]) {
+        IO_writer_puti(writer, ja[j]+1);
+        IO_writer_putc(writer, ' ');
+        if (has_adjwgt(fmt)) {
+          IO_writer_putv(writer, a[j]);
+          IO_writer_putc(writer, ' ');
+        }
+      }
+    }
+    IO_writer_putc(writer, '\n');
   }
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a ugraph file to an output sink, closing it. */
+/*----------------------------------------------------------------------------*/
+static int
+ugraph_write(IO_writer * const writer, Matrix const * const M)
+{
+  /* unpack /M/ */
+  int   const fmt = M->fmt;
+  ind_t const nr   = M->nr;
+  ind_t const nnz  = M->nnz;
+  ind_t const ncon = M->ncon;
+  ind_t const * const ia = M->ia;
+  ind_t const * const ja = M->ja;
+
+  /* ...diagonal entries are stored once... */
+  ind_t ndiag = 0;
+  for (ind_t i = 0; i < nr; i++)
+    for (ind_t j = ia[i]; j < ia[i + 1]; j++)
+      if (i == ja[j])
+        ndiag++;
+
+  IO_stats_phase(IO_PHASE_WRITE);
+
+  IO_writer_printf(writer, PRIind" "PRIind, nr, (nnz+ndiag)/2);
+  if (fmt > 0)
+    IO_writer_printf(writer, " %03d", fmt);
+  if (has_vtxwgt(fmt))
+    IO_writer_printf(writer, " "PRIind, ncon);
+  IO_writer_putc(writer, '\n');
 
-  ret = 0;
+  (void)IO_writer_rows(writer, M, ugraph_rows);
 
-  CLEANUP:
-  return ret;
+  /* ... */
+  return IO_writer_close(writer);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a ugraph file. The matrix must be symmetric. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_ugraph_save(char const * const filename, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(filename, M) || 1 != M->symm)
+    return -1;
+
+  /* open output file */
+  if (0 != IO_writer_open(&writer, filename))
+    return -1;
+
+  return ugraph_write(&writer, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a ugraph file to descriptor fd, such as a pipe or socket,
+ *  which is left open. */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_ugraph_save_fd(int const fd, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(M) || 1 != M->symm)
+    return -1;
+
+  /* open output sink */
+  if (0 != IO_writer_open_fd(&writer, fd))
+    return -1;
+
+  return ugraph_write(&writer, M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Function to write a ugraph file to stream, which is flushed but left open.
+ *  */
+/*----------------------------------------------------------------------------*/
+EFIKA_EXPORT int
+IO_ugraph_save_stream(FILE * const stream, Matrix const * const M)
+{
+  IO_writer writer;
+
+  /* validate input */
+  if (!pp_all(stream, M) || 1 != M->symm)
+    return -1;
+
+  /* open output sink */
+  if (0 != IO_writer_open_stream(&writer, stream))
+    return -1;
+
+  return ugraph_write(&writer, M);
 }
@@ -0,0 +1,574 @@
+/* SPDX-License-Identifier: MIT */
+#define _POSIX_C_SOURCE 200809L
+#include <float.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef HAVE_PWRITE
+# include <errno.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+#include "efika/core.h"
+
+#include "efika/io/fd.h"
+#include "efika/io/options.h"
+#include "efika/io/rename.h"
+#include "efika/io/stats.h"
+#include "efika/io/writer.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Initialize a memory sink. */
+/*----------------------------------------------------------------------------*/
+static int
+writer_mem_init(IO_writer * const writer)
+{
+  writer->stream   = NULL;
+  writer->len      = 0;
+  writer->pos      = 0;
+  writer->err      = 0;
+  writer->borrowed = 0;
+  writer->ordered  = 0;
+  writer->cap      = IO_WRITER_BUFSIZE;
+  writer->buf      = malloc(writer->cap);
+
+  return writer->buf ? 0 : -1;
+}
+
+#ifdef HAVE_PWRITE
+/*----------------------------------------------------------------------------*/
+/*! Write all of buf at file offset off. */
+/*----------------------------------------------------------------------------*/
+static int
+writer_pwrite(int const fd, char const * buf, size_t len, uint64_t off)
+{
+  while (0 < len) {
+    ssize_t const n = pwrite(fd, buf, len, (off_t)off);
+    if (0 > n) {
+      if (EINTR == errno)
+        continue;
+      return -1;
+    }
+    buf += n;
+    len -= (size_t)n;
+    off += (uint64_t)n;
+  }
+
+  return 0;
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/*! Open an output sink. */
+/*----------------------------------------------------------------------------*/
+int
+IO_writer_open(IO_writer * const writer, char const * const filename)
+{
+  if (0 != writer_mem_init(writer))
+    return -1;
+
+  writer->stream = fopen(filename, "w");
+  if (!writer->stream) {
+    free(writer->buf);
+    return -1;
+  }
+
+  /* ...writer already buffers, so skip the stream's own buffer... */
+  (void)setvbuf(writer->stream, NULL, _IONBF, 0);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Open an output sink on a duplicate of descriptor fd of the caller, such as
+ *  a pipe or socket, writing from its current position. */
+/*----------------------------------------------------------------------------*/
+int
+IO_writer_open_fd(IO_writer * const writer, int const fd)
+{
+  if (0 != writer_mem_init(writer))
+    return -1;
+
+  writer->stream = IO_fd_open(fd, "w");
+  if (!writer->stream) {
+    free(writer->buf);
+    return -1;
+  }
+  writer->ordered = 1;
+
+  /* ...writer already buffers, so skip the stream's own buffer... */
+  (void)setvbuf(writer->stream, NULL, _IONBF, 0);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Open an output sink on stream, which belongs to the caller and is written
+ *  from its current position, then flushed but not closed. */
+/*----------------------------------------------------------------------------*/
+int
+IO_writer_open_stream(IO_writer * const writer, FILE * const stream)
+{
+  if (0 != writer_mem_init(writer))
+    return -1;
+
+  writer->stream   = stream;
+  writer->borrowed = 1;
+  writer->ordered  = 1;
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Flush and close an output sink, adding the bytes written to the statistics
+ *  of the calling thread. Returns -1 if any write failed. */
+/*----------------------------------------------------------------------------*/
+int
+IO_writer_close(IO_writer * const writer)
+{
+  (void)IO_writer_flush(writer);
+
+  if (NULL != writer->stream && writer->borrowed &&
+      0 != fflush(writer->stream))
+    writer->err = 1;
+  if (NULL != writer->stream && !writer->borrowed &&
+      0 != fclose(writer->stream))
+    writer->err = 1;
+  free(writer->buf);
+
+  if (NULL != writer->stream && NULL != IO_stats.stats)
+    IO_stats.stats->bytes += writer->pos;
+
+  return writer->err ? -1 : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write out all buffered bytes. A memory sink keeps them. */
+/*----------------------------------------------------------------------------*/
+int
+IO_writer_flush(IO_writer * const writer)
+{
+  if (NULL == writer->stream)
+    return writer->err ? -1 : 0;
+
+  if (0 < writer->len &&
+      writer->len != fwrite(writer->buf, 1, writer->len, writer->stream))
+    writer->err = 1;
+  writer->pos += writer->len;
+  writer->len  = 0;
+
+  return writer->err ? -1 : 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Make room for more than n bytes, flushing and then growing the buffer as
+ *  needed. On failure, the error is recorded and buffered bytes are dropped. */
+/*----------------------------------------------------------------------------*/
+void
+IO_writer_room(IO_writer * const writer, size_t const n)
+{
+  (void)IO_writer_flush(writer);
+
+  if (writer->cap - writer->len > n)
+    return;
+
+  size_t cap = 2 * writer->cap;
+  if (cap <= writer->len + n)
+    cap = writer->len + n + 1;
+
+  char * const buf = realloc(writer->buf, cap);
+  if (!buf) {
+    writer->err = 1;
+    writer->len = 0;
+    return;
+  }
+
+  writer->buf = buf;
+  writer->cap = cap;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Format into the output buffer. */
+/*----------------------------------------------------------------------------*/
+void
+IO_writer_printf(IO_writer * const writer, char const * const format, ...)
+{
+  va_list ap;
+  int n;
+
+  IO_writer_reserve(writer);
+
+  va_start(ap, format);
+  n = vsnprintf(writer->buf + writer->len, writer->cap - writer->len, format,
+                ap);
+  va_end(ap);
+
+  if (0 > n) {
+    writer->err = 1;
+    return;
+  }
+
+  if ((size_t)n >= writer->cap - writer->len) {
+    IO_writer_room(writer, (size_t)n);
+    if ((size_t)n >= writer->cap - writer->len)
+      return;
+
+    va_start(ap, format);
+    n = vsnprintf(writer->buf + writer->len, writer->cap - writer->len, format,
+                  ap);
+    va_end(ap);
+  }
+
+  writer->len += (size_t)n;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Powers of ten that are exact in a double. */
+/*----------------------------------------------------------------------------*/
+static double const vtoa_pow10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Decide whether m*10^q reads back as x > 0: 1 if it does, 0 if it does not,
+ *  -1 when that cannot be decided exactly with one correctly rounded double
+ *  multiply or divide. */
+/*----------------------------------------------------------------------------*/
+static int
+vtoa_check(val_t const x, uint64_t const m, int const q)
+{
+  if (m > (UINT64_C(1) << 53) || -22 > q || q > 22)
+    return -1;
+
+  double const v = (0 > q) ? (double)m / vtoa_pow10[-q]
+                           : (double)m * vtoa_pow10[q];
+
+  if (sizeof(val_t) >= sizeof(double))
+    return v == (double)x;
+
+  if ((val_t)v != x)
+    return 0;
+
+  /* ...unless the double is exact, landing halfway between two values of x's
+   * type may hide which side of the halfway point m*10^q itself lies on... */
+  double const d = v - (double)x;
+  if (0 != d && (0 > q || v >= (double)(UINT64_C(1) << 53))) {
+    double const g = (double)x + 2 * d;
+    if ((double)(val_t)g == g)
+      return -1;
+  }
+
+  return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write m*10^q, with m > 0, in the notation ECMAScript uses for numbers:
+ *  positional when the leading digit is within 10^-6 and 10^20, exponential
+ *  otherwise. Returns the number of characters written. */
+/*----------------------------------------------------------------------------*/
+static size_t
+vtoa_emit(uint64_t m, int q, char * const buf)
+{
+  char d[24];
+
+  while (0 == m % 10) {
+    m /= 10;
+    q++;
+  }
+
+  int const nd = (int)IO_utoa((uintmax_t)m, d);
+  int const e  = q + nd - 1;
+  char * p = buf;
+
+  if (-7 < e && e < 21) {
+    if (0 <= q) {
+      memcpy(p, d, (size_t)nd);
+      p += nd;
+      memset(p, '0', (size_t)q);
+      p += q;
+    } else if (0 <= e) {
+      memcpy(p, d, (size_t)e + 1);
+      p += e + 1;
+      *p++ = '.';
+      memcpy(p, d + e + 1, (size_t)(nd - e - 1));
+      p += nd - e - 1;
+    } else {
+      *p++ = '0';
+      *p++ = '.';
+      memset(p, '0', (size_t)(-e - 1));
+      p += -e - 1;
+      memcpy(p, d, (size_t)nd);
+      p += nd;
+    }
+  } else {
+    *p++ = d[0];
+    if (1 < nd) {
+      *p++ = '.';
+      memcpy(p, d + 1, (size_t)nd - 1);
+      p += nd - 1;
+    }
+    *p++ = 'e';
+    *p++ = (0 > e) ? '-' : '+';
+    p += IO_utoa((uintmax_t)(0 > e ? -e : e), p);
+  }
+
+  return (size_t)(p - buf);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Round z > 0 to a multiple of 10^q, with |q| <= 22, ties to even, and tell
+ *  whether z was too close to a tie to be sure of the direction. */
+/*----------------------------------------------------------------------------*/
+static uint64_t
+vtoa_round(double const z, int const q, int * const tie)
+{
+  double const s = (0 > q) ? z * vtoa_pow10[-q] : z / vtoa_pow10[q];
+  uint64_t m = (uint64_t)s;
+  double const f = s - (double)m;
+
+  if (f > 0.5 || (f == 0.5 && (m & 1)))
+    m++;
+
+  /* ...s is off by up to half an ulp... */
+  *tie = (0.5 - s * DBL_EPSILON <= f && f <= 0.5 + s * DBL_EPSILON);
+
+  return m;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Format a value with the fewest significant digits that read back exactly,
+ *  or, when prec is positive, with at most prec significant digits, rounding
+ *  when that is fewer than needed. Digits are found by scaling with exact
+ *  powers of ten, checked with a correctly rounded multiply or divide, and
+ *  dropped for as long as the value still reads back; values outside that
+ *  range, or too close to call, go through snprintf. Returns the number of
+ *  characters written to buf, which must have room for 32. */
+/*----------------------------------------------------------------------------*/
+size_t
+IO_vtoa(val_t const x, int const prec, char * const buf)
+{
+  int const nmax  = sizeof(val_t) < sizeof(double) ? 9 : 17;
+  int const lossy = (0 < prec && prec < nmax);
+  size_t len = 0;
+
+  /* ...a double cannot check 17 digits, so start at 16 and add one if need
+   * be... */
+  int const n1 = lossy ? prec : (sizeof(val_t) < sizeof(double) ? 9 : 16);
+  int n0 = lossy ? prec : 1;
+
+  if (isnan(x)) {
+    memcpy(buf, "nan", 3);
+    return 3;
+  }
+
+  if (signbit(x))
+    buf[len++] = '-';
+
+  val_t const y = signbit(x) ? -x : x;
+
+  if (isinf(y)) {
+    memcpy(buf + len, "inf", 3);
+    return len + 3;
+  }
+  if (0 == y) {
+    buf[len++] = '0';
+    return len;
+  }
+
+  /* ...find the power of ten of the leading digit, within the exact ones... */
+  double const z = (double)y;
+  int e = 0;
+
+  if (1 <= z) {
+    while (22 > e && vtoa_pow10[e + 1] <= z)
+      e++;
+  } else {
+    while (-22 < e && 1 > z * vtoa_pow10[-e])
+      e--;
+  }
+
+  int q = e - n1 + 1;
+
+  if (z < vtoa_pow10[22] * 10 && 1 <= z * vtoa_pow10[22] && -22 <= q) {
+    int tie;
+    uint64_t m = vtoa_round(z, q, &tie);
+    int ok = vtoa_check(y, m, q);
+
+    /* ...rounding may have missed by one... */
+    if (0 == ok && !lossy) {
+      if (1 == vtoa_check(y, m - 1, q)) {
+        m--;
+        ok = 1;
+      } else if (1 == vtoa_check(y, m + 1, q)) {
+        m++;
+        ok = 1;
+      } else {
+        n0 = n1 + 1 < nmax ? n1 + 1 : nmax;
+      }
+    }
+
+    if (1 == ok) {
+      while (0 == m % 10) {
+        m /= 10;
+        q++;
+      }
+
+      /* ...drop digits for as long as what is left still reads back... */
+      while (22 > q) {
+        uint64_t const mm = vtoa_round(z, q + 1, &tie);
+        if (0 == mm || 1 != vtoa_check(y, mm, q + 1))
+          break;
+        m = mm;
+        q++;
+      }
+
+      return len + vtoa_emit(m, q, buf + len);
+    }
+
+    if (lossy && 0 < m && !tie)
+      return len + vtoa_emit(m, q, buf + len);
+  }
+
+  /* ...slow path, let snprintf round and strtov read back... */
+  char s[32];
+  for (int n = n0; n <= nmax; n++) {
+    char * end;
+
+    (void)snprintf(s, sizeof(s), "%.*e", n - 1, (double)y);
+    if (lossy || strtov(s, &end) == y)
+      break;
+  }
+
+  /* ...and emit its digits d.ddde+xx, that is m*10^q, like the fast path */
+  char * p = s;
+  uint64_t m = 0;
+  int nd = 0;
+  for (; '.' == *p || ('0' <= *p && *p <= '9'); p++) {
+    if ('.' != *p) {
+      m = m * 10 + (uint64_t)(*p - '0');
+      nd++;
+    }
+  }
+  q = (int)strtol(p + 1, NULL, 10) - nd + 1;
+
+  return len + vtoa_emit(m, q, buf + len);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Format all rows of /M/ with /fn/. With more than one thread, rows are cut
+ *  into blocks of about IO_WRITER_BLOCK work each; every round, each thread
+ *  formats one block into a private memory sink, the block sizes are
+ *  prefix-summed into file offsets and the blocks are written concurrently
+ *  with pwrite (or in order, when the stream cannot be positioned). */
+/*----------------------------------------------------------------------------*/
+int
+IO_writer_rows(IO_writer * const writer, Matrix const * const M,
+               IO_writer_rows_fn const fn)
+{
+  int const nthreads = IO_nthreads();
+  ind_t const nr = M->nr;
+  ind_t const * const ia = M->ia;
+
+  if (1 >= nthreads || NULL == writer->stream) {
+    fn(writer, M, 0, nr);
+    return writer->err ? -1 : 0;
+  }
+
+  /* everything before the rows goes out first */
+  if (0 != IO_writer_flush(writer))
+    return -1;
+
+  int fd = -1;
+#ifdef HAVE_PWRITE
+  if (!writer->ordered) {
+    fd = fileno(writer->stream);
+    if (-1 == lseek(fd, 0, SEEK_CUR))
+      fd = -1;
+  }
+#endif
+
+  IO_writer * const tw = calloc((size_t)nthreads, sizeof(*tw));
+  ind_t * const rb = malloc(((size_t)nthreads + 1) * sizeof(*rb));
+  uint64_t * const off = malloc((size_t)nthreads * sizeof(*off));
+  if (!tw || !rb || !off)
+    writer->err = 1;
+  for (int t = 0; !writer->err && t < nthreads; t++)
+    if (0 != writer_mem_init(&tw[t]))
+      writer->err = 1;
+
+  for (ind_t r = 0; !writer->err && r < nr; r = rb[nthreads]) {
+    /* cut the next round of blocks, each with about IO_WRITER_BLOCK work */
+    rb[0] = r;
+    for (int t = 1; t <= nthreads; t++) {
+      ind_t q = rb[t-1];
+      if (q < nr) {
+        uint64_t const goal = (uint64_t)ia[q] + q + IO_WRITER_BLOCK;
+        ind_t lo = q + 1, hi = nr;
+        while (lo < hi) {
+          ind_t const mid = lo + (hi - lo) / 2;
+          if ((uint64_t)ia[mid] + mid >= goal)
+            hi = mid;
+          else
+            lo = mid + 1;
+        }
+        q = lo;
+      }
+      rb[t] = q;
+    }
+
+    /* format each block */
+    #pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+    for (int t = 0; t < nthreads; t++) {
+      tw[t].len = 0;
+      if (rb[t] < rb[t+1])
+        fn(&tw[t], M, rb[t], rb[t+1]);
+    }
+
+    /* place each block in the file */
+    uint64_t pos = writer->pos;
+    for (int t = 0; t < nthreads; t++) {
+      writer->err |= tw[t].err;
+      off[t] = pos;
+      pos   += tw[t].len;
+    }
+    if (writer->err)
+      break;
+
+    if (-1 != fd) {
+#ifdef HAVE_PWRITE
+      int err = 0;
+      #pragma omp parallel for num_threads(nthreads) schedule(static, 1) \
+        reduction(|:err)
+      for (int t = 0; t < nthreads; t++)
+        err |= writer_pwrite(fd, tw[t].buf, tw[t].len, off[t]);
+      writer->err |= err;
+#endif
+    } else {
+      for (int t = 0; t < nthreads; t++)
+        if (tw[t].len != fwrite(tw[t].buf, 1, tw[t].len, writer->stream))
+          writer->err = 1;
+    }
+    writer->pos = pos;
+  }
+
+#ifdef HAVE_PWRITE
+  /* pwrite does not move the stream, so move it past the rows */
+  if (-1 != fd && !writer->err &&
+      0 != fseeko(writer->stream, (off_t)writer->pos, SEEK_SET))
+    writer->err = 1;
+#endif
+
+  if (tw)
+    for (int t = 0; t < nthreads; t++)
+      free(tw[t].buf);
+  free(tw);
+  free(rb);
+  free(off);
+
+  return writer->err ? -1 : 0;
+}
@@ -0,0 +1,1168 @@
+/* SPDX-License-Identifier: MIT */
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_MKFIFO) && defined(HAVE_FORK)
+# include <sys/wait.h>
+#endif
+#if defined(HAVE_MKSTEMP) || (defined(HAVE_MKFIFO) && defined(HAVE_FORK))
+# include <dirent.h>
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+#include "efika/core.h"
+#include "efika/io.h"
+
+#include "efika/io/rename.h"
+#include "efika/io/writer.h"
+
+/*----------------------------------------------------------------------------*/
+/*! Fixtures, with enough lines to give every thread of a parallel load its own
+ *  range. */
+/*----------------------------------------------------------------------------*/
+static char const mm_general[] =
+  "%%MatrixMarket matrix coordinate real general\n"
+  "% a comment\n"
+  "6 6 14\n"
+  "1 2 0.5\n"   "3 3 2\n"     "6 1 -1.25\n" "2 5 4\n"
+  "% another comment\n"
+  "4 4 8\n"     "1 6 0.125\n" "5 2 3\n"     "2 1 -6\n"
+  "6 6 1.5\n"   "3 4 10\n"    "4 3 0.75\n"  "5 5 7\n"
+  "1 1 9\n"     "2 3 -0.5\n";
+
+static char const mm_symmetric[] =
+  "%%MatrixMarket matrix coordinate real symmetric\n"
+  "3 3 3\n"
+  "1 1 2.0\n"
+  "2 1 1.0\n"
+  "3 3 5.0\n";
+
+static char const mm_duplicate[] =
+  "%%MatrixMarket matrix coordinate real general\n"
+  "3 3 7\n"
+  "1 2 4\n"     "2 2 1\n"     "1 2 -1\n"    "3 1 2\n"
+  "1 2 6\n"     "3 1 0.5\n"   "2 2 3\n";
+
+static char const mm_loops[] =
+  "%%MatrixMarket matrix coordinate real general\n"
+  "3 3 3\n"
+  "1 1 1\n"
+  "2 1 2\n"
+  "3 3 3\n";
+
+static char const metis_graph[] =
+  "% a comment\n"
+  "6 7 11 1\n"
+  "2 2 0.5 3 1\n"
+  "4 1 0.5 4 2\n"
+  "1 1 1 4 3 5 0.25\n"
+  "3 2 2 3 3 6 4\n"
+  "5 3 0.25 6 8\n"
+  "2 4 4 5 8\n";
+
+static char const cluto_matrix[] =
+  "6 8 11\n"
+  "1 0.5 8 2\n"
+  "3 1.5\n"
+  "\n"
+  "2 -4 4 0.25 5 1\n"
+  "7 3 1 6\n"
+  "6 2.5 8 -0.125 3 9\n";
+
+static char const snap_graph[] =
+  "# a comment\n"
+  "1 2\n" "2 3\n" "3 1\n" "4 5\n" "5 6\n" "6 4\n"
+  "# another comment\n"
+  "1 4\n" "2 5\n" "3 6\n" "6 6\n" "5 1\n" "4 2\n";
+
+static char const cluto_unpaired[] =
+  "2 3 2\n"
+  "1 0.5 2\n"
+  "3 1\n";
+
+/*----------------------------------------------------------------------------*/
+/*! Loaders of the text formats from memory, and a fixture for each. */
+/*----------------------------------------------------------------------------*/
+static struct {
+  char const * name;
+  int (*load)(char const *, size_t, Matrix *);
+  char const * text;
+} const fixtures[] = {
+  { "mm",    IO_mm_load_mem,    mm_general },
+  { "metis", IO_metis_load_mem, metis_graph },
+  { "cluto", IO_cluto_load_mem, cluto_matrix },
+  { "snap",  IO_snap_load_mem,  snap_graph }
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Formats that save and load a matrix, and whether it must be symmetric. */
+/*----------------------------------------------------------------------------*/
+static struct {
+  char const * name;
+  int (*load)(char const *, Matrix *);
+  int (*save)(char const *, Matrix const *);
+  int symm;
+} const formats[] = {
+  { "bin",    IO_bin_load,    IO_bin_save,    0 },
+  { "cluto",  IO_cluto_load,  IO_cluto_save,  0 },
+  { "gap",    IO_gap_load,    IO_gap_save,    0 },
+  { "metis",  IO_metis_load,  IO_metis_save,  1 },
+  { "mm",     IO_mm_load,     IO_mm_save,     0 },
+  { "snap",   IO_snap_load,   IO_snap_save,   0 },
+  { "ugraph", IO_ugraph_load, IO_ugraph_save, 1 }
+};
+
+#define NFIXTURES (sizeof(fixtures) / sizeof(*fixtures))
+#define NFORMATS  (sizeof(formats) / sizeof(*formats))
+
+/*----------------------------------------------------------------------------*/
+/*! Report a failed check and fail the enclosing test. */
+/*----------------------------------------------------------------------------*/
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      goto fail; \
+    } \
+  } while (0)
+
+/*----------------------------------------------------------------------------*/
+/*! Set the options of the following loads/saves. */
+/*----------------------------------------------------------------------------*/
+static void
+set_options(int const nthreads, int const sort, int const dedup,
+            int const symmetrize)
+{
+  IO_Options opts;
+
+  IO_options_get(&opts);
+  opts.nthreads   = nthreads;
+  opts.sort       = sort;
+  opts.dedup      = dedup;
+  opts.symmetrize = symmetrize;
+  IO_options_set(&opts);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Load a fixture. */
+/*----------------------------------------------------------------------------*/
+static int
+load_mem(int (*load)(char const *, size_t, Matrix *), char const * const text,
+         Matrix * const M)
+{
+  if (0 != Matrix_init(M))
+    return -1;
+  return load(text, strlen(text), M);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Write a fixture to a file. */
+/*----------------------------------------------------------------------------*/
+static int
+write_file(char const * const path, char const * const text)
+{
+  size_t const len = strlen(text);
+  FILE * const fp = fopen(path, "wb");
+
+  if (NULL == fp)
+    return -1;
+  if (len != fwrite(text, 1, len, fp)) {
+    fclose(fp);
+    return -1;
+  }
+
+  return 0 == fclose(fp) ? 0 : -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Whether two matrices hold the same structure and values. */
+/*----------------------------------------------------------------------------*/
+static int
+same_matrix(Matrix const * const A, Matrix const * const B)
+{
+  if (A->nr != B->nr || A->nc != B->nc || A->nnz != B->nnz)
+    return 0;
+  if (A->symm != B->symm || A->ncon != B->ncon)
+    return 0;
+  if ((NULL == A->a) != (NULL == B->a))
+    return 0;
+  if ((NULL == A->vwgt) != (NULL == B->vwgt))
+    return 0;
+
+  if (0 != memcmp(A->ia, B->ia, (A->nr + 1) * sizeof(*A->ia)))
+    return 0;
+  if (0 != memcmp(A->ja, B->ja, A->nnz * sizeof(*A->ja)))
+    return 0;
+  for (ind_t j = 0; NULL != A->a && j < A->nnz; j++)
+    if (A->a[j] != B->a[j])
+      return 0;
+  for (ind_t i = 0; NULL != A->vwgt && i < A->nr * A->ncon; i++)
+    if (A->vwgt[i] != B->vwgt[i])
+      return 0;
+
+  return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Whether two files hold the same bytes. */
+/*----------------------------------------------------------------------------*/
+static int
+same_file(char const * const path1, char const * const path2)
+{
+  int ret = 0;
+  FILE * const f1 = fopen(path1, "rb");
+  FILE * const f2 = fopen(path2, "rb");
+
+  if (NULL != f1 && NULL != f2) {
+    int c1, c2;
+    do {
+      c1 = fgetc(f1);
+      c2 = fgetc(f2);
+    } while (c1 == c2 && EOF != c1);
+    ret = (c1 == c2);
+  }
+
+  if (NULL != f1)
+    fclose(f1);
+  if (NULL != f2)
+    fclose(f2);
+
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! The value of entry (i,j) of a matrix, 1 when it is a pattern, or -1 when
+ *  the entry is not stored once. */
+/*----------------------------------------------------------------------------*/
+static val_t
+entry(Matrix const * const M, ind_t const i, ind_t const j)
+{
+  val_t w = -1;
+  int n = 0;
+
+  for (ind_t k = M->ia[i]; k < M->ia[i + 1]; k++) {
+    if (j == M->ja[k]) {
+      w = NULL == M->a ? 1 : M->a[k];
+      n++;
+    }
+  }
+
+  return 1 == n ? w : -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! A parallel load builds the same matrix as a serial one. */
+/*----------------------------------------------------------------------------*/
+static int
+test_parallel(void)
+{
+  Matrix S, P;
+
+  for (size_t f = 0; f < NFIXTURES; f++) {
+    set_options(1, 0, IO_DEDUP_NONE, 0);
+    CHECK(0 == load_mem(fixtures[f].load, fixtures[f].text, &S));
+
+    set_options(4, 0, IO_DEDUP_NONE, 0);
+    if (0 != load_mem(fixtures[f].load, fixtures[f].text, &P)) {
+      Matrix_free(&S);
+      CHECK(0);
+    }
+
+    int const same = same_matrix(&S, &P);
+    Matrix_free(&S);
+    Matrix_free(&P);
+    if (!same)
+      fprintf(stderr, "%s: parallel load differs\n", fixtures[f].name);
+    CHECK(same);
+  }
+
+  return 0;
+
+fail:
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Every format saves a matrix that loads back unchanged, and a parallel save
+ *  writes the same bytes as a serial one. */
+/*----------------------------------------------------------------------------*/
+static int
+test_roundtrip(void)
+{
+  int ret = -1;
+  Matrix G, U, L;
+  char path1[64], path2[64];
+
+  /* ...a general matrix and, for the graph formats, a symmetric one, both
+   * sorted since gap files keep their columns in ascending order... */
+  set_options(1, 1, IO_DEDUP_NONE, 0);
+  if (0 != load_mem(IO_mm_load_mem, mm_general, &G))
+    return -1;
+  if (0 != load_mem(IO_metis_load_mem, metis_graph, &U)) {
+    Matrix_free(&G);
+    return -1;
+  }
+
+  for (size_t f = 0; f < NFORMATS; f++) {
+    Matrix const * const M = formats[f].symm ? &U : &G;
+
+    sprintf(path1, "roundtrip-1.%s", formats[f].name);
+    sprintf(path2, "roundtrip-4.%s", formats[f].name);
+
+    set_options(1, 0, IO_DEDUP_NONE, 0);
+    CHECK(0 == formats[f].save(path1, M));
+    set_options(4, 0, IO_DEDUP_NONE, 0);
+    CHECK(0 == formats[f].save(path2, M));
+    if (!same_file(path1, path2))
+      fprintf(stderr, "%s: parallel save differs\n", formats[f].name);
+    CHECK(same_file(path1, path2));
+
+    set_options(1, 0, IO_DEDUP_NONE, 0);
+    CHECK(0 == Matrix_init(&L));
+    CHECK(0 == formats[f].load(path1, &L));
+    int const same = same_matrix(M, &L);
+    Matrix_free(&L);
+    if (!same)
+      fprintf(stderr, "%s: round trip differs\n", formats[f].name);
+    CHECK(same);
+
+    remove(path1);
+    remove(path2);
+  }
+
+  ret = 0;
+
+fail:
+  Matrix_free(&G);
+  Matrix_free(&U);
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Duplicate entries are kept or reduced as asked, serial and parallel. */
+/*----------------------------------------------------------------------------*/
+static int
+test_dedup(void)
+{
+  static struct {
+    int dedup;
+    ind_t nnz;
+    val_t a01, a11, a20;
+  } const cases[] = {
+    { IO_DEDUP_SUM,   3,  9, 4, 2.5 },
+    { IO_DEDUP_MIN,   3, -1, 1, 0.5 },
+    { IO_DEDUP_MAX,   3,  6, 3, 2   },
+    { IO_DEDUP_FIRST, 3,  4, 1, 2   }
+  };
+  Matrix M;
+
+  for (int nthreads = 1; nthreads <= 4; nthreads += 3) {
+    set_options(nthreads, 0, IO_DEDUP_NONE, 0);
+    CHECK(0 == load_mem(IO_mm_load_mem, mm_duplicate, &M));
+    int const nnz = (7 == M.nnz);
+    Matrix_free(&M);
+    CHECK(nnz);
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(*cases); c++) {
+      set_options(nthreads, 0, cases[c].dedup, 0);
+      CHECK(0 == load_mem(IO_mm_load_mem, mm_duplicate, &M));
+      int const ok = cases[c].nnz == M.nnz && cases[c].a01 == entry(&M, 0, 1)
+                  && cases[c].a11 == entry(&M, 1, 1)
+                  && cases[c].a20 == entry(&M, 2, 0);
+      Matrix_free(&M);
+      if (!ok)
+        fprintf(stderr, "dedup %d with %d threads\n", cases[c].dedup, nthreads);
+      CHECK(ok);
+    }
+  }
+
+  return 0;
+
+fail:
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Symmetric files and symmetrized general ones store their diagonal once, and
+ *  save to symmetric files that load back unchanged. */
+/*----------------------------------------------------------------------------*/
+static int
+test_symmetric(void)
+{
+  Matrix M, L;
+
+  for (int nthreads = 1; nthreads <= 4; nthreads += 3) {
+    set_options(nthreads, 0, IO_DEDUP_SUM, 0);
+    CHECK(0 == load_mem(IO_mm_load_mem, mm_symmetric, &M));
+    int ok = 1 == M.symm && 4 == M.nnz && 2 == entry(&M, 0, 0)
+          && 1 == entry(&M, 0, 1) && 1 == entry(&M, 1, 0)
+          && 5 == entry(&M, 2, 2);
+    Matrix_free(&M);
+    CHECK(ok);
+
+    set_options(nthreads, 0, IO_DEDUP_NONE, 1);
+    CHECK(0 == load_mem(IO_mm_load_mem, mm_loops, &M));
+    ok = 1 == M.symm && 4 == M.nnz && 1 == entry(&M, 0, 0)
+      && 2 == entry(&M, 0, 1) && 2 == entry(&M, 1, 0) && 3 == entry(&M, 2, 2);
+
+    /* ...which saves to a symmetric file... */
+    set_options(nthreads, 0, IO_DEDUP_NONE, 0);
+    CHECK(0 == Matrix_init(&L));
+    ok = ok && 0 == IO_mm_save("symmetric.mtx", &M);
+    ok = ok && 0 == IO_mm_load("symmetric.mtx", &L);
+    ok = ok && same_matrix(&M, &L);
+    Matrix_free(&M);
+    Matrix_free(&L);
+    remove("symmetric.mtx");
+    CHECK(ok);
+  }
+
+  return 0;
+
+fail:
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! A load reports the size of what it read and of the matrix it built. */
+/*----------------------------------------------------------------------------*/
+static int
+test_stats(void)
+{
+  char const * const path = "stats.mtx";
+  Matrix G, M;
+  IO_Stats stats;
+
+  set_options(1, 0, IO_DEDUP_NONE, 0);
+  if (0 != load_mem(IO_mm_load_mem, mm_general, &G))
+    return -1;
+  int ok = 0 == IO_mm_save(path, &G);
+  Matrix_free(&G);
+
+  ok = ok && 0 == Matrix_init(&M);
+  ok = ok && 0 == IO_load_ext(IO_MM, path, &M, &stats);
+  remove(path);
+  CHECK(ok);
+
+  ok = 14 == stats.nnz && 16 == stats.lines && 0 == stats.comments
+    && 0 < stats.bytes
+    && stats.size == 7 * sizeof(ind_t) + 14 * (sizeof(ind_t) + sizeof(val_t));
+  Matrix_free(&M);
+  CHECK(ok);
+
+  return 0;
+
+fail:
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Whether the rows of a block are rows r0.. of a matrix. */
+/*----------------------------------------------------------------------------*/
+static int
+same_rows(Matrix const * const M, ind_t const r0, Matrix const * const B)
+{
+  if (r0 + B->nr > M->nr || B->ncon != M->ncon)
+    return 0;
+  if ((NULL == M->a) != (NULL == B->a))
+    return 0;
+  if ((NULL == M->vwgt) != (NULL == B->vwgt))
+    return 0;
+
+  for (ind_t i = 0; i < B->nr; i++) {
+    ind_t const k = M->ia[r0 + i];
+    ind_t const n = B->ia[i + 1] - B->ia[i];
+
+    if (n != M->ia[r0 + i + 1] - k)
+      return 0;
+    if (0 != memcmp(B->ja + B->ia[i], M->ja + k, n * sizeof(*B->ja)))
+      return 0;
+    for (ind_t j = 0; NULL != B->a && j < n; j++)
+      if (B->a[B->ia[i] + j] != M->a[k + j])
+        return 0;
+  }
+  for (ind_t i = 0; NULL != B->vwgt && i < B->nr * B->ncon; i++)
+    if (B->vwgt[i] != M->vwgt[r0 * M->ncon + i])
+      return 0;
+
+  return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Files read in blocks of rows give back the rows of a whole load, in order
+ *  and in blocks of about the requested size. The fixtures are saved first,
+ *  so that coordinate files are sorted by row. */
+/*----------------------------------------------------------------------------*/
+static int
+test_rows(void)
+{
+  static struct {
+    int (*save)(char const *, Matrix const *);
+    int (*open)(char const *, size_t, IO_Rows **);
+  } const readers[] = {
+    { IO_mm_save,    IO_mm_open },
+    { IO_metis_save, IO_metis_open },
+    { IO_cluto_save, IO_cluto_open },
+    { IO_snap_save,  IO_snap_open }
+  };
+  char const * const path = "rows.txt";
+  size_t const blksz = 4;
+  int ret = -1;
+  Matrix M;
+
+  set_options(1, 0, IO_DEDUP_NONE, 0);
+  for (size_t f = 0; f < NFIXTURES; f++) {
+    IO_Rows * rows = NULL;
+    Matrix B;
+
+    CHECK(0 == load_mem(fixtures[f].load, fixtures[f].text, &M));
+    int ok = 0 == readers[f].save(path, &M)
+          && 0 == readers[f].open(path, blksz, &rows);
+
+    /* ...every block follows the last, and none is larger than needed... */
+    ind_t r0, nr = 0, nnz = 0, nblocks = 0;
+    int r = -1;
+    while (ok && 0 == (r = IO_rows_next(rows, &r0, &B))) {
+      ok = r0 == nr && 0 < B.nr && same_rows(&M, r0, &B)
+        && (B.nnz <= blksz + B.nr || 1 == B.nr);
+      nr  += B.nr;
+      nnz += B.nnz;
+      nblocks++;
+    }
+    ok = ok && 1 == r && M.nr == nr && M.nnz == nnz && 1 < nblocks;
+
+    if (NULL != rows)
+      IO_rows_close(rows);
+    Matrix_free(&M);
+    if (!ok)
+      fprintf(stderr, "%s: blocks differ from the whole load\n",
+              fixtures[f].name);
+    CHECK(ok);
+  }
+
+  ret = 0;
+
+fail:
+  (void)remove(path);
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Whether every range of rows of a file loads as the rows of a whole load. */
+/*----------------------------------------------------------------------------*/
+static int
+same_ranges(int (*load)(char const *, char const *, ind_t, ind_t, Matrix *),
+            char const * const path, char const * const index,
+            Matrix const * const M)
+{
+  int ok = 1;
+
+  for (ind_t r0 = 0; ok && r0 <= M->nr; r0++) {
+    for (ind_t r1 = r0; ok && r1 <= M->nr; r1++) {
+      Matrix R;
+
+      ok = 0 == Matrix_init(&R) && 0 == load(path, index, r0, r1, &R)
+        && r1 - r0 == R.nr && M->nc == R.nc && same_rows(M, r0, &R);
+      Matrix_free(&R);
+    }
+  }
+
+  return ok;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Rows [r0, r1) of METIS and CLUTO files load as those of a whole load, with
+ *  no index, with the sidecar or a named one, and with an index gone stale. */
+/*----------------------------------------------------------------------------*/
+static int
+test_range(void)
+{
+  static struct {
+    int (*load)(char const *, size_t, Matrix *);
+    int (*index)(char const *, char const *, size_t);
+    int (*range)(char const *, char const *, ind_t, ind_t, Matrix *);
+    char const * text;
+    char const * edit;
+  } const files[] = {
+    { IO_metis_load_mem, IO_metis_index, IO_metis_load_range, metis_graph,
+      "% a longer comment\n6 7 11 1\n2 2 0.5 3 1\n4 1 0.5 4 2\n"
+      "1 1 1 4 3 5 0.25\n3 2 2 3 3 6 4\n5 3 0.25 6 8\n2 4 4 5 8\n" },
+    { IO_cluto_load_mem, IO_cluto_index, IO_cluto_load_range, cluto_matrix,
+      "6 8 12\n1 0.5 8 2\n3 1.5 4 2\n\n2 -4 4 0.25 5 1\n7 3 1 6\n"
+      "6 2.5 8 -0.125 3 9\n" }
+  };
+  char const * const path = "range.txt";
+  char const * const sidecar = "range.txt.idx";
+  char const * const index = "range.idx";
+  int ret = -1;
+  Matrix M;
+
+  set_options(1, 0, IO_DEDUP_NONE, 0);
+  for (size_t f = 0; f < sizeof(files) / sizeof(*files); f++) {
+    CHECK(0 == write_file(path, files[f].text));
+    CHECK(0 == load_mem(files[f].load, files[f].text, &M));
+
+    int ok = same_ranges(files[f].range, path, NULL, &M);
+    ok = ok && 0 == files[f].index(path, NULL, 2);
+    ok = ok && same_ranges(files[f].range, path, NULL, &M);
+    ok = ok && 0 == files[f].index(path, index, 1);
+    ok = ok && same_ranges(files[f].range, path, index, &M);
+
+    /* ...a range past the last row is rejected... */
+    Matrix R;
+    ok = ok && 0 == Matrix_init(&R)
+      && 0 != files[f].range(path, NULL, 0, M.nr + 1, &R);
+    Matrix_free(&M);
+    CHECK(ok);
+
+    /* ...and the indexes of the file as it was are not used... */
+    CHECK(0 == write_file(path, files[f].edit));
+    CHECK(0 == load_mem(files[f].load, files[f].edit, &M));
+    ok = same_ranges(files[f].range, path, NULL, &M)
+      && same_ranges(files[f].range, path, index, &M);
+    Matrix_free(&M);
+    CHECK(ok);
+  }
+
+  ret = 0;
+
+fail:
+  (void)remove(path);
+  (void)remove(sidecar);
+  (void)remove(index);
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Malformed files are rejected, serial and parallel. */
+/*----------------------------------------------------------------------------*/
+static int
+test_invalid(void)
+{
+  static struct {
+    char const * name;
+    int (*load)(char const *, size_t, Matrix *);
+    char const * text;
+  } const cases[] = {
+    { "cluto with an unpaired index", IO_cluto_load_mem, cluto_unpaired }
+  };
+  Matrix M;
+
+  for (int nthreads = 1; nthreads <= 4; nthreads += 3) {
+    for (size_t c = 0; c < sizeof(cases) / sizeof(*cases); c++) {
+      set_options(nthreads, 0, IO_DEDUP_NONE, 0);
+      int const ret = load_mem(cases[c].load, cases[c].text, &M);
+      if (0 == ret) {
+        Matrix_free(&M);
+        fprintf(stderr, "%s loads with %d threads\n", cases[c].name, nthreads);
+      }
+      CHECK(0 != ret);
+    }
+  }
+
+  return 0;
+
+fail:
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Matrices loaded into a slab hold the same values as others and are released
+ *  with IO_slab_free, also by IO_bin_convert. */
+/*----------------------------------------------------------------------------*/
+static int
+test_slab(void)
+{
+  static int const slabs[] = { IO_SLAB_ALIGNED, IO_SLAB_HUGE };
+  char const * const path = "slab.mtx";
+  char const * const bpath = "slab.bin";
+  int ret = -1;
+  Matrix G, M;
+  IO_Options opts;
+
+  set_options(1, 0, IO_DEDUP_NONE, 0);
+  if (0 != load_mem(IO_mm_load_mem, mm_general, &G))
+    return -1;
+  CHECK(0 == write_file(path, mm_general));
+
+  for (size_t s = 0; s < sizeof(slabs) / sizeof(*slabs); s++) {
+    IO_options_get(&opts);
+    opts.slab = slabs[s];
+    IO_options_set(&opts);
+
+    CHECK(0 == Matrix_init(&M));
+    CHECK(0 == IO_mm_load(path, &M));
+    int const same = same_matrix(&G, &M);
+    CHECK(0 == IO_slab_free(&M));
+    CHECK(same && NULL == M.ia);
+
+    CHECK(0 == IO_bin_convert(path, bpath, IO_mm_load));
+
+    opts.slab = IO_SLAB_NONE;
+    IO_options_set(&opts);
+
+    CHECK(0 == Matrix_init(&M));
+    CHECK(0 == IO_bin_load(bpath, &M));
+    int const converted = same_matrix(&G, &M);
+    Matrix_free(&M);
+    CHECK(converted);
+  }
+
+  ret = 0;
+
+fail:
+  Matrix_free(&G);
+  remove(path);
+  remove(bpath);
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Whether a formatted value uses the notation of ECMAScript: positional when
+ *  its leading digit is within 10^-6 and 10^20, d[.ddd]e+x or d[.ddd]e-x
+ *  otherwise. */
+/*----------------------------------------------------------------------------*/
+static int
+ecma_notation(char const * const buf)
+{
+  char const * const p = ('-' == buf[0]) ? buf + 1 : buf;
+  char const * const e = strchr(p, 'e');
+  double const v = ('-' == buf[0]) ? -strtod(buf, NULL) : strtod(buf, NULL);
+
+  if (NULL == e)
+    return 0 == v || (1e-7 <= v && v < 1e21);
+
+  if (!('1' <= p[0] && p[0] <= '9') || ('.' != p[1] && 'e' != p[1]))
+    return 0;
+  if (('+' != e[1] && '-' != e[1]) || '0' == e[2])
+    return 0;
+
+  long const x = strtol(e + 1, NULL, 10);
+  return x <= -7 || 21 <= x;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Values are formatted with the fewest digits that read back, or rounded to
+ *  the requested precision, in one notation whichever way they are found. */
+/*----------------------------------------------------------------------------*/
+static int
+test_vtoa(void)
+{
+  static struct {
+    double x;
+    int prec;
+    char const * str;
+  } const cases[] = {
+    { 0,         0, "0" },
+    { -1.5,      0, "-1.5" },
+    { 0.1,       0, "0.1" },
+    { 1e-7,      0, "1e-7" },
+    { 1e20,      0, "100000000000000000000" },
+    { 1e21,      0, "1e+21" },
+    { 1.0 / 3,   3, "0.333" },
+    { 123456,    2, "120000" },
+    { 2.46e-8,   2, "2.5e-8" },
+    { -6.02e23,  1, "-6e+23" }
+  };
+  uint64_t seed = UINT64_C(0x9e3779b97f4a7c15);
+  char buf[64];
+
+  for (size_t c = 0; c < sizeof(cases) / sizeof(*cases); c++) {
+    buf[IO_vtoa((val_t)cases[c].x, cases[c].prec, buf)] = '\0';
+    if (0 != strcmp(buf, cases[c].str))
+      fprintf(stderr, "%.17g: %s, not %s\n", cases[c].x, buf, cases[c].str);
+    CHECK(0 == strcmp(buf, cases[c].str));
+  }
+
+  /* ...random bit patterns, which also take the slow path now and then... */
+  for (int i = 0; i < 200000; i++) {
+    val_t x;
+
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    if (sizeof(x) == sizeof(uint32_t)) {
+      uint32_t const u = (uint32_t)seed;
+      memcpy(&x, &u, sizeof(x));
+    } else {
+      memcpy(&x, &seed, sizeof(x));
+    }
+    if (isnan(x) || isinf(x))
+      continue;
+
+    buf[IO_vtoa(x, 0, buf)] = '\0';
+    int const exact = (val_t)strtod(buf, NULL) == x;
+    if (!exact || !ecma_notation(buf))
+      fprintf(stderr, "%a: %s\n", (double)x, buf);
+    CHECK(exact && ecma_notation(buf));
+
+    buf[IO_vtoa(x, 1 + i % 8, buf)] = '\0';
+    if (!ecma_notation(buf))
+      fprintf(stderr, "%a: %s with %d digits\n", (double)x, buf, 1 + i % 8);
+    CHECK(ecma_notation(buf));
+  }
+
+  return 0;
+
+fail:
+  return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Set the vertex ids of the following SNAP loads. */
+/*----------------------------------------------------------------------------*/
+static void
+set_ids(int const idbase, int const compact)
+{
+  IO_Options opts;
+
+  IO_options_get(&opts);
+  opts.idbase  = idbase;
+  opts.compact = compact;
+  IO_options_set(&opts);
+}
+
+/*----------------------------------------------------------------------------*/
+/*! SNAP vertex ids start at idbase, or are compacted to 0..n-1 in order of
+ *  first appearance, the id of each vertex then being kept in a map. */
+/*----------------------------------------------------------------------------*/
+static int
+test_compact(void)
+{
+  static char const zero[] = "0 1\n1 2\n2 0\n";
+  static char const one[]  = "1 2\n2 3\n3 1\n";
+  static char const sparse[] = "100 7\n7 42\n42 100\n100 100\n";
+  char const * const path = "compact.txt";
+  int ret = -1;
+  Matrix M, L;
+
+  CHECK(0 == write_file(path, sparse));
+
+  for (int nthreads = 1; nthreads <= 4; nthreads += 3) {
+    set_options(nthreads, 1, IO_DEDUP_NONE, 0);
+
+    set_ids(0, 0);
+    CHECK(0 == load_mem(IO_snap_load_mem, zero, &M));
+    set_ids(1, 0);
+    int ok = 0 == load_mem(IO_snap_load_mem, one, &L);
+    ok = ok && 3 == M.nr && 3 == M.nnz && same_matrix(&M, &L)
+      && 1 == entry(&M, 0, 1) && 1 == entry(&M, 2, 0);
+    Matrix_free(&M);
+    Matrix_free(&L);
+    CHECK(ok);
+
+    /* ...ids 100, 7 and 42 become 0, 1 and 2, whichever the idbase... */
+    uintmax_t * map = NULL;
+    set_ids(0, 1);
+    CHECK(0 == Matrix_init(&L));
+    ok = 0 == load_mem(IO_snap_load_mem, sparse, &M);
+    ok = ok && 3 == M.nr && 3 == M.nc && 4 == M.nnz
+      && 1 == entry(&M, 0, 0) && 1 == entry(&M, 0, 1)
+      && 1 == entry(&M, 1, 2) && 1 == entry(&M, 2, 0);
+    ok = ok && 0 == IO_snap_load_map(path, &L, &map);
+    ok = ok && same_matrix(&M, &L)
+      && 100 == map[0] && 7 == map[1] && 42 == map[2];
+    free(map);
+    Matrix_free(&M);
+    Matrix_free(&L);
+    CHECK(ok);
+  }
+
+  ret = 0;
+
+fail:
+  set_ids(1, 0);
+  (void)remove(path);
+  return ret;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! Many loads in flight at once each complete with their own matrix, a load
+ *  cancelled before it started leaves its matrix untouched, and a request
+ *  that completed can no longer be cancelled. */
+/*----------------------------------------------------------------------------*/
+static int
+test_async(void)
+{
+  enum { NREQS = 32 };
+  char const * const path = "async.mtx";
+  char const * const copy = "async_copy.mtx";
+  int ret = -1, nreqs = 0;
+  Matrix G, L, M[NREQS], E[NREQS];
+  IO_Async * reqs[NREQS];
+
+  set_options(2, 0, IO_DEDUP_NONE, 0);
+  if (0 != load_mem(IO_mm_load_mem, mm_general, &G))
+    return -1;
+  CHECK(0 == IO_mm_save(path, &G));
+
+  /* ...a save, read back once it completed... */
+  IO_Async * req;
+  CHECK(0 == IO_save_async(IO_MM, copy, &G, &req));
+  CHECK(0 == IO_async_wait(req));
+  CHECK(0 == Matrix_init(&L));
+  int ok = 0 == IO_mm_load(copy, &L) && same_matrix(&G, &L);
+  Matrix_free(&L);
+  CHECK(ok);
+
+  /* ...loads, every other one cancelled if it is still queued... */
+  for (; nreqs < NREQS; nreqs++) {
+    CHECK(0 == Matrix_init(&M[nreqs]));
+    E[nreqs] = M[nreqs];
+    if (0 != IO_load_async(IO_MM, path, &M[nreqs], &reqs[nreqs])) {
+      Matrix_free(&M[nreqs]);
+      break;
+    }
+  }
+  CHECK(NREQS == nreqs);
+
+  int cancelled[NREQS];
+  for (int i = 0; i < NREQS; i++)
+    cancelled[i] = (1 == i % 2 && 0 == IO_async_cancel(reqs[i]));
+
+  ok = 1;
+  for (int i = 0; i < NREQS; i++) {
+    int const r = IO_async_wait(reqs[i]);
+    if (cancelled[i])
+      ok = ok && -1 == r && 0 == memcmp(&E[i], &M[i], sizeof(*M));
+    else
+      ok = ok && 0 == r && same_matrix(&G, &M[i]);
+    Matrix_free(&M[i]);
+  }
+  nreqs = 0;
+  CHECK(ok);
+
+  /* ...a completed load, and a failed one... */
+  CHECK(0 == Matrix_init(&L));
+  ok = 0 == IO_load_async(IO_MM, path, &L, &req);
+  while (ok && 1 != IO_async_test(req))
+    continue;
+  ok = ok && 0 != IO_async_cancel(req) && 0 == IO_async_wait(req)
+    && same_matrix(&G, &L);
+  Matrix_free(&L);
+  CHECK(ok);
+
+  CHECK(0 == Matrix_init(&L));
+  ok = 0 == IO_load_async(IO_MM, "async_none.mtx", &L, &req)
+    && -1 == IO_async_wait(req);
+  Matrix_free(&L);
+  CHECK(ok);
+
+  ret = 0;
+
+fail:
+  for (int i = 0; i < nreqs; i++) {
+    (void)IO_async_wait(reqs[i]);
+    Matrix_free(&M[i]);
+  }
+  Matrix_free(&G);
+  (void)remove(path);
+  (void)remove(copy);
+  return ret;
+}
+
+#ifdef HAVE_MKSTEMP
+/*----------------------------------------------------------------------------*/
+/*! Load a file through the cache, reporting whether its sidecar was read. */
+/*----------------------------------------------------------------------------*/
+static int
+cache_load(char const * const path, Matrix * const M, int * const hit)
+{
+  IO_Stats stats;
+
+  if (0 != Matrix_init(M))
+    return -1;
+  if (0 != IO_load_ext(IO_MM, path, M, &stats))
+    return -1;
+
+  /* ...a sidecar is read instead of the text, so no line is... */
+  *hit = (0 == stats.lines);
+
+  return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/*! A cached load parses the file and writes a sidecar, which later loads read
+ *  instead until the file changes. Sidecars are created with the umask, so
+ *  that other users sharing the cache directory can read them. */
+/*----------------------------------------------------------------------------*/
+static int
+test_cache(void)
+{
+  char const * const dir = "cache.d";
+  char const * const path = "cache.mtx";
+  int ret = -1, hit = 0;
+  Matrix G, L, M;
+  IO_Options opts;
+
+  set_options(1, 0, IO_DEDUP_NONE, 0);
+  if (0 != load_mem(IO_mm_load_mem, mm_general, &G))
+    return -1;
+  if (0 != load_mem(IO_mm_load_mem, mm_loops, &L)) {
+    Matrix_free(&G);
+    return -1;
+  }
+
+  IO_options_get(&opts);
+  opts.cache = dir;
+  IO_options_set(&opts);
+
+  /* ...a miss, a hit and, once the file changed, a miss again... */
+  CHECK(0 == write_file(path, mm_general));
+  CHECK(0 == cache_load(path, &M, &hit));
+  int ok = !hit && same_matrix(&G, &M);
+  Matrix_free(&M);
+  CHECK(ok);
+
+  CHECK(0 == cache_load(path, &M, &hit));
+  ok = hit && same_matrix(&G, &M);
+  Matrix_free(&M);
+  CHECK(ok);
+
+  CHECK(0 == write_file(path, mm_loops));
+  CHECK(0 == cache_load(path, &M, &hit));
+  ok = !hit && same_matrix(&L, &M);
+  Matrix_free(&M);
+  CHECK(ok);
+
+  /* ...the one sidecar left has the mode of any other new file... */
+  mode_t const mask = umask(0);
+  (void)umask(mask);
+
+  DIR * const d = opendir(dir);
+  CHECK(NULL != d);
+  int nside = 0, modes = 1;
+  for (struct dirent * e = readdir(d); NULL != e; e = readdir(d)) {
+    char side[512];
+    struct stat st;
+
+    if ('.' == e->d_name[0])
+      continue;
+    (void)snprintf(side, sizeof(side), "%s/%s", dir, e->d_name);
+    modes = modes && 0 == stat(side, &st)
+                  && (st.st_mode & 0777) == (0666 & ~mask);
+    (void)remove(side);
+    nside++;
+  }
+  (void)closedir(d);
+  CHECK(1 == nside && modes);
+
+  ret = 0;
+
+fail:
+  opts.cache = NULL;
+  IO_options_set(&opts);
+  Matrix_free(&G);
+  Matrix_free(&L);
+  (void)remove(path);
+  (void)rmdir(dir);
+  return ret;
+}
+#endif
+
+#if defined(HAVE_MKFIFO) && defined(HAVE_FORK)
+/*----------------------------------------------------------------------------*/
+/*! A two-pass load of a FIFO, which cannot be re-read, stages its input and
+ *  builds the same matrix as a load from memory. */
+/*----------------------------------------------------------------------------*/
+static int
+test_fifo(void)
+{
+  char const * const path = "twopass.fifo";
+  Matrix S, F;
+  IO_Options opts;
+
+  set_options(1, 0, IO_DEDUP_NONE, 0);
+  if (0 != load_mem(IO_mm_load_mem, mm_general, &S))
+    return -1;
+
+  (void)remove(path);
+  if (0 != mkfifo(path, 0600)) {
+    Matrix_free(&S);
+    return -1;
+  }
+
+  pid_t const pid = fork();
+  if (0 == pid) {
+    /* ...the child feeds the fixture through the FIFO... */
+    size_t const len = strlen(mm_general);
+    FILE * const fp = fopen(path, "w");
+    int const ok = NULL != fp && len == fwrite(mm_general, 1, len, fp);
+    _exit(ok && 0 == fclose(fp) ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  IO_options_get(&opts);
+  opts.twopass = 1;
+  IO_options_set(&opts);
+
+  int ok = -1 != pid && 0 == Matrix_init(&F);
+  if (ok) {
+    ok = 0 == IO_mm_load(path, &F);
+    if (ok) {
+      ok = same_matrix(&S, &F);
+      Matrix_free(&F);
+    }
+  }
+
+  int status;
+  ok = ok && pid == waitpid(pid, &status, 0) && WIFEXITED(status)
+          && EXIT_SUCCESS == WEXITSTATUS(status);
+
+  Matrix_free(&S);
+  (void)remove(path);
+
+  return ok ? 0 : -1;
+}
+#endif
+
+/*----------------------------------------------------------------------------*/
+/*! Tests, by name. */
+/*----------------------------------------------------------------------------*/
+static struct {
+  char const * name;
+  int (*run)(void);
+} const tests[] = {
+  { "parallel",  test_parallel },
+  { "roundtrip", test_roundtrip },
+  { "dedup",     test_dedup },
+  { "symmetric", test_symmetric },
+  { "stats",     test_stats },
+  { "invalid",   test_invalid },
+  { "rows",      test_rows },
+  { "range",     test_range },
+  { "slab",      test_slab },
+  { "vtoa",      test_vtoa },
+  { "compact",   test_compact },
+  { "async",     test_async },
+#ifdef HAVE_MKSTEMP
+  { "cache",     test_cache },
+#endif
+#if defined(HAVE_MKFIFO) && defined(HAVE_FORK)
+  { "fifo",      test_fifo },
+#endif
+};
+
+/*----------------------------------------------------------------------------*/
+/*! Run the test named on the command line. */
+/*----------------------------------------------------------------------------*/
+int
+main(int argc, char * argv[])
+{
+  if (2 != argc) {
+    fprintf(stderr, "usage: %s <test>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  for (size_t t = 0; t < sizeof(tests) / sizeof(*tests); t++)
+    if (0 == strcmp(argv[1], tests[t].name))
+      return 0 == tests[t].run() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  fprintf(stderr, "%s: unknown test %s\n", argv[0], argv[1]);
+  return EXIT_FAILURE;
+}